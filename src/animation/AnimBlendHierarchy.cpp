@@ -37,6 +37,10 @@ CAnimBlendHierarchy::CalcTotalTime(void)
 		for(j = 0; j < sequences[i].numFrames; j++)
 			seqTime += sequences[i].GetKeyFrame(j)->deltaTime;
 		totalLength = Max(totalLength, seqTime);
+#ifdef FAST_KEYFRAME_SEARCH
+		if(sequences[i].keyFrameTimes == nil)
+			sequences[i].CalcKeyFrameTimes();
+#endif
 	}
 }
 
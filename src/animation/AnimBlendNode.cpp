@@ -45,6 +45,19 @@ CAnimBlendNode::Update(CVector &trans, CQuaternion &rot, float weight)
 	return looped;
 }
 
+// Not original.
+// Only the time advance of Update
+bool
+CAnimBlendNode::UpdateTime(void)
+{
+	if(association->IsRunning()){
+		remainingTime -= association->timeStep;
+		if(remainingTime <= 0.0f)
+			return NextKeyFrame();
+	}
+	return false;
+}
+
 bool
 CAnimBlendNode::NextKeyFrame(void)
 {
@@ -56,6 +69,19 @@ CAnimBlendNode::NextKeyFrame(void)
 	looped = false;
 	frameB = frameA;
 
+#ifdef FAST_KEYFRAME_SEARCH
+	// Not original.
+	// Jump right to the key frame when we'd have to walk past more than one
+	if(sequence->keyFrameTimes && frameA > 0 && frameA+1 < sequence->numFrames &&
+	   remainingTime + sequence->GetKeyFrame(frameA+1)->deltaTime <= 0.0f){
+		float t = sequence->keyFrameTimes[frameA] - remainingTime;
+		if(t < sequence->keyFrameTimes[sequence->numFrames-1]){
+			frameA = sequence->FindKeyFrameIndex(t, true);
+			remainingTime = sequence->keyFrameTimes[frameA] - t;
+		}
+	}
+#endif
+
 	// Advance as long as we have to
 	while(remainingTime <= 0.0f){
 		frameA++;
@@ -89,6 +115,18 @@ CAnimBlendNode::FindKeyFrame(float t)
 	if(sequence->numFrames < 1)
 		return false;
 
+#ifdef FAST_KEYFRAME_SEARCH
+	// Not original.
+	// Wrapping around is left to the loop below
+	if(sequence->keyFrameTimes && t <= sequence->keyFrameTimes[sequence->numFrames-1]){
+		frameA = sequence->FindKeyFrameIndex(t, false);
+		frameB = frameA - 1;
+		remainingTime = sequence->keyFrameTimes[frameA] - t;
+		CalcDeltas();
+		return true;
+	}
+#endif
+
 	frameA = 0;
 	frameB = frameA;
 
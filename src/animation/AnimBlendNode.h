@@ -20,6 +20,7 @@ public:
 
 	void Init(void);
 	bool Update(CVector &trans, CQuaternion &rot, float weight);
+	bool UpdateTime(void);
 	bool NextKeyFrame(void);
 	bool FindKeyFrame(float t);
 	void CalcDeltas(void);
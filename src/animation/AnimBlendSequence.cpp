@@ -9,6 +9,10 @@ CAnimBlendSequence::CAnimBlendSequence(void)
 	numFrames = 0;
 	keyFrames = nil;
 	keyFramesCompressed = nil;
+#ifdef FAST_KEYFRAME_SEARCH
+	keyFrameTimes = nil;
+	invFrameStep = 0.0f;
+#endif
 #ifdef PED_SKIN
 	boneTag = -1;
 #endif
@@ -20,6 +24,9 @@ CAnimBlendSequence::~CAnimBlendSequence(void)
 		RwFree(keyFrames);
 	if(keyFramesCompressed)
 		RwFree(keyFramesCompressed);
+#ifdef FAST_KEYFRAME_SEARCH
+	RemoveKeyFrameTimes();
+#endif
 }
 
 void
@@ -115,6 +122,10 @@ CAnimBlendSequence::Uncompress(void)
 	keyFramesCompressed = nil;
 
 	POP_MEMID();
+
+#ifdef FAST_KEYFRAME_SEARCH
+	CalcKeyFrameTimes();
+#endif
 }
 
 void
@@ -175,12 +186,24 @@ CAnimBlendSequence::RemoveUncompressedData(void)
 	CompressKeyframes();
 	RwFree(keyFrames);
 	keyFrames = nil;
+#ifdef FAST_KEYFRAME_SEARCH
+	RemoveKeyFrameTimes();
+#endif
 }
 
 #ifdef USE_CUSTOM_ALLOCATOR
 bool
 CAnimBlendSequence::MoveMemory(void)
 {
+#ifdef FAST_KEYFRAME_SEARCH
+	if(keyFrameTimes){
+		void *newaddr = gMainHeap.MoveMemory(keyFrameTimes);
+		if(newaddr != keyFrameTimes){
+			keyFrameTimes = (float*)newaddr;
+			return true;
+		}
+	}
+#endif
 	if(keyFrames){
 		void *newaddr = gMainHeap.MoveMemory(keyFrames);
 		if(newaddr != keyFrames){
@@ -198,3 +221,77 @@ CAnimBlendSequence::MoveMemory(void)
 }
 #endif
 
+
+#ifdef FAST_KEYFRAME_SEARCH
+// Not original.
+// The key frames only know the time since the previous one, so finding the
+// key frame at some time meant walking through all of them. Long cutscene
+// anims were walked through for every bone whenever they were started or
+// the time jumped. Keep the summed up times around for searching.
+void
+CAnimBlendSequence::CalcKeyFrameTimes(void)
+{
+	int i;
+
+	RemoveKeyFrameTimes();
+	if(numFrames < 2)
+		return;
+
+	PUSH_MEMID(MEMID_ANIMATION);
+	keyFrameTimes = (float*)RwMalloc(numFrames * sizeof(float));
+	REGISTER_MEMPTR(&keyFrameTimes);
+	POP_MEMID();
+
+	// the first key frame's time is never used by CAnimBlendNode
+	keyFrameTimes[0] = 0.0f;
+	for(i = 1; i < numFrames; i++)
+		keyFrameTimes[i] = keyFrameTimes[i-1] + GetKeyFrame(i)->deltaTime;
+
+	float step = keyFrameTimes[numFrames-1] / (numFrames-1);
+	invFrameStep = step > 0.0f ? 1.0f/step : 0.0f;
+	for(i = 1; i < numFrames; i++)
+		if(Abs(GetKeyFrame(i)->deltaTime - step) > step*0.01f){
+			invFrameStep = 0.0f;
+			break;
+		}
+}
+
+void
+CAnimBlendSequence::RemoveKeyFrameTimes(void)
+{
+	if(keyFrameTimes)
+		RwFree(keyFrameTimes);
+	keyFrameTimes = nil;
+	invFrameStep = 0.0f;
+}
+
+// First key frame after the first one whose time is >= t,
+// or > t if after is set. t must be before the last key frame.
+int32
+CAnimBlendSequence::FindKeyFrameIndex(float t, bool after)
+{
+	int32 lo = 1;
+	int32 hi = numFrames-1;
+
+#define PAST(i) (after ? keyFrameTimes[i] > t : keyFrameTimes[i] >= t)
+	if(invFrameStep > 0.0f){
+		// evenly sampled, guess the key frame and only look around it
+		int32 i = Clamp((int32)(t*invFrameStep), 1, numFrames-1);
+		int32 l = Max(i-1, 1);
+		int32 h = Min(i+1, numFrames-1);
+		if(PAST(h) && (l == 1 || !PAST(l-1))){
+			lo = l;
+			hi = h;
+		}
+	}
+	while(lo < hi){
+		int32 mid = (lo + hi)/2;
+		if(PAST(mid))
+			hi = mid;
+		else
+			lo = mid+1;
+	}
+#undef PAST
+	return lo;
+}
+#endif
@@ -42,6 +42,10 @@ public:
 #endif
 	void *keyFrames;
 	void *keyFramesCompressed;
+#ifdef FAST_KEYFRAME_SEARCH
+	float *keyFrameTimes;	// time of every key frame relative to the first one
+	float invFrameStep;	// 1/time between key frames if they're evenly sampled, 0 otherwise
+#endif
 
 	CAnimBlendSequence(void);
 	virtual ~CAnimBlendSequence(void);
@@ -58,11 +62,16 @@ public:
 	void CompressKeyframes(void);
 	void RemoveUncompressedData(void);
 	bool MoveMemory(void);
+#ifdef FAST_KEYFRAME_SEARCH
+	void CalcKeyFrameTimes(void);
+	void RemoveKeyFrameTimes(void);
+	int32 FindKeyFrameIndex(float t, bool after);
+#endif
 
 #ifdef PED_SKIN
 	void SetBoneTag(int tag) { boneTag = tag; }
 #endif
 };
-#ifndef PED_SKIN
+#if !defined PED_SKIN && !defined FAST_KEYFRAME_SEARCH
 VALIDATE_SIZE(CAnimBlendSequence, 0x2C);
 #endif
@@ -5,6 +5,18 @@
 #include "AnimBlendClumpData.h"
 #include "AnimBlendAssociation.h"
 #include "RpAnimBlend.h"
+#ifdef SIMD_ANIM_BLEND
+#include "General.h"
+#include "Timer.h"
+
+#if defined __SSE__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 1)
+#define ANIM_BLEND_SSE
+#include <xmmintrin.h>
+#elif defined __ARM_NEON
+#define ANIM_BLEND_NEON
+#include <arm_neon.h>
+#endif
+#endif
 
 CAnimBlendClumpData *gpAnimBlendClump;
 
@@ -443,3 +455,632 @@ FrameUpdateCallBackWith3dVelocityExtractionSkinned(AnimBlendFrameData *frame, vo
 }
 
 #endif
+
+#ifdef SIMD_ANIM_BLEND
+
+bool gbSimdAnimBlend = true;
+
+static void
+ClearSample(AnimBlendPoseSamples *s, int32 i)
+{
+	s->q1x[i] = s->q1y[i] = s->q1z[i] = s->q1w[i] = 0.0f;
+	s->q2x[i] = s->q2y[i] = s->q2z[i] = s->q2w[i] = 0.0f;
+	s->theta[i] = s->invSin[i] = s->t[i] = 0.0f;
+	s->rotBlend[i] = 0.0f;
+	s->t1x[i] = s->t1y[i] = s->t1z[i] = 0.0f;
+	s->t2x[i] = s->t2y[i] = s->t2z[i] = 0.0f;
+	s->transBlend[i] = 0.0f;
+}
+
+// Same as CAnimBlendNode::Update but the key frames are stored instead of interpolated
+static void
+SampleNode(CAnimBlendNode *node, float weight, AnimBlendPoseSamples *s, int32 i)
+{
+	node->UpdateTime();
+
+	float blend = node->association->GetBlendAmount(weight);
+	if(blend <= 0.0f){
+		ClearSample(s, i);
+		return;
+	}
+
+	CAnimBlendSequence *seq = node->sequence;
+	KeyFrameTrans *kfA = (KeyFrameTrans*)seq->GetKeyFrame(node->frameA);
+	KeyFrameTrans *kfB = (KeyFrameTrans*)seq->GetKeyFrame(node->frameB);
+	s->t[i] = kfA->deltaTime == 0.0f ? 0.0f : (kfA->deltaTime - node->remainingTime)/kfA->deltaTime;
+	if(seq->type & CAnimBlendSequence::KF_ROT){
+		s->q1x[i] = kfB->rotation.x;
+		s->q1y[i] = kfB->rotation.y;
+		s->q1z[i] = kfB->rotation.z;
+		s->q1w[i] = kfB->rotation.w;
+		s->q2x[i] = kfA->rotation.x;
+		s->q2y[i] = kfA->rotation.y;
+		s->q2z[i] = kfA->rotation.z;
+		s->q2w[i] = kfA->rotation.w;
+		s->theta[i] = node->theta;
+		s->invSin[i] = node->invSin;
+		s->rotBlend[i] = blend;
+	}else{
+		s->q1x[i] = s->q1y[i] = s->q1z[i] = s->q1w[i] = 0.0f;
+		s->q2x[i] = s->q2y[i] = s->q2z[i] = s->q2w[i] = 0.0f;
+		s->theta[i] = s->invSin[i] = 0.0f;
+		s->rotBlend[i] = 0.0f;
+	}
+	if(seq->type & CAnimBlendSequence::KF_TRANS){
+		s->t1x[i] = kfB->translation.x;
+		s->t1y[i] = kfB->translation.y;
+		s->t1z[i] = kfB->translation.z;
+		s->t2x[i] = kfA->translation.x;
+		s->t2y[i] = kfA->translation.y;
+		s->t2z[i] = kfA->translation.z;
+		s->transBlend[i] = blend;
+	}else{
+		s->t1x[i] = s->t1y[i] = s->t1z[i] = 0.0f;
+		s->t2x[i] = s->t2y[i] = s->t2z[i] = 0.0f;
+		s->transBlend[i] = 0.0f;
+	}
+}
+
+// What the FrameUpdateCallBacks do for one bone of one association, for bones start to n-1
+static void
+AccumulatePoseScalar(const AnimBlendPoseSamples *s, AnimBlendPose *pose, int32 start, int32 n)
+{
+	for(int32 i = start; i < n; i++){
+		CQuaternion q;
+		q.Slerp(CQuaternion(s->q1x[i], s->q1y[i], s->q1z[i], s->q1w[i]),
+			CQuaternion(s->q2x[i], s->q2y[i], s->q2z[i], s->q2w[i]),
+			s->theta[i], s->invSin[i], s->t[i]);
+		q *= s->rotBlend[i];
+		CQuaternion rot(pose->qx[i], pose->qy[i], pose->qz[i], pose->qw[i]);
+#ifdef FIX_BUGS
+		if(DotProduct(rot, q) < 0.0f)
+			rot -= q;
+		else
+#endif
+			rot += q;
+		pose->qx[i] = rot.x;
+		pose->qy[i] = rot.y;
+		pose->qz[i] = rot.z;
+		pose->qw[i] = rot.w;
+
+		pose->tx[i] += (s->t1x[i] + s->t[i]*(s->t2x[i] - s->t1x[i])) * s->transBlend[i];
+		pose->ty[i] += (s->t1y[i] + s->t[i]*(s->t2y[i] - s->t1y[i])) * s->transBlend[i];
+		pose->tz[i] += (s->t1z[i] + s->t[i]*(s->t2z[i] - s->t1z[i])) * s->transBlend[i];
+	}
+}
+
+static void
+NormalisePoseScalar(AnimBlendPose *pose, int32 start, int32 n)
+{
+	for(int32 i = start; i < n; i++){
+		CQuaternion rot(pose->qx[i], pose->qy[i], pose->qz[i], pose->qw[i]);
+		rot.Normalise();
+		pose->qx[i] = rot.x;
+		pose->qy[i] = rot.y;
+		pose->qz[i] = rot.z;
+		pose->qw[i] = rot.w;
+	}
+}
+
+#if defined ANIM_BLEND_SSE
+
+// sin on [0, PI/2], taylor series to x^9, error below 4e-6
+static __m128
+Sin4(__m128 x)
+{
+	__m128 x2 = _mm_mul_ps(x, x);
+	__m128 p = _mm_set1_ps(1.0f/362880.0f);
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.0f/5040.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f/120.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.0f/6.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f));
+	return _mm_mul_ps(p, x);
+}
+
+static void
+AccumulatePose(const AnimBlendPoseSamples *s, AnimBlendPose *pose, int32 n)
+{
+	int32 i = 0;
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 pi = _mm_set1_ps(PI);
+	__m128 halfPi = _mm_set1_ps(PI/2);
+	__m128 signMask = _mm_set1_ps(-0.0f);
+	for(; i + 4 <= n; i += 4){
+		__m128 theta = _mm_loadu_ps(&s->theta[i]);
+		__m128 invSin = _mm_loadu_ps(&s->invSin[i]);
+		__m128 t = _mm_loadu_ps(&s->t[i]);
+		__m128 blend = _mm_loadu_ps(&s->rotBlend[i]);
+
+		// slerp weights, see CQuaternion::Slerp
+		__m128 flip = _mm_cmpgt_ps(theta, halfPi);
+		theta = _mm_or_ps(_mm_and_ps(flip, _mm_sub_ps(pi, theta)), _mm_andnot_ps(flip, theta));
+		__m128 w1 = _mm_mul_ps(Sin4(_mm_mul_ps(_mm_sub_ps(one, t), theta)), invSin);
+		__m128 w2 = _mm_mul_ps(Sin4(_mm_mul_ps(t, theta)), invSin);
+		w2 = _mm_xor_ps(w2, _mm_and_ps(flip, signMask));
+		__m128 same = _mm_cmpeq_ps(theta, zero);
+		w1 = _mm_andnot_ps(same, w1);
+		w2 = _mm_or_ps(_mm_and_ps(same, one), _mm_andnot_ps(same, w2));
+		w1 = _mm_mul_ps(w1, blend);
+		w2 = _mm_mul_ps(w2, blend);
+
+		__m128 qx = _mm_add_ps(_mm_mul_ps(w1, _mm_loadu_ps(&s->q1x[i])), _mm_mul_ps(w2, _mm_loadu_ps(&s->q2x[i])));
+		__m128 qy = _mm_add_ps(_mm_mul_ps(w1, _mm_loadu_ps(&s->q1y[i])), _mm_mul_ps(w2, _mm_loadu_ps(&s->q2y[i])));
+		__m128 qz = _mm_add_ps(_mm_mul_ps(w1, _mm_loadu_ps(&s->q1z[i])), _mm_mul_ps(w2, _mm_loadu_ps(&s->q2z[i])));
+		__m128 qw = _mm_add_ps(_mm_mul_ps(w1, _mm_loadu_ps(&s->q1w[i])), _mm_mul_ps(w2, _mm_loadu_ps(&s->q2w[i])));
+		__m128 rx = _mm_loadu_ps(&pose->qx[i]);
+		__m128 ry = _mm_loadu_ps(&pose->qy[i]);
+		__m128 rz = _mm_loadu_ps(&pose->qz[i]);
+		__m128 rw = _mm_loadu_ps(&pose->qw[i]);
+#ifdef FIX_BUGS
+		__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, qx), _mm_mul_ps(ry, qy)), _mm_add_ps(_mm_mul_ps(rz, qz), _mm_mul_ps(rw, qw)));
+		__m128 neg = _mm_and_ps(_mm_cmplt_ps(dot, zero), signMask);
+		qx = _mm_xor_ps(qx, neg);
+		qy = _mm_xor_ps(qy, neg);
+		qz = _mm_xor_ps(qz, neg);
+		qw = _mm_xor_ps(qw, neg);
+#endif
+		_mm_storeu_ps(&pose->qx[i], _mm_add_ps(rx, qx));
+		_mm_storeu_ps(&pose->qy[i], _mm_add_ps(ry, qy));
+		_mm_storeu_ps(&pose->qz[i], _mm_add_ps(rz, qz));
+		_mm_storeu_ps(&pose->qw[i], _mm_add_ps(rw, qw));
+
+		blend = _mm_loadu_ps(&s->transBlend[i]);
+		__m128 a = _mm_loadu_ps(&s->t1x[i]);
+		__m128 v = _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(_mm_loadu_ps(&s->t2x[i]), a)));
+		_mm_storeu_ps(&pose->tx[i], _mm_add_ps(_mm_loadu_ps(&pose->tx[i]), _mm_mul_ps(v, blend)));
+		a = _mm_loadu_ps(&s->t1y[i]);
+		v = _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(_mm_loadu_ps(&s->t2y[i]), a)));
+		_mm_storeu_ps(&pose->ty[i], _mm_add_ps(_mm_loadu_ps(&pose->ty[i]), _mm_mul_ps(v, blend)));
+		a = _mm_loadu_ps(&s->t1z[i]);
+		v = _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(_mm_loadu_ps(&s->t2z[i]), a)));
+		_mm_storeu_ps(&pose->tz[i], _mm_add_ps(_mm_loadu_ps(&pose->tz[i]), _mm_mul_ps(v, blend)));
+	}
+	AccumulatePoseScalar(s, pose, i, n);
+}
+
+static void
+NormalisePose(AnimBlendPose *pose, int32 n)
+{
+	int32 i = 0;
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	for(; i + 4 <= n; i += 4){
+		__m128 x = _mm_loadu_ps(&pose->qx[i]);
+		__m128 y = _mm_loadu_ps(&pose->qy[i]);
+		__m128 z = _mm_loadu_ps(&pose->qz[i]);
+		__m128 w = _mm_loadu_ps(&pose->qw[i]);
+		__m128 sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+		__m128 isZero = _mm_cmpeq_ps(sq, zero);
+		__m128 inv = _mm_andnot_ps(isZero, _mm_div_ps(one, _mm_sqrt_ps(sq)));
+		_mm_storeu_ps(&pose->qx[i], _mm_mul_ps(x, inv));
+		_mm_storeu_ps(&pose->qy[i], _mm_mul_ps(y, inv));
+		_mm_storeu_ps(&pose->qz[i], _mm_mul_ps(z, inv));
+		_mm_storeu_ps(&pose->qw[i], _mm_or_ps(_mm_and_ps(isZero, one), _mm_mul_ps(w, inv)));
+	}
+	NormalisePoseScalar(pose, i, n);
+}
+
+#elif defined ANIM_BLEND_NEON
+
+// sin on [0, PI/2], taylor series to x^9, error below 4e-6
+static float32x4_t
+Sin4(float32x4_t x)
+{
+	float32x4_t x2 = vmulq_f32(x, x);
+	float32x4_t p = vdupq_n_f32(1.0f/362880.0f);
+	p = vaddq_f32(vmulq_f32(p, x2), vdupq_n_f32(-1.0f/5040.0f));
+	p = vaddq_f32(vmulq_f32(p, x2), vdupq_n_f32(1.0f/120.0f));
+	p = vaddq_f32(vmulq_f32(p, x2), vdupq_n_f32(-1.0f/6.0f));
+	p = vaddq_f32(vmulq_f32(p, x2), vdupq_n_f32(1.0f));
+	return vmulq_f32(p, x);
+}
+
+static void
+AccumulatePose(const AnimBlendPoseSamples *s, AnimBlendPose *pose, int32 n)
+{
+	int32 i = 0;
+	float32x4_t zero = vdupq_n_f32(0.0f);
+	float32x4_t one = vdupq_n_f32(1.0f);
+	float32x4_t pi = vdupq_n_f32(PI);
+	float32x4_t halfPi = vdupq_n_f32(PI/2);
+	for(; i + 4 <= n; i += 4){
+		float32x4_t theta = vld1q_f32(&s->theta[i]);
+		float32x4_t invSin = vld1q_f32(&s->invSin[i]);
+		float32x4_t t = vld1q_f32(&s->t[i]);
+		float32x4_t blend = vld1q_f32(&s->rotBlend[i]);
+
+		// slerp weights, see CQuaternion::Slerp
+		uint32x4_t flip = vcgtq_f32(theta, halfPi);
+		theta = vbslq_f32(flip, vsubq_f32(pi, theta), theta);
+		float32x4_t w1 = vmulq_f32(Sin4(vmulq_f32(vsubq_f32(one, t), theta)), invSin);
+		float32x4_t w2 = vmulq_f32(Sin4(vmulq_f32(t, theta)), invSin);
+		w2 = vbslq_f32(flip, vnegq_f32(w2), w2);
+		uint32x4_t same = vceqq_f32(theta, zero);
+		w1 = vbslq_f32(same, zero, w1);
+		w2 = vbslq_f32(same, one, w2);
+		w1 = vmulq_f32(w1, blend);
+		w2 = vmulq_f32(w2, blend);
+
+		float32x4_t qx = vaddq_f32(vmulq_f32(w1, vld1q_f32(&s->q1x[i])), vmulq_f32(w2, vld1q_f32(&s->q2x[i])));
+		float32x4_t qy = vaddq_f32(vmulq_f32(w1, vld1q_f32(&s->q1y[i])), vmulq_f32(w2, vld1q_f32(&s->q2y[i])));
+		float32x4_t qz = vaddq_f32(vmulq_f32(w1, vld1q_f32(&s->q1z[i])), vmulq_f32(w2, vld1q_f32(&s->q2z[i])));
+		float32x4_t qw = vaddq_f32(vmulq_f32(w1, vld1q_f32(&s->q1w[i])), vmulq_f32(w2, vld1q_f32(&s->q2w[i])));
+		float32x4_t rx = vld1q_f32(&pose->qx[i]);
+		float32x4_t ry = vld1q_f32(&pose->qy[i]);
+		float32x4_t rz = vld1q_f32(&pose->qz[i]);
+		float32x4_t rw = vld1q_f32(&pose->qw[i]);
+#ifdef FIX_BUGS
+		float32x4_t dot = vaddq_f32(vaddq_f32(vmulq_f32(rx, qx), vmulq_f32(ry, qy)), vaddq_f32(vmulq_f32(rz, qz), vmulq_f32(rw, qw)));
+		uint32x4_t neg = vcltq_f32(dot, zero);
+		qx = vbslq_f32(neg, vnegq_f32(qx), qx);
+		qy = vbslq_f32(neg, vnegq_f32(qy), qy);
+		qz = vbslq_f32(neg, vnegq_f32(qz), qz);
+		qw = vbslq_f32(neg, vnegq_f32(qw), qw);
+#endif
+		vst1q_f32(&pose->qx[i], vaddq_f32(rx, qx));
+		vst1q_f32(&pose->qy[i], vaddq_f32(ry, qy));
+		vst1q_f32(&pose->qz[i], vaddq_f32(rz, qz));
+		vst1q_f32(&pose->qw[i], vaddq_f32(rw, qw));
+
+		blend = vld1q_f32(&s->transBlend[i]);
+		float32x4_t a = vld1q_f32(&s->t1x[i]);
+		float32x4_t v = vaddq_f32(a, vmulq_f32(t, vsubq_f32(vld1q_f32(&s->t2x[i]), a)));
+		vst1q_f32(&pose->tx[i], vaddq_f32(vld1q_f32(&pose->tx[i]), vmulq_f32(v, blend)));
+		a = vld1q_f32(&s->t1y[i]);
+		v = vaddq_f32(a, vmulq_f32(t, vsubq_f32(vld1q_f32(&s->t2y[i]), a)));
+		vst1q_f32(&pose->ty[i], vaddq_f32(vld1q_f32(&pose->ty[i]), vmulq_f32(v, blend)));
+		a = vld1q_f32(&s->t1z[i]);
+		v = vaddq_f32(a, vmulq_f32(t, vsubq_f32(vld1q_f32(&s->t2z[i]), a)));
+		vst1q_f32(&pose->tz[i], vaddq_f32(vld1q_f32(&pose->tz[i]), vmulq_f32(v, blend)));
+	}
+	AccumulatePoseScalar(s, pose, i, n);
+}
+
+static void
+NormalisePose(AnimBlendPose *pose, int32 n)
+{
+	int32 i = 0;
+	float32x4_t zero = vdupq_n_f32(0.0f);
+	float32x4_t one = vdupq_n_f32(1.0f);
+	for(; i + 4 <= n; i += 4){
+		float32x4_t x = vld1q_f32(&pose->qx[i]);
+		float32x4_t y = vld1q_f32(&pose->qy[i]);
+		float32x4_t z = vld1q_f32(&pose->qz[i]);
+		float32x4_t w = vld1q_f32(&pose->qw[i]);
+		float32x4_t sq = vaddq_f32(vaddq_f32(vmulq_f32(x, x), vmulq_f32(y, y)), vaddq_f32(vmulq_f32(z, z), vmulq_f32(w, w)));
+		uint32x4_t isZero = vceqq_f32(sq, zero);
+		// estimate and two newton steps, there's no vector sqrt on 32 bit arm
+		float32x4_t inv = vrsqrteq_f32(sq);
+		inv = vmulq_f32(inv, vrsqrtsq_f32(vmulq_f32(sq, inv), inv));
+		inv = vmulq_f32(inv, vrsqrtsq_f32(vmulq_f32(sq, inv), inv));
+		inv = vbslq_f32(isZero, zero, inv);
+		vst1q_f32(&pose->qx[i], vmulq_f32(x, inv));
+		vst1q_f32(&pose->qy[i], vmulq_f32(y, inv));
+		vst1q_f32(&pose->qz[i], vmulq_f32(z, inv));
+		vst1q_f32(&pose->qw[i], vbslq_f32(isZero, one, vmulq_f32(w, inv)));
+	}
+	NormalisePoseScalar(pose, i, n);
+}
+
+#else
+
+static void
+AccumulatePose(const AnimBlendPoseSamples *s, AnimBlendPose *pose, int32 n)
+{
+	AccumulatePoseScalar(s, pose, 0, n);
+}
+
+static void
+NormalisePose(AnimBlendPose *pose, int32 n)
+{
+	NormalisePoseScalar(pose, 0, n);
+}
+
+#endif
+
+static void
+ClearPose(AnimBlendPose *pose, int32 n)
+{
+	for(int32 i = 0; i < n; i++){
+		pose->qx[i] = pose->qy[i] = pose->qz[i] = pose->qw[i] = 0.0f;
+		pose->tx[i] = pose->ty[i] = pose->tz[i] = 0.0f;
+	}
+}
+
+#ifdef SHARED_POSE_CACHE
+bool gbSharedPoseCache = true;
+
+// Not original.
+// Poses of clumps that play nothing but one fully blended in animation,
+// for the current frame. Peds walking around mostly play the same few
+// animations, so most of them can take their pose from here.
+// The time is quantized by poseTimeStep so nearby times share a pose.
+#define POSE_CACHE_SIZE (64)	// power of two
+
+struct AnimBlendCachedPose
+{
+	CAnimBlendHierarchy *hierarchy;
+	int32 timeKey;
+	float timeStep;
+	uint32 frameCounter;	// only valid in that frame
+	int32 numFrames;
+	uint64 extractedMask;	// frames that were left to the velocity extraction callbacks
+	CAnimBlendSequence *sequences[MAX_POSE_BONES];	// which sequence was played on which frame
+	AnimBlendPose pose;
+};
+
+static AnimBlendCachedPose aCachedPoses[POSE_CACHE_SIZE];
+
+static bool
+IsCachedPose(AnimBlendCachedPose *cached, CAnimBlendNode *nodes, int32 n, int32 timeKey, float timeStep, uint64 extractedMask)
+{
+	if(cached->frameCounter != CTimer::GetFrameCounter() || cached->hierarchy != nodes->association->hierarchy ||
+	   cached->timeKey != timeKey || cached->timeStep != timeStep ||
+	   cached->numFrames != n || cached->extractedMask != extractedMask)
+		return false;
+	for(int32 i = 0; i < n; i++)
+		if(cached->sequences[i] != nodes[i].sequence)
+			return false;
+	return true;
+}
+
+static void
+SetCachedPose(AnimBlendCachedPose *cached, CAnimBlendNode *nodes, int32 n, int32 timeKey, float timeStep, uint64 extractedMask,
+	const AnimBlendPose *pose)
+{
+	cached->hierarchy = nodes->association->hierarchy;
+	cached->timeKey = timeKey;
+	cached->timeStep = timeStep;
+	cached->frameCounter = CTimer::GetFrameCounter();
+	cached->numFrames = n;
+	cached->extractedMask = extractedMask;
+	for(int32 i = 0; i < n; i++)
+		cached->sequences[i] = nodes[i].sequence;
+	cached->pose = *pose;
+}
+#endif
+
+// Does what ForAllFrames with the FrameUpdateCallBacks does. Frames with velocity
+// extraction still go through the callbacks, all others are sampled first and
+// blended for all bones at once.
+void
+FrameUpdateAllFrames(CAnimBlendClumpData *clumpData, AnimBlendFrameUpdateData *updateData, bool skinned)
+{
+	static AnimBlendPoseSamples samples[ARRAY_SIZE(AnimBlendFrameUpdateData::nodes)];
+	static AnimBlendPose pose;
+	static bool extracted[MAX_POSE_BONES];
+	int32 i, k;
+	int32 n = clumpData->numFrames;
+	CAnimBlendNode **node;
+	const AnimBlendPose *result = &pose;
+
+	if(n > MAX_POSE_BONES){
+#ifdef PED_SKIN
+		if(skinned)
+			clumpData->ForAllFrames(FrameUpdateCallBackSkinned, updateData);
+		else
+#endif
+			clumpData->ForAllFrames(FrameUpdateCallBackNonSkinned, updateData);
+		return;
+	}
+
+	int32 numNodes = 0;
+	while(updateData->nodes[numNodes])
+		numNodes++;
+
+	for(i = 0; i < n; i++){
+		AnimBlendFrameData *frame = &clumpData->frames[i];
+		extracted[i] = frame->flag & AnimBlendFrameData::VELOCITY_EXTRACTION && gpAnimBlendClump->velocity2d;
+	}
+
+#ifdef SHARED_POSE_CACHE
+	AnimBlendCachedPose *cached = nil;
+	bool cacheHit = false;
+	int32 timeKey = 0;
+	uint64 extractedMask = 0;
+	CAnimBlendNode *firstNodes = updateData->nodes[0];
+	if(gbSharedPoseCache && updateData->poseTimeStep > 0.0f && numNodes == 1 &&
+	   !firstNodes->association->IsPartial() && firstNodes->association->blendAmount >= 1.0f){
+		for(i = 0; i < n; i++)
+			if(extracted[i])
+				extractedMask |= (uint64)1 << i;
+		timeKey = (int32)(firstNodes->association->currentTime / updateData->poseTimeStep);
+		cached = &aCachedPoses[((uintptr)firstNodes->association->hierarchy/sizeof(void*) + timeKey) & (POSE_CACHE_SIZE-1)];
+		cacheHit = IsCachedPose(cached, firstNodes, n, timeKey, updateData->poseTimeStep, extractedMask);
+	}
+#endif
+
+	for(i = 0; i < n; i++){
+		AnimBlendFrameData *frame = &clumpData->frames[i];
+		if(extracted[i]){
+#ifdef PED_SKIN
+			if(skinned)
+				FrameUpdateCallBackSkinned(frame, updateData);
+			else
+#endif
+				FrameUpdateCallBackNonSkinned(frame, updateData);
+			for(k = 0; k < numNodes; k++)
+				ClearSample(&samples[k], i);
+			continue;
+		}
+
+#ifdef SHARED_POSE_CACHE
+		if(cacheHit){
+			// only the time has to be advanced
+			for(node = updateData->nodes; *node; node++){
+				if((*node)->sequence)
+					(*node)->UpdateTime();
+				++*node;
+			}
+			continue;
+		}
+#endif
+
+		float totalBlendAmount = 0.0f;
+		if(updateData->foobar)
+			for(node = updateData->nodes; *node; node++)
+				if((*node)->sequence && (*node)->association->IsPartial())
+					totalBlendAmount += (*node)->association->blendAmount;
+
+		for(k = 0; k < numNodes; k++){
+			node = &updateData->nodes[k];
+			if((*node)->sequence)
+				SampleNode(*node, 1.0f-totalBlendAmount, &samples[k], i);
+			else
+				ClearSample(&samples[k], i);
+			++*node;
+		}
+	}
+
+#ifdef SHARED_POSE_CACHE
+	if(cacheHit)
+		result = &cached->pose;
+	else
+#endif
+	{
+		ClearPose(&pose, n);
+		for(k = 0; k < numNodes; k++)
+			AccumulatePose(&samples[k], &pose, n);
+		NormalisePose(&pose, n);
+#ifdef SHARED_POSE_CACHE
+		if(cached)
+			SetCachedPose(cached, firstNodes, n, timeKey, updateData->poseTimeStep, extractedMask, &pose);
+#endif
+	}
+
+	for(i = 0; i < n; i++){
+		if(extracted[i])
+			continue;
+		AnimBlendFrameData *frame = &clumpData->frames[i];
+#ifdef PED_SKIN
+		if(skinned){
+			RpHAnimStdInterpFrame *xform = frame->hanimFrame;
+			if((frame->flag & AnimBlendFrameData::IGNORE_ROTATION) == 0){
+				xform->q.imag.x = result->qx[i];
+				xform->q.imag.y = result->qy[i];
+				xform->q.imag.z = result->qz[i];
+				xform->q.real = result->qw[i];
+			}
+			if((frame->flag & AnimBlendFrameData::IGNORE_TRANSLATION) == 0){
+				xform->t.x = result->tx[i] + frame->resetPos.x;
+				xform->t.y = result->ty[i] + frame->resetPos.y;
+				xform->t.z = result->tz[i] + frame->resetPos.z;
+			}
+			continue;
+		}
+#endif
+		RwMatrix *mat = RwFrameGetMatrix(frame->frame);
+		if((frame->flag & AnimBlendFrameData::IGNORE_ROTATION) == 0){
+			RwMatrixSetIdentity(mat);
+			CQuaternion(result->qx[i], result->qy[i], result->qz[i], result->qw[i]).Get(mat);
+		}
+		if((frame->flag & AnimBlendFrameData::IGNORE_TRANSLATION) == 0){
+			mat->pos.x = result->tx[i] + frame->resetPos.x;
+			mat->pos.y = result->ty[i] + frame->resetPos.y;
+			mat->pos.z = result->tz[i] + frame->resetPos.z;
+		}
+		RwMatrixUpdate(mat);
+	}
+}
+
+// compare the pose kernels with the scalar code on random key frames
+void
+BenchmarkAnimBlend(void)
+{
+	const int32 numAssocs = 3;
+	const int32 numIterations = 100;
+	static AnimBlendPoseSamples samples[numAssocs];
+	static AnimBlendPose scalarPose, simdPose;
+	int32 i, j, k;
+
+	for(k = 0; k < numAssocs; k++){
+		AnimBlendPoseSamples *s = &samples[k];
+		for(i = 0; i < MAX_POSE_BONES; i++){
+			CQuaternion q1(CGeneral::GetRandomNumberInRange(-1.0f, 1.0f), CGeneral::GetRandomNumberInRange(-1.0f, 1.0f),
+				CGeneral::GetRandomNumberInRange(-1.0f, 1.0f), CGeneral::GetRandomNumberInRange(-1.0f, 1.0f));
+			CQuaternion q2(CGeneral::GetRandomNumberInRange(-1.0f, 1.0f), CGeneral::GetRandomNumberInRange(-1.0f, 1.0f),
+				CGeneral::GetRandomNumberInRange(-1.0f, 1.0f), CGeneral::GetRandomNumberInRange(-1.0f, 1.0f));
+			q1.Normalise();
+			q2.Normalise();
+			if(i % 8 == 0)
+				q2 = q1;
+			// same as CAnimBlendNode::CalcDeltas
+			float cos = Min(DotProduct(q1, q2), 1.0f);
+			s->theta[i] = Acos(cos);
+			s->invSin[i] = s->theta[i] == 0.0f ? 0.0f : 1.0f/Sin(s->theta[i]);
+			s->q1x[i] = q1.x; s->q1y[i] = q1.y; s->q1z[i] = q1.z; s->q1w[i] = q1.w;
+			s->q2x[i] = q2.x; s->q2y[i] = q2.y; s->q2z[i] = q2.z; s->q2w[i] = q2.w;
+			s->t[i] = CGeneral::GetRandomNumberInRange(0.0f, 1.0f);
+			s->rotBlend[i] = CGeneral::GetRandomNumberInRange(0.0f, 1.0f);
+			s->t1x[i] = CGeneral::GetRandomNumberInRange(-1.0f, 1.0f);
+			s->t1y[i] = CGeneral::GetRandomNumberInRange(-1.0f, 1.0f);
+			s->t1z[i] = CGeneral::GetRandomNumberInRange(-1.0f, 1.0f);
+			s->t2x[i] = CGeneral::GetRandomNumberInRange(-1.0f, 1.0f);
+			s->t2y[i] = CGeneral::GetRandomNumberInRange(-1.0f, 1.0f);
+			s->t2z[i] = CGeneral::GetRandomNumberInRange(-1.0f, 1.0f);
+			s->transBlend[i] = i % 4 == 0 ? s->rotBlend[i] : 0.0f;
+		}
+	}
+
+	uint32 start = CTimer::GetCurrentTimeInCycles();
+	for(j = 0; j < numIterations; j++){
+		ClearPose(&scalarPose, MAX_POSE_BONES);
+		for(k = 0; k < numAssocs; k++)
+			AccumulatePoseScalar(&samples[k], &scalarPose, 0, MAX_POSE_BONES);
+		NormalisePoseScalar(&scalarPose, 0, MAX_POSE_BONES);
+	}
+	uint32 mid = CTimer::GetCurrentTimeInCycles();
+	for(j = 0; j < numIterations; j++){
+		ClearPose(&simdPose, MAX_POSE_BONES);
+		for(k = 0; k < numAssocs; k++)
+			AccumulatePose(&samples[k], &simdPose, MAX_POSE_BONES);
+		NormalisePose(&simdPose, MAX_POSE_BONES);
+	}
+	uint32 end = CTimer::GetCurrentTimeInCycles();
+
+	float maxRotError = 0.0f, maxTransError = 0.0f;
+	for(i = 0; i < MAX_POSE_BONES; i++){
+		maxRotError = Max(maxRotError, Abs(scalarPose.qx[i] - simdPose.qx[i]));
+		maxRotError = Max(maxRotError, Abs(scalarPose.qy[i] - simdPose.qy[i]));
+		maxRotError = Max(maxRotError, Abs(scalarPose.qz[i] - simdPose.qz[i]));
+		maxRotError = Max(maxRotError, Abs(scalarPose.qw[i] - simdPose.qw[i]));
+		maxTransError = Max(maxTransError, Abs(scalarPose.tx[i] - simdPose.tx[i]));
+		maxTransError = Max(maxTransError, Abs(scalarPose.ty[i] - simdPose.ty[i]));
+		maxTransError = Max(maxTransError, Abs(scalarPose.tz[i] - simdPose.tz[i]));
+	}
+	float cyclesPerUs = CTimer::GetCyclesPerMillisecond() / 1000.0f;
+	debug("Anim blend benchmark: %d poses of %d bones from %d associations, scalar %.1fus, simd %.1fus, max error rot %g trans %g\n",
+		numIterations, MAX_POSE_BONES, numAssocs, (mid - start) / cyclesPerUs, (end - mid) / cyclesPerUs,
+		maxRotError, maxTransError);
+}
+
+#endif
+
+#ifdef PED_ANIM_LOD
+// Only advances the animations, the bones keep their pose. Frames with velocity
+// extraction are still updated so the clump moves as usual.
+void
+FrameUpdateAdvanceAllFrames(CAnimBlendClumpData *clumpData, AnimBlendFrameUpdateData *updateData, bool skinned)
+{
+	CAnimBlendNode **node;
+
+	for(int32 i = 0; i < clumpData->numFrames; i++){
+		AnimBlendFrameData *frame = &clumpData->frames[i];
+		if(frame->flag & AnimBlendFrameData::VELOCITY_EXTRACTION && gpAnimBlendClump->velocity2d){
+#ifdef PED_SKIN
+			if(skinned)
+				FrameUpdateCallBackSkinned(frame, updateData);
+			else
+#endif
+				FrameUpdateCallBackNonSkinned(frame, updateData);
+			continue;
+		}
+		for(node = updateData->nodes; *node; node++){
+			if((*node)->sequence)
+				(*node)->UpdateTime();
+			++*node;
+		}
+	}
+}
+#endif
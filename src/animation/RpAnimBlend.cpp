@@ -13,6 +13,9 @@
 #ifdef PED_SKIN
 #include "PedModelInfo.h"
 #endif
+#ifdef SHARED_POSE_CACHE
+#include "Camera.h"
+#endif
 
 RwInt32 ClumpOffset;
 
@@ -421,8 +424,14 @@ RpAnimBlendClumpFindFrame(RpClump *clump, const char *name)
 	return pFrameDataFound;
 }
 
+#ifdef PED_ANIM_LOD
+// doRender false only advances the animations, see FrameUpdateAdvanceAllFrames
+void
+RpAnimBlendClumpUpdateAnimations(RpClump *clump, float timeDelta, bool doRender)
+#else
 void
 RpAnimBlendClumpUpdateAnimations(RpClump *clump, float timeDelta)
+#endif
 {
 	int i;
 	AnimBlendFrameUpdateData updateData;
@@ -453,6 +462,35 @@ RpAnimBlendClumpUpdateAnimations(RpClump *clump, float timeDelta)
 	}
 	updateData.nodes[i] = nil;
 
+#ifdef SHARED_POSE_CACHE
+	// nobody will notice a slightly old pose on far away peds
+	float distSqr = (CVector(RwFrameGetLTM(RpClumpGetFrame(clump))->pos) - TheCamera.GetPosition()).MagnitudeSqr();
+	if(distSqr < CVisibilityPlugins::ms_pedLod0Dist)
+		updateData.poseTimeStep = 0.0f;
+	else if(distSqr < CVisibilityPlugins::ms_pedLod1Dist)
+		updateData.poseTimeStep = 1.0f/30.0f;
+	else
+		updateData.poseTimeStep = 1.0f/15.0f;
+#endif
+
+#ifdef PED_ANIM_LOD
+	if(!doRender){
+#ifdef PED_SKIN
+		FrameUpdateAdvanceAllFrames(clumpData, &updateData, IsClumpSkinned(clump));
+#else
+		FrameUpdateAdvanceAllFrames(clumpData, &updateData, false);
+#endif
+	}else
+#endif
+#ifdef SIMD_ANIM_BLEND
+	if(gbSimdAnimBlend){
+#ifdef PED_SKIN
+		FrameUpdateAllFrames(clumpData, &updateData, IsClumpSkinned(clump));
+#else
+		FrameUpdateAllFrames(clumpData, &updateData, false);
+#endif
+	}else
+#endif
 #ifdef PED_SKIN
 	if(IsClumpSkinned(clump))
 		clumpData->ForAllFrames(FrameUpdateCallBackSkinned, &updateData);
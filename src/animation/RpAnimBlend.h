@@ -9,6 +9,9 @@ struct AnimBlendFrameUpdateData
 {
 	int foobar;	// TODO: figure out what this actually means
 	CAnimBlendNode *nodes[16];
+#ifdef SHARED_POSE_CACHE
+	float poseTimeStep;	// times are rounded to this to share poses, 0 for no sharing
+#endif
 };
 
 extern RwInt32 ClumpOffset;
@@ -34,9 +37,53 @@ CAnimBlendAssociation *RpAnimBlendClumpGetMainAssociation_N(RpClump *clump, int
 CAnimBlendAssociation *RpAnimBlendClumpGetMainPartialAssociation_N(RpClump *clump, int n);
 CAnimBlendAssociation *RpAnimBlendClumpGetFirstAssociation(RpClump *clump, uint32 mask);
 CAnimBlendAssociation *RpAnimBlendClumpGetFirstAssociation(RpClump *clump);
+#ifdef PED_ANIM_LOD
+void RpAnimBlendClumpUpdateAnimations(RpClump* clump, float timeDelta, bool doRender = true);
+#else
 void RpAnimBlendClumpUpdateAnimations(RpClump* clump, float timeDelta);
+#endif
 
 
 extern CAnimBlendClumpData *gpAnimBlendClump;
 void FrameUpdateCallBackNonSkinned(AnimBlendFrameData *frame, void *arg);
 void FrameUpdateCallBackSkinned(AnimBlendFrameData *frame, void *arg);
+
+#ifdef SIMD_ANIM_BLEND
+// Not original.
+// The bones of a clump are sampled into arrays per association first,
+// then slerped, blended and normalised four at a time.
+#define MAX_POSE_BONES (64)
+
+// key frames of one association for all bones
+struct AnimBlendPoseSamples
+{
+	float q1x[MAX_POSE_BONES], q1y[MAX_POSE_BONES], q1z[MAX_POSE_BONES], q1w[MAX_POSE_BONES];	// previous key frame
+	float q2x[MAX_POSE_BONES], q2y[MAX_POSE_BONES], q2z[MAX_POSE_BONES], q2w[MAX_POSE_BONES];	// next key frame
+	float theta[MAX_POSE_BONES];
+	float invSin[MAX_POSE_BONES];
+	float t[MAX_POSE_BONES];
+	float rotBlend[MAX_POSE_BONES];		// 0 if there's no rotation
+	float t1x[MAX_POSE_BONES], t1y[MAX_POSE_BONES], t1z[MAX_POSE_BONES];
+	float t2x[MAX_POSE_BONES], t2y[MAX_POSE_BONES], t2z[MAX_POSE_BONES];
+	float transBlend[MAX_POSE_BONES];	// 0 if there's no translation
+};
+
+// blended local transforms of all bones
+struct AnimBlendPose
+{
+	float qx[MAX_POSE_BONES], qy[MAX_POSE_BONES], qz[MAX_POSE_BONES], qw[MAX_POSE_BONES];
+	float tx[MAX_POSE_BONES], ty[MAX_POSE_BONES], tz[MAX_POSE_BONES];
+};
+
+extern bool gbSimdAnimBlend;
+void FrameUpdateAllFrames(CAnimBlendClumpData *clumpData, AnimBlendFrameUpdateData *updateData, bool skinned);
+void BenchmarkAnimBlend(void);
+#endif
+
+#ifdef SHARED_POSE_CACHE
+extern bool gbSharedPoseCache;
+#endif
+
+#ifdef PED_ANIM_LOD
+void FrameUpdateAdvanceAllFrames(CAnimBlendClumpData *clumpData, AnimBlendFrameUpdateData *updateData, bool skinned);
+#endif
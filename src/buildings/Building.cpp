@@ -3,6 +3,7 @@
 #include "Building.h"
 #include "Streaming.h"
 #include "Pools.h"
+#include "World.h"
 
 void *CBuilding::operator new(size_t sz) throw() { return CPools::GetBuildingPool()->New();  }
 void CBuilding::operator delete(void *p, size_t sz) throw() { CPools::GetBuildingPool()->Delete((CBuilding*)p); }
@@ -12,10 +13,18 @@ CBuilding::ReplaceWithNewModel(int32 id)
 {
 	DeleteRwObject();
 
+	// take it out of the sectors while the bounds are those of the old model,
+	// the packed sector arrays cache them
+	if(!bIsBIGBuilding)
+		CWorld::Remove(this);
+
 	if (CModelInfo::GetModelInfo(m_modelIndex)->GetNumRefs() == 0)
 		CStreaming::RemoveModel(m_modelIndex);
 	m_modelIndex = id;
 
+	if(!bIsBIGBuilding)
+		CWorld::Add(this);
+
 	if(bIsBIGBuilding)
 		if(m_level == LEVEL_GENERIC || m_level == CGame::currLevel)
 			CStreaming::RequestModel(id, STREAMFLAGS_DONT_REMOVE);
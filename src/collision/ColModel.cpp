@@ -15,6 +15,9 @@ CColModel::CColModel(void)
 	vertices = nil;
 	triangles = nil;
 	trianglePlanes = nil;
+#ifdef MULTITHREADED_WORLD_QUERIES
+	trianglePlaneUsers = 0;
+#endif
 	level = CGame::currLevel;
 	ownsCollisionVolumes = true;
 }
@@ -23,6 +23,9 @@ struct CColModel
 	CompressedVector *vertices;
 	CColTriangle *triangles;
 	CColTrianglePlane *trianglePlanes;
+#ifdef MULTITHREADED_WORLD_QUERIES
+	int32 trianglePlaneUsers;	// queries using the planes, they aren't removed from the cache while > 0
+#endif
 
 	CColModel(void);
 	~CColModel(void);
@@ -22,6 +22,14 @@
 #include "Lines.h"
 #include "Collision.h"
 #include "Frontend.h"
+#include "WorkerThreads.h"
+
+#ifdef MULTITHREADED_WORLD_QUERIES
+#include <mutex>
+
+// guards the LRU list of triangle planes and their pin counts
+static std::mutex gTrianglePlaneCacheMutex;
+#endif
 
 #ifdef VU_COLLISION
 #include "VuCollision.h"
@@ -691,7 +699,11 @@ CCollision::TestLineOfSight(const CColLine &line, const CMatrix &matrix, CColMod
 			return true;
 	}
 
+#ifdef MULTITHREADED_WORLD_QUERIES
+	CTrianglePlanesPin pin(&model);
+#else
 	CalculateTrianglePlanes(&model);
+#endif
 	int lastTest = -1;
 	VuTriangle vutri;
 	for(i = 0; i < model.numTriangles; i++){
@@ -732,7 +744,7 @@ CCollision::TestLineOfSight(const CColLine &line, const CMatrix &matrix, CColMod
 
 	return false;
 #else
-	static CMatrix matTransform;
+	CMatrix matTransform;
 	int i;
 
 	// transform line to model space
@@ -755,7 +767,11 @@ CCollision::TestLineOfSight(const CColLine &line, const CMatrix &matrix, CColMod
 			return true;
 	}
 
+#ifdef MULTITHREADED_WORLD_QUERIES
+	CTrianglePlanesPin pin(&model);
+#else
 	CalculateTrianglePlanes(&model);
+#endif
 	for(i = 0; i < model.numTriangles; i++){
 		if(ignoreSeeThrough && IsSeeThrough(model.triangles[i].surface)) continue;
 		if(TestLineTriangle(newline, model.vertices, model.triangles[i], model.trianglePlanes[i]))
@@ -1513,7 +1529,11 @@ CCollision::ProcessLineOfSight(const CColLine &line,
 			point.Set(0, 0, model.boxes[i].surface, model.boxes[i].piece);
 	}
 
+#ifdef MULTITHREADED_WORLD_QUERIES
+	CTrianglePlanesPin pin(&model);
+#else
 	CalculateTrianglePlanes(&model);
+#endif
 	VuTriangle vutri;
 	CColTriangle *lasttri = nil;
 	for(i = 0; i < model.numTriangles; i++){
@@ -1572,7 +1592,7 @@ CCollision::ProcessLineOfSight(const CColLine &line,
 	}
 	return false;
 #else
-	static CMatrix matTransform;
+	CMatrix matTransform;
 	int i;
 
 	// transform line to model space
@@ -1594,7 +1614,11 @@ CCollision::ProcessLineOfSight(const CColLine &line,
 		ProcessLineBox(newline, model.boxes[i], point, coldist);
 	}
 
+#ifdef MULTITHREADED_WORLD_QUERIES
+	CTrianglePlanesPin pin(&model);
+#else
 	CalculateTrianglePlanes(&model);
+#endif
 	for(i = 0; i < model.numTriangles; i++){
 		if(ignoreSeeThrough && IsSeeThrough(model.triangles[i].surface)) continue;
 		ProcessLineTriangle(newline, model.vertices, model.triangles[i], model.trianglePlanes[i], point, coldist);
@@ -1644,7 +1668,11 @@ CCollision::ProcessVerticalLine(const CColLine &line,
 			point.Set(0, 0, model.boxes[i].surface, model.boxes[i].piece);
 	}
 
+#ifdef MULTITHREADED_WORLD_QUERIES
+	CTrianglePlanesPin pin(&model);
+#else
 	CalculateTrianglePlanes(&model);
+#endif
 	TempStoredPoly.valid = false;
 	if(model.numTriangles){
 		bool registeredCol;
@@ -1734,7 +1762,7 @@ CCollision::ProcessVerticalLine(const CColLine &line,
 	}
 	return false;
 #else
-	static CStoredCollPoly TempStoredPoly;
+	CStoredCollPoly TempStoredPoly;
 	int i;
 
 	// transform line to model space
@@ -1757,7 +1785,11 @@ CCollision::ProcessVerticalLine(const CColLine &line,
 		ProcessLineBox(newline, model.boxes[i], point, coldist);
 	}
 
+#ifdef MULTITHREADED_WORLD_QUERIES
+	CTrianglePlanesPin pin(&model);
+#else
 	CalculateTrianglePlanes(&model);
+#endif
 	TempStoredPoly.valid = false;
 	for(i = 0; i < model.numTriangles; i++){
 		if(ignoreSeeThrough && IsSeeThrough(model.triangles[i].surface)) continue;
@@ -1863,7 +1895,11 @@ CCollision::ProcessColModels(const CMatrix &matrixA, CColModel &modelA,
 	for(i = 0; i < modelB.numBoxes; i++)
 		if(TestSphereBox(*(CColSphere*)&bsphereAB, modelB.boxes[i]))
 			aBoxIndicesB[numBoxesB++] = i;
+#ifdef MULTITHREADED_WORLD_QUERIES
+	CTrianglePlanesPin pin(&modelB);
+#else
 	CalculateTrianglePlanes(&modelB);
+#endif
 	if(modelB.numTriangles){
 		VuTriangle vutri;
 		// process the first triangle
@@ -2107,15 +2143,16 @@ CCollision::ProcessColModels(const CMatrix &matrixA, CColModel &modelA,
 
 	return numCollisions;	// sphere collisions
 #else
-	static int aSphereIndicesA[MAXNUMSPHERES];
-	static int aLineIndicesA[MAXNUMLINES];
-	static int aSphereIndicesB[MAXNUMSPHERES];
-	static int aBoxIndicesB[MAXNUMBOXES];
-	static int aTriangleIndicesB[MAXNUMTRIS];
-	static bool aCollided[MAXNUMLINES];
-	static CColSphere aSpheresA[MAXNUMSPHERES];
-	static CColLine aLinesA[MAXNUMLINES];
-	static CMatrix matAB, matBA;
+	// on the stack so TestSphereAgainstWorld can run on several threads
+	int aSphereIndicesA[MAXNUMSPHERES];
+	int aLineIndicesA[MAXNUMLINES];
+	int aSphereIndicesB[MAXNUMSPHERES];
+	int aBoxIndicesB[MAXNUMBOXES];
+	int aTriangleIndicesB[MAXNUMTRIS];
+	bool aCollided[MAXNUMLINES];
+	CColSphere aSpheresA[MAXNUMSPHERES];
+	CColLine aLinesA[MAXNUMLINES];
+	CMatrix matAB, matBA;
 	CColSphere s;
 	int i, j;
 
@@ -2169,7 +2206,11 @@ CCollision::ProcessColModels(const CMatrix &matrixA, CColModel &modelA,
 	for(i = 0; i < modelB.numBoxes; i++)
 		if(TestSphereBox(bsphereAB, modelB.boxes[i]))
 			aBoxIndicesB[numBoxesB++] = i;
+#ifdef MULTITHREADED_WORLD_QUERIES
+	CTrianglePlanesPin pin(&modelB);
+#else
 	CalculateTrianglePlanes(&modelB);
+#endif
 	for(i = 0; i < modelB.numTriangles; i++)
 		if(TestSphereTriangle(bsphereAB, modelB.vertices, modelB.triangles[i], modelB.trianglePlanes[i]))
 			aTriangleIndicesB[numTrianglesB++] = i;
@@ -2287,37 +2328,111 @@ CCollision::DistToLine(const CVector *l0, const CVector *l1, const CVector *poin
 	return (*point - closest).Magnitude();
 }
 
-void
-CCollision::CalculateTrianglePlanes(CColModel *model)
+static void
+CacheTrianglePlanes(CColModel *model)
 {
-	assert(model);
-	if(model->numTriangles == 0)
-		return;
-
+	CLinkList<CColModel*> &cache = CCollision::ms_colModelCache;
 	CLink<CColModel*> *lptr;
-	if(model->trianglePlanes){
+	// planes without a link were calculated while the cache was full
+	if(model->trianglePlanes && model->GetLinkPtr()){
 		// re-insert at front so it's not removed again soon
 		lptr = model->GetLinkPtr();
 		lptr->Remove();
-		ms_colModelCache.head.Insert(lptr);
+		cache.head.Insert(lptr);
 	}else{
-		lptr = ms_colModelCache.Insert(model);
+		lptr = cache.Insert(model);
 		if(lptr == nil){
 			// make room if we have to, remove last in list
-			lptr = ms_colModelCache.tail.prev;
+			lptr = cache.tail.prev;
+#ifdef MULTITHREADED_WORLD_QUERIES
+			// but not planes that some query is still using
+			while(lptr != &cache.head && lptr->item->trianglePlaneUsers > 0)
+				lptr = lptr->prev;
+			if(lptr == &cache.head){
+				// all of them are, keep these out of the cache
+				// until there's room again
+				if(model->trianglePlanes == nil)
+					model->CalculateTrianglePlanes();
+				model->SetLinkPtr(nil);
+				return;
+			}
+#endif
 			assert(lptr);
 			assert(lptr->item);
 			lptr->item->RemoveTrianglePlanes();
-			ms_colModelCache.Remove(lptr);
+			cache.Remove(lptr);
 			// now this cannot fail
-			lptr = ms_colModelCache.Insert(model);
+			lptr = cache.Insert(model);
 			assert(lptr);
 		}
-		model->CalculateTrianglePlanes();
+		if(model->trianglePlanes == nil)
+			model->CalculateTrianglePlanes();
 		model->SetLinkPtr(lptr);
 	}
 }
 
+void
+CCollision::CalculateTrianglePlanes(CColModel *model)
+{
+	assert(model);
+	if(model->numTriangles == 0)
+		return;
+
+#ifdef MULTITHREADED_WORLD_QUERIES
+	// only worker jobs can use the cache at the same time as the main thread
+	if(CWorkerThreads::IsRunning()){
+		std::lock_guard<std::mutex> lock(gTrianglePlaneCacheMutex);
+		CacheTrianglePlanes(model);
+		return;
+	}
+#endif
+	CacheTrianglePlanes(model);
+}
+
+#ifdef MULTITHREADED_WORLD_QUERIES
+void
+CCollision::PinTrianglePlanes(CColModel *model)
+{
+	assert(model);
+	if(model->numTriangles == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(gTrianglePlaneCacheMutex);
+	CacheTrianglePlanes(model);
+	model->trianglePlaneUsers++;
+}
+
+void
+CCollision::UnpinTrianglePlanes(CColModel *model)
+{
+	if(model->numTriangles == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(gTrianglePlaneCacheMutex);
+	assert(model->trianglePlaneUsers > 0);
+	model->trianglePlaneUsers--;
+}
+
+// Pinning costs two locks, so it's only done while worker jobs are running.
+// Outside of CWorkerThreads::Run only the main thread uses the cache.
+CTrianglePlanesPin::CTrianglePlanesPin(CColModel *model)
+{
+	if(CWorkerThreads::IsRunning()){
+		m_model = model;
+		CCollision::PinTrianglePlanes(model);
+	}else{
+		m_model = nil;
+		CCollision::CalculateTrianglePlanes(model);
+	}
+}
+
+CTrianglePlanesPin::~CTrianglePlanesPin(void)
+{
+	if(m_model)
+		CCollision::UnpinTrianglePlanes(m_model);
+}
+#endif
+
 void
 CCollision::DrawColModel(const CMatrix &mat, const CColModel &colModel)
 {
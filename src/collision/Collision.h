@@ -23,6 +23,21 @@ struct CStoredCollPoly
 #define MAX_COLLISION_POINTS 32
 #endif
 
+#ifdef MULTITHREADED_WORLD_QUERIES
+// Not original.
+// Calculates the triangle planes of a model and keeps them in the cache
+// until it goes out of scope, so a query on another thread can't remove
+// them while they're still being used. Only pins while worker jobs are
+// running, the main thread alone can't pull the planes from under itself.
+class CTrianglePlanesPin
+{
+	CColModel *m_model;
+public:
+	CTrianglePlanesPin(CColModel *model);
+	~CTrianglePlanesPin(void);
+};
+#endif
+
 class CCollision
 {
 public:
@@ -42,6 +57,10 @@ public:
 	static void DrawColModel_Coloured(const CMatrix &mat, const CColModel &colModel, int32 id);
 
 	static void CalculateTrianglePlanes(CColModel *model);
+#ifdef MULTITHREADED_WORLD_QUERIES
+	static void PinTrianglePlanes(CColModel *model);
+	static void UnpinTrianglePlanes(CColModel *model);
+#endif
 
 	// all these return true if there's a collision
 	static bool TestSphereSphere(const CColSphere &s1, const CColSphere &s2);
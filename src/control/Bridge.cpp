@@ -5,6 +5,7 @@
 #include "ModelIndices.h"
 #include "PathFind.h"
 #include "Stats.h"
+#include "GroundCache.h"
 
 CEntity *CBridge::pLiftRoad;
 CEntity *CBridge::pLiftPart;
@@ -106,6 +107,18 @@ void CBridge::Update()
 		pWeight->GetMatrix().UpdateRW();
 		pWeight->UpdateRwFrame();
 
+		// the sector arrays cache the bounds of buildings
+		pLiftPart->UpdateSectorBounds();
+		if (pLiftRoad)
+			pLiftRoad->UpdateSectorBounds();
+		pWeight->UpdateSectorBounds();
+#ifdef GROUND_HEIGHT_CACHE
+		CGroundCache::InvalidateArea(pLiftPart->GetBoundRect());
+		if (pLiftRoad)
+			CGroundCache::InvalidateArea(pLiftRoad->GetBoundRect());
+		CGroundCache::InvalidateArea(pWeight->GetBoundRect());
+#endif
+
 		OldLift = liftHeight;
 	}
 
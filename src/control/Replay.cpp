@@ -1134,8 +1134,10 @@ void CReplay::StoreStuffInMem(void)
 	CPools::GetPtrNodePool()->Store(pBuf6, pBuf7);
 	CPools::GetEntryInfoNodePool()->Store(pBuf8, pBuf9);
 	CPools::GetDummyPool()->Store(pBuf10, pBuf11);
-	pWorld1 = new uint8[sizeof(CSector) * NUMSECTORS_X * NUMSECTORS_Y];
-	memcpy(pWorld1, CWorld::GetSector(0, 0), NUMSECTORS_X * NUMSECTORS_Y * sizeof(CSector));
+	// only the lists, the packed arrays own heap memory and are rebuilt on restore
+	pWorld1 = new uint8[sizeof(CSector::m_lists) * NUMSECTORS_X * NUMSECTORS_Y];
+	for (int i = 0; i < NUMSECTORS_X * NUMSECTORS_Y; i++)
+		memcpy(&pWorld1[i * sizeof(CSector::m_lists)], CWorld::GetSector(i % NUMSECTORS_X, i / NUMSECTORS_X)->m_lists, sizeof(CSector::m_lists));
 	WorldPtrList = CWorld::GetMovingEntityList().first; // why
 	BigBuildingPtrList = CWorld::GetBigBuildingList(LEVEL_GENERIC).first;
 	pPickups = new uint8[sizeof(CPickup) * NUMPICKUPS];
@@ -1190,9 +1192,11 @@ void CReplay::RestoreStuffFromMem(void)
 	CPools::GetPtrNodePool()->CopyBack(pBuf6, pBuf7);
 	CPools::GetEntryInfoNodePool()->CopyBack(pBuf8, pBuf9);
 	CPools::GetDummyPool()->CopyBack(pBuf10, pBuf11);
-	memcpy(CWorld::GetSector(0, 0), pWorld1, sizeof(CSector) * NUMSECTORS_X * NUMSECTORS_Y);
+	for (int i = 0; i < NUMSECTORS_X * NUMSECTORS_Y; i++)
+		memcpy(CWorld::GetSector(i % NUMSECTORS_X, i / NUMSECTORS_X)->m_lists, &pWorld1[i * sizeof(CSector::m_lists)], sizeof(CSector::m_lists));
 	delete[] pWorld1;
 	pWorld1 = nil;
+	CWorld::RebuildSectorArrays();
 	CWorld::GetMovingEntityList().first = WorldPtrList;
 	CWorld::GetBigBuildingList(LEVEL_GENERIC).first = BigBuildingPtrList;
 	memcpy(CPickups::aPickUps, pPickups, sizeof(CPickup) * NUMPICKUPS);
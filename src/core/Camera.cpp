@@ -33,6 +33,14 @@
 #include "MemoryCard.h"
 #include "Camera.h"
 
+#if defined __SSE__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 1)
+#define SPHERES_VISIBLE_SSE
+#include <xmmintrin.h>
+#elif defined __ARM_NEON
+#define SPHERES_VISIBLE_NEON
+#include <arm_neon.h>
+#endif
+
 enum
 {
 	// car
@@ -3685,6 +3693,92 @@ CCamera::IsSphereVisible(const CVector &center, float radius)
 #endif
 }
 
+// Same test as IsSphereVisible with m_cameraMatrix, four spheres at a time
+// where SSE or NEON are available. Sets visible[i] to 1 or 0 and returns
+// how many are visible.
+int32
+CCamera::AreSpheresVisible(const float *x, const float *y, const float *z, const float *radius, int32 n, uint8 *visible)
+{
+	const CMatrix &m = m_cameraMatrix;
+	float nearZ = CDraw::GetNearClipZ();
+	float farZ = CDraw::GetFarClipZ();
+	int32 numVisible = 0;
+	int32 i = 0;
+
+#if defined SPHERES_VISIBLE_SSE
+	__m128 rx = _mm_set1_ps(m.rx), fx = _mm_set1_ps(m.fx), ux = _mm_set1_ps(m.ux), px = _mm_set1_ps(m.px);
+	__m128 ry = _mm_set1_ps(m.ry), fy = _mm_set1_ps(m.fy), uy = _mm_set1_ps(m.uy), py = _mm_set1_ps(m.py);
+	__m128 rz = _mm_set1_ps(m.rz), fz = _mm_set1_ps(m.fz), uz = _mm_set1_ps(m.uz), pz = _mm_set1_ps(m.pz);
+	__m128 n0x = _mm_set1_ps(m_vecFrustumNormals[0].x), n0y = _mm_set1_ps(m_vecFrustumNormals[0].y);
+	__m128 n1x = _mm_set1_ps(m_vecFrustumNormals[1].x), n1y = _mm_set1_ps(m_vecFrustumNormals[1].y);
+	__m128 n2y = _mm_set1_ps(m_vecFrustumNormals[2].y), n2z = _mm_set1_ps(m_vecFrustumNormals[2].z);
+	__m128 n3y = _mm_set1_ps(m_vecFrustumNormals[3].y), n3z = _mm_set1_ps(m_vecFrustumNormals[3].z);
+	__m128 nearv = _mm_set1_ps(nearZ), farv = _mm_set1_ps(farZ);
+	for(; i + 4 <= n; i += 4){
+		__m128 vx = _mm_loadu_ps(&x[i]);
+		__m128 vy = _mm_loadu_ps(&y[i]);
+		__m128 vz = _mm_loadu_ps(&z[i]);
+		__m128 r = _mm_loadu_ps(&radius[i]);
+		__m128 cx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, vx), _mm_mul_ps(fx, vy)), _mm_mul_ps(ux, vz)), px);
+		__m128 cy = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ry, vx), _mm_mul_ps(fy, vy)), _mm_mul_ps(uy, vz)), py);
+		__m128 cz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rz, vx), _mm_mul_ps(fz, vy)), _mm_mul_ps(uz, vz)), pz);
+		__m128 out = _mm_cmplt_ps(_mm_add_ps(cy, r), nearv);
+		out = _mm_or_ps(out, _mm_cmpgt_ps(_mm_sub_ps(cy, r), farv));
+		out = _mm_or_ps(out, _mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(cx, n0x), _mm_mul_ps(cy, n0y)), r));
+		out = _mm_or_ps(out, _mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(cx, n1x), _mm_mul_ps(cy, n1y)), r));
+		out = _mm_or_ps(out, _mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(cy, n2y), _mm_mul_ps(cz, n2z)), r));
+		out = _mm_or_ps(out, _mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(cy, n3y), _mm_mul_ps(cz, n3z)), r));
+		int mask = _mm_movemask_ps(out);
+		for(int32 j = 0; j < 4; j++){
+			visible[i+j] = !(mask & (1<<j));
+			numVisible += visible[i+j];
+		}
+	}
+#elif defined SPHERES_VISIBLE_NEON
+	float32x4_t rx = vdupq_n_f32(m.rx), fx = vdupq_n_f32(m.fx), ux = vdupq_n_f32(m.ux), px = vdupq_n_f32(m.px);
+	float32x4_t ry = vdupq_n_f32(m.ry), fy = vdupq_n_f32(m.fy), uy = vdupq_n_f32(m.uy), py = vdupq_n_f32(m.py);
+	float32x4_t rz = vdupq_n_f32(m.rz), fz = vdupq_n_f32(m.fz), uz = vdupq_n_f32(m.uz), pz = vdupq_n_f32(m.pz);
+	float32x4_t n0x = vdupq_n_f32(m_vecFrustumNormals[0].x), n0y = vdupq_n_f32(m_vecFrustumNormals[0].y);
+	float32x4_t n1x = vdupq_n_f32(m_vecFrustumNormals[1].x), n1y = vdupq_n_f32(m_vecFrustumNormals[1].y);
+	float32x4_t n2y = vdupq_n_f32(m_vecFrustumNormals[2].y), n2z = vdupq_n_f32(m_vecFrustumNormals[2].z);
+	float32x4_t n3y = vdupq_n_f32(m_vecFrustumNormals[3].y), n3z = vdupq_n_f32(m_vecFrustumNormals[3].z);
+	float32x4_t nearv = vdupq_n_f32(nearZ), farv = vdupq_n_f32(farZ);
+	for(; i + 4 <= n; i += 4){
+		float32x4_t vx = vld1q_f32(&x[i]);
+		float32x4_t vy = vld1q_f32(&y[i]);
+		float32x4_t vz = vld1q_f32(&z[i]);
+		float32x4_t r = vld1q_f32(&radius[i]);
+		// no fused multiply-add so we get what the scalar code gets
+		float32x4_t cx = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_f32(rx, vx), vmulq_f32(fx, vy)), vmulq_f32(ux, vz)), px);
+		float32x4_t cy = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_f32(ry, vx), vmulq_f32(fy, vy)), vmulq_f32(uy, vz)), py);
+		float32x4_t cz = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_f32(rz, vx), vmulq_f32(fz, vy)), vmulq_f32(uz, vz)), pz);
+		uint32x4_t out = vcltq_f32(vaddq_f32(cy, r), nearv);
+		out = vorrq_u32(out, vcgtq_f32(vsubq_f32(cy, r), farv));
+		out = vorrq_u32(out, vcgtq_f32(vaddq_f32(vmulq_f32(cx, n0x), vmulq_f32(cy, n0y)), r));
+		out = vorrq_u32(out, vcgtq_f32(vaddq_f32(vmulq_f32(cx, n1x), vmulq_f32(cy, n1y)), r));
+		out = vorrq_u32(out, vcgtq_f32(vaddq_f32(vmulq_f32(cy, n2y), vmulq_f32(cz, n2z)), r));
+		out = vorrq_u32(out, vcgtq_f32(vaddq_f32(vmulq_f32(cy, n3y), vmulq_f32(cz, n3z)), r));
+		visible[i+0] = vgetq_lane_u32(out, 0) == 0;
+		visible[i+1] = vgetq_lane_u32(out, 1) == 0;
+		visible[i+2] = vgetq_lane_u32(out, 2) == 0;
+		visible[i+3] = vgetq_lane_u32(out, 3) == 0;
+		numVisible += visible[i+0] + visible[i+1] + visible[i+2] + visible[i+3];
+	}
+#endif
+
+	for(; i < n; i++){
+		CVector c = m * CVector(x[i], y[i], z[i]);
+		float r = radius[i];
+		visible[i] = !(c.y + r < nearZ || c.y - r > farZ ||
+			c.x*m_vecFrustumNormals[0].x + c.y*m_vecFrustumNormals[0].y > r ||
+			c.x*m_vecFrustumNormals[1].x + c.y*m_vecFrustumNormals[1].y > r ||
+			c.y*m_vecFrustumNormals[2].y + c.z*m_vecFrustumNormals[2].z > r ||
+			c.y*m_vecFrustumNormals[3].y + c.z*m_vecFrustumNormals[3].z > r);
+		numVisible += visible[i];
+	}
+	return numVisible;
+}
+
 bool
 CCamera::IsBoxVisible(CVUVECTOR *box, const CMatrix *mat)
 {
@@ -642,6 +642,8 @@ public:
 	bool IsSphereVisible(const CVector &center, float radius, Const CMatrix *mat);
 	bool IsSphereVisible(const CVector &center, float radius);
 	bool IsBoxVisible(CVUVECTOR *box, const CMatrix *mat);
+	// not original, IsSphereVisible for n spheres in SoA layout
+	int32 AreSpheresVisible(const float *x, const float *y, const float *z, const float *radius, int32 n, uint8 *visible);
 };
 
 VALIDATE_SIZE(CCamera, 0xE9D8);
@@ -78,6 +78,7 @@
 #include "Weapon.h"
 #include "WeaponEffects.h"
 #include "Weather.h"
+#include "WorkerThreads.h"
 #include "World.h"
 #include "ZoneCull.h"
 #include "Zones.h"
@@ -160,6 +161,7 @@ CGame::InitialiseOnceBeforeRW(void)
 {
 	CFileMgr::Initialise();
 	CdStreamInit(MAX_CDCHANNELS);
+	CWorkerThreads::Init();
 	ValidateVersion();
 #ifdef EXTENDED_COLOURFILTER
 	CPostFX::InitOnce();
@@ -390,6 +392,7 @@ CGame::FinalShutdown(void)
 	CTxdStore::Shutdown();
 	CPedStats::Shutdown();
 	CdStreamShutdown();
+	CWorkerThreads::Shutdown();
 }
 
 #if GTA_VERSION <= GTA3_PS2_160
@@ -0,0 +1,203 @@
+#include "common.h"
+
+#include "ModelInfo.h"
+#include "GroundCache.h"
+
+tGroundCacheSector *CGroundCache::ms_apSectors[NUMSECTORS_Y][NUMSECTORS_X];
+tGroundCacheSector *CGroundCache::ms_apCachedSectors[GROUNDCACHE_MAX_SECTORS];
+int32 CGroundCache::ms_nNumSectors;
+uint32 CGroundCache::ms_nUseCounter;
+eLevelName CGroundCache::ms_nCollisionLevel = LEVEL_GENERIC;
+bool CGroundCache::bEnabled = true;
+
+void
+CGroundCache::Flush(void)
+{
+	while(ms_nNumSectors > 0)
+		RemoveSector(ms_nNumSectors-1);
+}
+
+void
+CGroundCache::RemoveSector(int32 i)
+{
+	tGroundCacheSector *sector = ms_apCachedSectors[i];
+	ms_apSectors[sector->y][sector->x] = nil;
+	delete sector;
+	ms_apCachedSectors[i] = ms_apCachedSectors[--ms_nNumSectors];
+}
+
+void
+CGroundCache::InvalidateArea(const CRect &rect)
+{
+	if(ms_nNumSectors == 0)
+		return;
+
+	int xstart = Max(CWorld::GetSectorIndexX(rect.left), 0);
+	int xend = Min(CWorld::GetSectorIndexX(rect.right), NUMSECTORS_X - 1);
+	int ystart = Max(CWorld::GetSectorIndexY(rect.top), 0);
+	int yend = Min(CWorld::GetSectorIndexY(rect.bottom), NUMSECTORS_Y - 1);
+	for(int y = ystart; y <= yend; y++)
+		for(int x = xstart; x <= xend; x++){
+			tGroundCacheSector *sector = ms_apSectors[y][x];
+			if(sector == nil)
+				continue;
+			// cells that may overlap the rect
+			float cellX = CWorld::GetWorldX(x);
+			float cellY = CWorld::GetWorldY(y);
+			int cxstart = Max((int)((rect.left - cellX) / GROUNDCACHE_CELL_SIZE - 0.5f), 0);
+			int cxend = Min((int)((rect.right - cellX) / GROUNDCACHE_CELL_SIZE + 0.5f), GROUNDCACHE_CELLS_PER_SECTOR - 1);
+			int cystart = Max((int)((rect.top - cellY) / GROUNDCACHE_CELL_SIZE - 0.5f), 0);
+			int cyend = Min((int)((rect.bottom - cellY) / GROUNDCACHE_CELL_SIZE + 0.5f), GROUNDCACHE_CELLS_PER_SECTOR - 1);
+			for(int cy = cystart; cy <= cyend; cy++)
+				for(int cx = cxstart; cx <= cxend; cx++)
+					sector->cells[cy][cx].numSurfaces = -1;
+		}
+}
+
+tGroundCacheCell*
+CGroundCache::GetCell(float x, float y)
+{
+	// heights depend on which collision is loaded
+	if(ms_nCollisionLevel != CCollision::ms_collisionInMemory){
+		Flush();
+		ms_nCollisionLevel = CCollision::ms_collisionInMemory;
+	}
+
+	int sx = CWorld::GetSectorIndexX(x);
+	int sy = CWorld::GetSectorIndexY(y);
+	if(sx < 0 || sx >= NUMSECTORS_X || sy < 0 || sy >= NUMSECTORS_Y)
+		return nil;
+
+	tGroundCacheSector *sector = ms_apSectors[sy][sx];
+	if(sector == nil){
+		if(ms_nNumSectors >= GROUNDCACHE_MAX_SECTORS){
+			// throw away the one that wasn't used for the longest time
+			int32 oldest = 0;
+			for(int32 i = 1; i < ms_nNumSectors; i++)
+				if(ms_apCachedSectors[i]->lastUsed < ms_apCachedSectors[oldest]->lastUsed)
+					oldest = i;
+			RemoveSector(oldest);
+		}
+		sector = new tGroundCacheSector;
+		sector->x = sx;
+		sector->y = sy;
+		for(int cy = 0; cy < GROUNDCACHE_CELLS_PER_SECTOR; cy++)
+			for(int cx = 0; cx < GROUNDCACHE_CELLS_PER_SECTOR; cx++)
+				sector->cells[cy][cx].numSurfaces = -1;
+		ms_apSectors[sy][sx] = sector;
+		ms_apCachedSectors[ms_nNumSectors++] = sector;
+	}
+	sector->lastUsed = ms_nUseCounter++;
+
+	int cx = Clamp((int)((x - CWorld::GetWorldX(sx)) / GROUNDCACHE_CELL_SIZE), 0, GROUNDCACHE_CELLS_PER_SECTOR - 1);
+	int cy = Clamp((int)((y - CWorld::GetWorldY(sy)) / GROUNDCACHE_CELL_SIZE), 0, GROUNDCACHE_CELLS_PER_SECTOR - 1);
+	tGroundCacheCell *cell = &sector->cells[cy][cx];
+	if(cell->numSurfaces < 0)
+		FillCell(cell, CWorld::GetSector(sx, sy),
+			CWorld::GetWorldX(sx) + cx * GROUNDCACHE_CELL_SIZE,
+			CWorld::GetWorldY(sy) + cy * GROUNDCACHE_CELL_SIZE);
+	return cell;
+}
+
+// Adds the triangles of the entities in list that overlap rect.
+// Returns false if they can't all be stored.
+bool
+CGroundCache::AddSurfaces(tGroundCacheCell *cell, CSectorEntityArray &list, CRect &rect)
+{
+	for(int32 i = 0; i < list.numEntries; i++){
+		CEntity *e = list.entities[i];
+		if(!e->bUsesCollision)
+			continue;
+		CVector centre = e->GetBoundCentre();
+		if(!rect.IsPointInside(centre, e->GetBoundRadius()))
+			continue;
+
+		CColModel *colmodel = CModelInfo::GetColModel(e->GetModelIndex());
+		const CMatrix &mat = e->GetMatrix();
+		int32 j;
+
+		// ProcessVerticalLine hits these too, but they can't be stored
+		for(j = 0; j < colmodel->numSpheres; j++)
+			if(rect.IsPointInside(mat * colmodel->spheres[j].center, colmodel->spheres[j].radius))
+				return false;
+		for(j = 0; j < colmodel->numBoxes; j++){
+			CColBox &box = colmodel->boxes[j];
+			if(rect.IsPointInside(mat * ((box.min + box.max)*0.5f), (box.max - box.min).Magnitude()*0.5f))
+				return false;
+		}
+
+		for(j = 0; j < colmodel->numTriangles; j++){
+			CColTriangle &tri = colmodel->triangles[j];
+			CVector a = mat * colmodel->vertices[tri.a].Get();
+			CVector b = mat * colmodel->vertices[tri.b].Get();
+			CVector c = mat * colmodel->vertices[tri.c].Get();
+			if(Max(a.x, Max(b.x, c.x)) < rect.left || Min(a.x, Min(b.x, c.x)) > rect.right ||
+			   Max(a.y, Max(b.y, c.y)) < rect.top || Min(a.y, Min(b.y, c.y)) > rect.bottom)
+				continue;
+			if(cell->numSurfaces >= GROUNDCACHE_MAX_SURFACES)
+				return false;
+			tGroundCacheSurface *surf = &cell->surfaces[cell->numSurfaces++];
+			surf->poly.verts[0] = a;
+			surf->poly.verts[1] = b;
+			surf->poly.verts[2] = c;
+			surf->poly.valid = true;
+			surf->bDummy = e->IsDummy();
+		}
+	}
+	return true;
+}
+
+// x and y are the low corner of the cell
+void
+CGroundCache::FillCell(tGroundCacheCell *cell, CSector *sector, float x, float y)
+{
+	// a bit bigger so nothing is lost to rounding at the borders
+	CRect rect(x - 0.01f, y - 0.01f, x + GROUNDCACHE_CELL_SIZE + 0.01f, y + GROUNDCACHE_CELL_SIZE + 0.01f);
+
+	// the same lists ProcessVerticalLine looks at
+	cell->numSurfaces = 0;
+	cell->bComplete = AddSurfaces(cell, sector->m_arrays[ENTITYLIST_BUILDINGS], rect) &&
+		AddSurfaces(cell, sector->m_arrays[ENTITYLIST_BUILDINGS_OVERLAP], rect) &&
+		AddSurfaces(cell, sector->m_arrays[ENTITYLIST_DUMMIES], rect) &&
+		AddSurfaces(cell, sector->m_arrays[ENTITYLIST_DUMMIES_OVERLAP], rect);
+	if(!cell->bComplete)
+		cell->numSurfaces = 0;
+}
+
+// Surface a vertical line from z meets first, going down or up for bRoof.
+// Returns false if the cache can't tell.
+bool
+CGroundCache::FindZ(float x, float y, float z, bool bDummies, bool bRoof, float &resultZ, bool &bFound)
+{
+	if(!bEnabled || z > 1000.0f || z < -1000.0f)
+		return false;
+
+	tGroundCacheCell *cell = GetCell(x, y);
+	if(cell == nil || !cell->bComplete)
+		return false;
+
+	CColPoint point;
+	CStoredCollPoly poly;
+	bool bHave = false;
+	float best = 0.0f;
+	for(int i = 0; i < cell->numSurfaces; i++){
+		tGroundCacheSurface *surf = &cell->surfaces[i];
+		if(surf->bDummy && !bDummies)
+			continue;
+		// overlapping the cell doesn't mean it's under this point
+		poly = surf->poly;
+		if(!CCollision::IsStoredPolyStillValidVerticalLine(CVector(x, y, 1000.0f), -1000.0f, point, &poly))
+			continue;
+		float surfZ = point.point.z;
+		if(bRoof ? surfZ < z : surfZ > z)
+			continue;
+		if(!bHave || (bRoof ? surfZ < best : surfZ > best)){
+			best = surfZ;
+			bHave = true;
+		}
+	}
+
+	bFound = bHave;
+	resultZ = best;
+	return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "World.h"
+
+// Not original.
+// Remembers which collision triangles overlap the cells of a grid, so
+// FindGroundZForCoord and friends only have to test a handful of triangles
+// at the exact query position instead of walking the sector lists.
+// A cell that's overlapped by too many triangles, or by a collision sphere
+// or box, isn't cached and goes through ProcessVerticalLine as before.
+// Only buildings and dummies are cached, the world queries that use the
+// cache don't look at anything else.
+
+#define GROUNDCACHE_CELL_SIZE (2.0f)
+#define GROUNDCACHE_CELLS_PER_SECTOR (20)	// SECTOR_SIZE_X / GROUNDCACHE_CELL_SIZE
+#define GROUNDCACHE_MAX_SURFACES (6)		// enough for kerbs, bridges and tunnels
+#define GROUNDCACHE_MAX_SECTORS (32)		// least recently used ones are thrown away
+
+struct tGroundCacheSurface
+{
+	CStoredCollPoly poly;	// in world space
+	bool bDummy;
+};
+
+struct tGroundCacheCell
+{
+	int8 numSurfaces;	// -1 if not filled yet
+	bool bComplete;		// all surfaces overlapping the cell are stored
+	tGroundCacheSurface surfaces[GROUNDCACHE_MAX_SURFACES];
+};
+
+struct tGroundCacheSector
+{
+	int16 x, y;
+	uint32 lastUsed;
+	tGroundCacheCell cells[GROUNDCACHE_CELLS_PER_SECTOR][GROUNDCACHE_CELLS_PER_SECTOR];
+};
+
+class CGroundCache
+{
+	static tGroundCacheSector *ms_apSectors[NUMSECTORS_Y][NUMSECTORS_X];
+	static tGroundCacheSector *ms_apCachedSectors[GROUNDCACHE_MAX_SECTORS];
+	static int32 ms_nNumSectors;
+	static uint32 ms_nUseCounter;
+	static eLevelName ms_nCollisionLevel;
+
+	static void RemoveSector(int32 i);
+	static tGroundCacheCell *GetCell(float x, float y);
+	static void FillCell(tGroundCacheCell *cell, CSector *sector, float x, float y);
+	static bool AddSurfaces(tGroundCacheCell *cell, CSectorEntityArray &list, CRect &rect);
+public:
+	static bool bEnabled;
+
+	static void Flush(void);
+	static void InvalidateArea(const CRect &rect);
+	static bool FindZ(float x, float y, float z, bool bDummies, bool bRoof, float &resultZ, bool &bFound);
+};
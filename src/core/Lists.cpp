@@ -24,3 +24,110 @@ void
 CEntryInfoNode::operator delete(void *p, size_t){
 	CPools::GetEntryInfoNodePool()->Delete((CEntryInfoNode*)p);
 }
+
+int32
+CSectorEntityArray::Add(CEntity *ent, CEntryInfoNode *info)
+{
+	if(numEntries == capacity)
+		Grow();
+	int32 i = numEntries++;
+	entities[i] = ent;
+	infos[i] = info;
+	if(info)
+		info->arrayIndex = i;
+	UpdateBounds(i);
+	return i;
+}
+
+void
+CSectorEntityArray::RemoveAt(int32 i)
+{
+	assert(i >= 0 && i < numEntries);
+	int32 last = --numEntries;
+	if(i != last){
+		// move the last entry into the hole
+		entities[i] = entities[last];
+		infos[i] = infos[last];
+		boundX[i] = boundX[last];
+		boundY[i] = boundY[last];
+		boundZ[i] = boundZ[last];
+		boundRadius[i] = boundRadius[last];
+		if(infos[i])
+			infos[i]->arrayIndex = i;
+	}
+}
+
+// Only used for entities without an info node, i.e. buildings
+void
+CSectorEntityArray::Remove(CEntity *ent)
+{
+	int32 i;
+	for(i = 0; i < numEntries; i++)
+		if(entities[i] == ent){
+			RemoveAt(i);
+			return;
+		}
+}
+
+void
+CSectorEntityArray::UpdateBounds(int32 i)
+{
+	CVector centre;
+	entities[i]->GetBoundCentre(centre);
+	boundX[i] = centre.x;
+	boundY[i] = centre.y;
+	boundZ[i] = centre.z;
+	boundRadius[i] = entities[i]->GetBoundRadius();
+}
+
+// Only used for entities without an info node, i.e. buildings
+void
+CSectorEntityArray::UpdateBounds(CEntity *ent)
+{
+	int32 i;
+	for(i = 0; i < numEntries; i++)
+		if(entities[i] == ent){
+			UpdateBounds(i);
+			return;
+		}
+}
+
+void
+CSectorEntityArray::Grow(void)
+{
+	int32 newCapacity = capacity == 0 ? 8 : capacity*2;
+	CEntity **newEntities = new CEntity*[newCapacity];
+	CEntryInfoNode **newInfos = new CEntryInfoNode*[newCapacity];
+	float *newBounds = new float[newCapacity*4];
+	if(numEntries > 0){
+		memcpy(newEntities, entities, numEntries*sizeof(CEntity*));
+		memcpy(newInfos, infos, numEntries*sizeof(CEntryInfoNode*));
+		memcpy(&newBounds[0*newCapacity], boundX, numEntries*sizeof(float));
+		memcpy(&newBounds[1*newCapacity], boundY, numEntries*sizeof(float));
+		memcpy(&newBounds[2*newCapacity], boundZ, numEntries*sizeof(float));
+		memcpy(&newBounds[3*newCapacity], boundRadius, numEntries*sizeof(float));
+	}
+	delete[] entities;
+	delete[] infos;
+	delete[] boundX;
+	entities = newEntities;
+	infos = newInfos;
+	boundX = &newBounds[0*newCapacity];
+	boundY = &newBounds[1*newCapacity];
+	boundZ = &newBounds[2*newCapacity];
+	boundRadius = &newBounds[3*newCapacity];
+	capacity = newCapacity;
+}
+
+void
+CSectorEntityArray::Shutdown(void)
+{
+	delete[] entities;
+	delete[] infos;
+	delete[] boundX;
+	entities = nil;
+	infos = nil;
+	boundX = boundY = boundZ = boundRadius = nil;
+	numEntries = 0;
+	capacity = 0;
+}
@@ -69,6 +69,7 @@ public:
 };
 
 class CSector;
+class CEntity;
 
 // This records in which sector list a Physical is
 class CEntryInfoNode
@@ -77,6 +78,7 @@ public:
 	CPtrList *list;		// list in sector
 	CPtrNode *listnode;	// node in list
 	CSector *sector;
+	int32 arrayIndex;	// index in the sector's packed array
 
 	CEntryInfoNode *prev;
 	CEntryInfoNode *next;
@@ -128,3 +130,34 @@ public:
 		}
 	}
 };
+
+// Packed mirror of a sector CPtrList. Scans walk these arrays
+// instead of chasing CPtrNodes, bounding spheres are cached so
+// rejections against static entries don't have to touch the entity at all.
+// Entries of Physicals and Dummies point back to their CEntryInfoNode,
+// which allows O(1) removal. Buildings have no info node.
+class CSectorEntityArray
+{
+public:
+	CEntity **entities;
+	CEntryInfoNode **infos;
+	float *boundX;
+	float *boundY;
+	float *boundZ;
+	float *boundRadius;
+	int32 numEntries;
+	int32 capacity;
+	bool staticBounds;	// entries only move by being re-added or through CEntity::UpdateSectorBounds, cached bounds are exact
+
+	CSectorEntityArray(void) { entities = nil; infos = nil; boundX = boundY = boundZ = boundRadius = nil; numEntries = 0; capacity = 0; staticBounds = false; }
+	~CSectorEntityArray(void) { Shutdown(); }
+
+	int32 Add(CEntity *ent, CEntryInfoNode *info);
+	void RemoveAt(int32 i);
+	void Remove(CEntity *ent);
+	void UpdateBounds(int32 i);
+	void UpdateBounds(CEntity *ent);
+	void Clear(void) { numEntries = 0; }
+	void Grow(void);
+	void Shutdown(void);
+};
@@ -0,0 +1,109 @@
+#include "common.h"
+
+#include "WorkerThreads.h"
+
+int32 CWorkerThreads::ms_nNumThreads;
+bool CWorkerThreads::ms_bRunning;
+
+#ifdef WORKER_THREADS
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+static std::thread gWorkerThreads[MAX_WORKER_THREADS];
+static std::mutex gWorkerMutex;
+static std::condition_variable gWorkerStartCv;
+static std::condition_variable gWorkerDoneCv;
+static bool gbWorkersQuit;
+static uint32 gWorkerBatch;	// incremented for every Run
+static int32 gNumWorkersBusy;
+
+static WorkerJob gpWorkerJob;
+static void *gpWorkerData;
+static int32 gNumWorkerJobs;
+static std::atomic<int32> gNextWorkerJob;
+
+static void
+DoWorkerJobs(void)
+{
+	int32 job;
+	while((job = gNextWorkerJob++) < gNumWorkerJobs)
+		gpWorkerJob(job, gpWorkerData);
+}
+
+static void
+WorkerThreadMain(void)
+{
+	uint32 batch = 0;
+	std::unique_lock<std::mutex> lock(gWorkerMutex);
+	for(;;){
+		gWorkerStartCv.wait(lock, [&]{ return gbWorkersQuit || gWorkerBatch != batch; });
+		if(gbWorkersQuit)
+			return;
+		batch = gWorkerBatch;
+		lock.unlock();
+		DoWorkerJobs();
+		lock.lock();
+		if(--gNumWorkersBusy == 0)
+			gWorkerDoneCv.notify_one();
+	}
+}
+#endif
+
+void
+CWorkerThreads::Init(void)
+{
+#ifdef WORKER_THREADS
+	if(ms_nNumThreads != 0)
+		return;
+	int32 numCores = std::thread::hardware_concurrency();
+	ms_nNumThreads = Clamp(numCores - 1, 0, MAX_WORKER_THREADS);
+	gbWorkersQuit = false;
+	for(int32 i = 0; i < ms_nNumThreads; i++)
+		gWorkerThreads[i] = std::thread(WorkerThreadMain);
+	debug("Started %d worker threads\n", ms_nNumThreads);
+#endif
+}
+
+void
+CWorkerThreads::Shutdown(void)
+{
+#ifdef WORKER_THREADS
+	{
+		std::lock_guard<std::mutex> lock(gWorkerMutex);
+		gbWorkersQuit = true;
+	}
+	gWorkerStartCv.notify_all();
+	for(int32 i = 0; i < ms_nNumThreads; i++)
+		gWorkerThreads[i].join();
+	ms_nNumThreads = 0;
+#endif
+}
+
+void
+CWorkerThreads::Run(WorkerJob job, int32 numJobs, void *data)
+{
+#ifdef WORKER_THREADS
+	if(ms_nNumThreads > 0 && numJobs > 1){
+		{
+			std::lock_guard<std::mutex> lock(gWorkerMutex);
+			gpWorkerJob = job;
+			gpWorkerData = data;
+			gNumWorkerJobs = numJobs;
+			gNextWorkerJob = 0;
+			gNumWorkersBusy = ms_nNumThreads;
+			gWorkerBatch++;
+			ms_bRunning = true;
+		}
+		gWorkerStartCv.notify_all();
+		DoWorkerJobs();
+		std::unique_lock<std::mutex> lock(gWorkerMutex);
+		gWorkerDoneCv.wait(lock, []{ return gNumWorkersBusy == 0; });
+		ms_bRunning = false;
+		return;
+	}
+#endif
+	for(int32 i = 0; i < numJobs; i++)
+		job(i, data);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+// Not original. A few threads that sit idle until the main thread has a
+// batch of independent jobs for them. The calling thread works on the batch
+// too, so everything also runs (just serially) when there are no workers.
+
+#define MAX_WORKER_THREADS (7)
+
+typedef void (*WorkerJob)(int32 job, void *data);
+
+class CWorkerThreads
+{
+	static int32 ms_nNumThreads;
+	static bool ms_bRunning;
+public:
+	static void Init(void);
+	static void Shutdown(void);
+	// including the calling thread
+	static int32 GetNumThreads(void) { return ms_nNumThreads + 1; }
+	// calls job(0..numJobs-1, data) and returns when all calls have returned.
+	// jobs must not call Run themselves
+	static void Run(WorkerJob job, int32 numJobs, void *data);
+	// true while Run has jobs on the worker threads
+	static bool IsRunning(void) { return ms_bRunning; }
+};
@@ -8,6 +8,7 @@
 #include "Explosion.h"
 #include "Fire.h"
 #include "Garages.h"
+#include "GroundCache.h"
 #include "Glass.h"
 #include "Messages.h"
 #include "ModelIndices.h"
@@ -22,6 +23,10 @@
 #include "TempColModels.h"
 #include "WaterLevel.h"
 #include "World.h"
+#ifdef PED_ANIM_LOD
+#include "Pools.h"
+#include "VisibilityPlugins.h"
+#endif
 
 
 #define OBJECT_REPOSITION_OFFSET_Z 2.0f
@@ -32,6 +37,7 @@ CPtrList CWorld::ms_bigBuildingsList[NUM_LEVELS];
 CPtrList CWorld::ms_listMovingEntityPtrs;
 CSector CWorld::ms_aSectors[NUMSECTORS_Y][NUMSECTORS_X];
 uint16 CWorld::ms_nCurrentScanCode;
+CWorldQuery CWorld::ms_mainQuery;
 
 uint8 CWorld::PlayerInFocus;
 CPlayerInfo CWorld::Players[NUMPLAYERS];
@@ -59,6 +65,65 @@ CWorld::Initialise()
 	bIncludeDeadPeds = false;
 	bForceProcessControl = false;
 	bIncludeCarTyres = false;
+
+	for(int y = 0; y < NUMSECTORS_Y; y++)
+		for(int x = 0; x < NUMSECTORS_X; x++){
+			CSector *s = GetSector(x, y);
+			s->m_arrays[ENTITYLIST_BUILDINGS].staticBounds = true;
+			s->m_arrays[ENTITYLIST_BUILDINGS_OVERLAP].staticBounds = true;
+			s->m_arrays[ENTITYLIST_DUMMIES].staticBounds = true;
+			s->m_arrays[ENTITYLIST_DUMMIES_OVERLAP].staticBounds = true;
+		}
+}
+
+// Conservative line test against the cached bounding sphere of a packed entry.
+// Same sphere that CCollision tests first, so this never rejects a hit.
+static bool
+LineMissesCachedBounds(const CSectorEntityArray &list, int32 i, const CColLine &line)
+{
+	CVector centre(list.boundX[i], list.boundY[i], list.boundZ[i]);
+	CVector dir = line.p1 - line.p0;
+	float lenSq = dir.MagnitudeSqr();
+	float t = 0.0f;
+	if(lenSq > 0.0f){
+		t = DotProduct(centre - line.p0, dir) / lenSq;
+		t = Clamp(t, 0.0f, 1.0f);
+	}
+	CVector dist = centre - (line.p0 + dir*t);
+	return dist.MagnitudeSqr() > SQR(list.boundRadius[i]);
+}
+
+// Col model ProcessLineOfSight tests an entity with, nil if it shouldn't be tested.
+static CColModel*
+GetLineOfSightColModel(CEntity *e, bool deadPeds)
+{
+	CColModel *colmodel = nil;
+
+	if(e->IsPed()) {
+		if(e->bUsesCollision || deadPeds && ((CPed *)e)->m_nPedState == PED_DEAD) {
+#ifdef PED_SKIN
+			if(IsClumpSkinned(e->GetClump()))
+				colmodel = ((CPedModelInfo *)CModelInfo::GetModelInfo(e->GetModelIndex()))->AnimatePedColModelSkinned(e->GetClump());
+			else
+#endif
+			if(((CPed *)e)->UseGroundColModel())
+				colmodel = &CTempColModels::ms_colModelPedGroundHit;
+			else
+#ifdef ANIMATE_PED_COL_MODEL
+				colmodel = CPedModelInfo::AnimatePedColModel(
+				    ((CPedModelInfo *)CModelInfo::GetModelInfo(e->GetModelIndex()))
+				        ->GetHitColModel(),
+				    RpClumpGetFrame(e->GetClump()));
+#else
+				colmodel =
+				    ((CPedModelInfo *)CModelInfo::GetModelInfo(e->GetModelIndex()))
+				        ->GetHitColModel();
+#endif
+		}
+	} else if(e->bUsesCollision)
+		colmodel = CModelInfo::GetColModel(e->GetModelIndex());
+
+	return colmodel;
 }
 
 void
@@ -71,6 +136,11 @@ CWorld::Add(CEntity *ent)
 	else
 		ent->Add();
 
+#ifdef GROUND_HEIGHT_CACHE
+	if((ent->IsBuilding() || ent->IsDummy()) && !ent->bIsBIGBuilding)
+		CGroundCache::InvalidateArea(ent->GetBoundRect());
+#endif
+
 	if(ent->IsBuilding() || ent->IsDummy()) return;
 
 	if(!ent->GetIsStatic()) ((CPhysical *)ent)->AddToMovingList();
@@ -86,6 +156,11 @@ CWorld::Remove(CEntity *ent)
 	else
 		ent->Remove();
 
+#ifdef GROUND_HEIGHT_CACHE
+	if((ent->IsBuilding() || ent->IsDummy()) && !ent->bIsBIGBuilding)
+		CGroundCache::InvalidateArea(ent->GetBoundRect());
+#endif
+
 	if(ent->IsBuilding() || ent->IsDummy()) return;
 
 	if(!ent->GetIsStatic()) ((CPhysical *)ent)->RemoveFromMovingList();
@@ -93,22 +168,103 @@ CWorld::Remove(CEntity *ent)
 
 void
 CWorld::ClearScanCodes(void)
+{
+	int k;
+	for(int i = 0; i < NUMSECTORS_Y; i++)
+		for(int j = 0; j < NUMSECTORS_X; j++) {
+			CSector *s = &ms_aSectors[i][j];
+			for(k = 0; k < s->m_arrays[ENTITYLIST_BUILDINGS].numEntries; k++)
+				s->m_arrays[ENTITYLIST_BUILDINGS].entities[k]->m_scanCode = 0;
+			for(k = 0; k < s->m_arrays[ENTITYLIST_VEHICLES].numEntries; k++)
+				s->m_arrays[ENTITYLIST_VEHICLES].entities[k]->m_scanCode = 0;
+			for(k = 0; k < s->m_arrays[ENTITYLIST_PEDS].numEntries; k++)
+				s->m_arrays[ENTITYLIST_PEDS].entities[k]->m_scanCode = 0;
+			for(k = 0; k < s->m_arrays[ENTITYLIST_OBJECTS].numEntries; k++)
+				s->m_arrays[ENTITYLIST_OBJECTS].entities[k]->m_scanCode = 0;
+			for(k = 0; k < s->m_arrays[ENTITYLIST_DUMMIES].numEntries; k++)
+				s->m_arrays[ENTITYLIST_DUMMIES].entities[k]->m_scanCode = 0;
+		}
+}
+
+CWorldQuery::CWorldQuery(void)
+{
+	m_visited = nil;
+	m_visitedEpoch = nil;
+	m_size = 0;
+	m_numVisited = 0;
+	m_epoch = 1;
+	pIgnoreEntity = nil;
+	bIncludeDeadPeds = false;
+}
+
+CWorldQuery::~CWorldQuery(void)
+{
+	delete[] m_visited;
+	delete[] m_visitedEpoch;
+}
+
+void
+CWorldQuery::Begin(void)
+{
+	// old slots become free by not matching the epoch anymore
+	if(++m_epoch == 0){
+		if(m_visitedEpoch)
+			memset(m_visitedEpoch, 0, m_size*sizeof(uint16));
+		m_epoch = 1;
+	}
+	m_numVisited = 0;
+}
+
+void
+CWorldQuery::Grow(void)
+{
+	CEntity **oldVisited = m_visited;
+	uint16 *oldEpoch = m_visitedEpoch;
+	int32 oldSize = m_size;
+
+	m_size = oldSize == 0 ? 256 : oldSize*2;
+	m_visited = new CEntity*[m_size];
+	m_visitedEpoch = new uint16[m_size];
+	memset(m_visitedEpoch, 0, m_size*sizeof(uint16));
+	m_numVisited = 0;
+	for(int32 i = 0; i < oldSize; i++)
+		if(oldEpoch[i] == m_epoch)
+			Visit(oldVisited[i]);
+
+	delete[] oldVisited;
+	delete[] oldEpoch;
+}
+
+// Restore the packed arrays from the sector lists,
+// needed when the lists are copied back wholesale (replay)
+void
+CWorld::RebuildSectorArrays(void)
 {
 	CPtrNode *node;
+	CEntryInfoNode *info;
+	CEntity *e;
 	for(int i = 0; i < NUMSECTORS_Y; i++)
 		for(int j = 0; j < NUMSECTORS_X; j++) {
 			CSector *s = &ms_aSectors[i][j];
-			for(node = s->m_lists[ENTITYLIST_BUILDINGS].first; node; node = node->next)
-				((CEntity *)node->item)->m_scanCode = 0;
-			for(node = s->m_lists[ENTITYLIST_VEHICLES].first; node; node = node->next)
-				((CEntity *)node->item)->m_scanCode = 0;
-			for(node = s->m_lists[ENTITYLIST_PEDS].first; node; node = node->next)
-				((CEntity *)node->item)->m_scanCode = 0;
-			for(node = s->m_lists[ENTITYLIST_OBJECTS].first; node; node = node->next)
-				((CEntity *)node->item)->m_scanCode = 0;
-			for(node = s->m_lists[ENTITYLIST_DUMMIES].first; node; node = node->next)
-				((CEntity *)node->item)->m_scanCode = 0;
+			for(int k = 0; k < NUMSECTORENTITYLISTS; k++) {
+				s->m_arrays[k].Clear();
+				for(node = s->m_lists[k].first; node; node = node->next) {
+					e = (CEntity *)node->item;
+					info = nil;
+					if(e->IsDummy())
+						info = ((CDummy *)e)->m_entryInfoList.first;
+					else if(!e->IsBuilding())
+						info = ((CPhysical *)e)->m_entryInfoList.first;
+					while(info && info->listnode != node)
+						info = info->next;
+					s->m_arrays[k].Add(e, info);
+				}
+			}
 		}
+#ifdef GROUND_HEIGHT_CACHE
+	// lists were replaced wholesale, so were the dummies
+	CGroundCache::Flush();
+#endif
 }
 
 void
@@ -164,13 +320,24 @@ bool
 CWorld::ProcessLineOfSight(const CVector &point1, const CVector &point2, CColPoint &point, CEntity *&entity,
                            bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects,
                            bool checkDummies, bool ignoreSeeThrough, bool ignoreSomeObjects)
+{
+	ms_mainQuery.pIgnoreEntity = pIgnoreEntity;
+	ms_mainQuery.bIncludeDeadPeds = bIncludeDeadPeds;
+	return ProcessLineOfSight(ms_mainQuery, point1, point2, point, entity, checkBuildings, checkVehicles, checkPeds,
+	                          checkObjects, checkDummies, ignoreSeeThrough, ignoreSomeObjects);
+}
+
+bool
+CWorld::ProcessLineOfSight(CWorldQuery &query, const CVector &point1, const CVector &point2, CColPoint &point,
+                           CEntity *&entity, bool checkBuildings, bool checkVehicles, bool checkPeds,
+                           bool checkObjects, bool checkDummies, bool ignoreSeeThrough, bool ignoreSomeObjects)
 {
 	int x, xstart, xend;
 	int y, ystart, yend;
 	int y1, y2;
 	float dist;
 
-	AdvanceCurrentScanCode();
+	query.Begin();
 
 	entity = nil;
 	dist = 1.0f;
@@ -186,20 +353,20 @@ CWorld::ProcessLineOfSight(const CVector &point1, const CVector &point2, CColPoi
 
 	if(xstart == xend && ystart == yend) {
 		// Only one sector
-		return ProcessLineOfSightSector(*GetSector(xstart, ystart), LOSARGS);
+		return ProcessLineOfSightSector(query, *GetSector(xstart, ystart), LOSARGS);
 	} else if(xstart == xend) {
 		// Only step in y
 		if(ystart < yend)
-			for(y = ystart; y <= yend; y++) ProcessLineOfSightSector(*GetSector(xstart, y), LOSARGS);
+			for(y = ystart; y <= yend; y++) ProcessLineOfSightSector(query, *GetSector(xstart, y), LOSARGS);
 		else
-			for(y = ystart; y >= yend; y--) ProcessLineOfSightSector(*GetSector(xstart, y), LOSARGS);
+			for(y = ystart; y >= yend; y--) ProcessLineOfSightSector(query, *GetSector(xstart, y), LOSARGS);
 		return dist < 1.0f;
 	} else if(ystart == yend) {
 		// Only step in x
 		if(xstart < xend)
-			for(x = xstart; x <= xend; x++) ProcessLineOfSightSector(*GetSector(x, ystart), LOSARGS);
+			for(x = xstart; x <= xend; x++) ProcessLineOfSightSector(query, *GetSector(x, ystart), LOSARGS);
 		else
-			for(x = xstart; x >= xend; x--) ProcessLineOfSightSector(*GetSector(x, ystart), LOSARGS);
+			for(x = xstart; x >= xend; x--) ProcessLineOfSightSector(query, *GetSector(x, ystart), LOSARGS);
 		return dist < 1.0f;
 	} else {
 		if(point1.x < point2.x) {
@@ -209,25 +376,25 @@ CWorld::ProcessLineOfSight(const CVector &point1, const CVector &point2, CColPoi
 			y1 = ystart;
 			y2 = GetSectorIndexY((GetWorldX(xstart + 1) - point1.x) * m + point1.y);
 			if(y1 < y2)
-				for(y = y1; y <= y2; y++) ProcessLineOfSightSector(*GetSector(xstart, y), LOSARGS);
+				for(y = y1; y <= y2; y++) ProcessLineOfSightSector(query, *GetSector(xstart, y), LOSARGS);
 			else
-				for(y = y1; y >= y2; y--) ProcessLineOfSightSector(*GetSector(xstart, y), LOSARGS);
+				for(y = y1; y >= y2; y--) ProcessLineOfSightSector(query, *GetSector(xstart, y), LOSARGS);
 
 			for(x = xstart + 1; x < xend; x++) {
 				y1 = y2;
 				y2 = GetSectorIndexY((GetWorldX(x + 1) - point1.x) * m + point1.y);
 				if(y1 < y2)
-					for(y = y1; y <= y2; y++) ProcessLineOfSightSector(*GetSector(x, y), LOSARGS);
+					for(y = y1; y <= y2; y++) ProcessLineOfSightSector(query, *GetSector(x, y), LOSARGS);
 				else
-					for(y = y1; y >= y2; y--) ProcessLineOfSightSector(*GetSector(x, y), LOSARGS);
+					for(y = y1; y >= y2; y--) ProcessLineOfSightSector(query, *GetSector(x, y), LOSARGS);
 			}
 
 			y1 = y2;
 			y2 = yend;
 			if(y1 < y2)
-				for(y = y1; y <= y2; y++) ProcessLineOfSightSector(*GetSector(xend, y), LOSARGS);
+				for(y = y1; y <= y2; y++) ProcessLineOfSightSector(query, *GetSector(xend, y), LOSARGS);
 			else
-				for(y = y1; y >= y2; y--) ProcessLineOfSightSector(*GetSector(xend, y), LOSARGS);
+				for(y = y1; y >= y2; y--) ProcessLineOfSightSector(query, *GetSector(xend, y), LOSARGS);
 		} else {
 			// Step from right to left
 			float m = (point2.y - point1.y) / (point2.x - point1.x);
@@ -235,25 +402,25 @@ CWorld::ProcessLineOfSight(const CVector &point1, const CVector &point2, CColPoi
 			y1 = ystart;
 			y2 = GetSectorIndexY((GetWorldX(xstart) - point1.x) * m + point1.y);
 			if(y1 < y2)
-				for(y = y1; y <= y2; y++) ProcessLineOfSightSector(*GetSector(xstart, y), LOSARGS);
+				for(y = y1; y <= y2; y++) ProcessLineOfSightSector(query, *GetSector(xstart, y), LOSARGS);
 			else
-				for(y = y1; y >= y2; y--) ProcessLineOfSightSector(*GetSector(xstart, y), LOSARGS);
+				for(y = y1; y >= y2; y--) ProcessLineOfSightSector(query, *GetSector(xstart, y), LOSARGS);
 
 			for(x = xstart - 1; x > xend; x--) {
 				y1 = y2;
 				y2 = GetSectorIndexY((GetWorldX(x) - point1.x) * m + point1.y);
 				if(y1 < y2)
-					for(y = y1; y <= y2; y++) ProcessLineOfSightSector(*GetSector(x, y), LOSARGS);
+					for(y = y1; y <= y2; y++) ProcessLineOfSightSector(query, *GetSector(x, y), LOSARGS);
 				else
-					for(y = y1; y >= y2; y--) ProcessLineOfSightSector(*GetSector(x, y), LOSARGS);
+					for(y = y1; y >= y2; y--) ProcessLineOfSightSector(query, *GetSector(x, y), LOSARGS);
 			}
 
 			y1 = y2;
 			y2 = yend;
 			if(y1 < y2)
-				for(y = y1; y <= y2; y++) ProcessLineOfSightSector(*GetSector(xend, y), LOSARGS);
+				for(y = y1; y <= y2; y++) ProcessLineOfSightSector(query, *GetSector(xend, y), LOSARGS);
 			else
-				for(y = y1; y >= y2; y--) ProcessLineOfSightSector(*GetSector(xend, y), LOSARGS);
+				for(y = y1; y >= y2; y--) ProcessLineOfSightSector(query, *GetSector(xend, y), LOSARGS);
 		}
 		return dist < 1.0f;
 	}
@@ -262,53 +429,47 @@ CWorld::ProcessLineOfSight(const CVector &point1, const CVector &point2, CColPoi
 }
 
 bool
-CWorld::ProcessLineOfSightSector(CSector &sector, const CColLine &line, CColPoint &point, float &dist, CEntity *&entity,
-                                 bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects,
-                                 bool checkDummies, bool ignoreSeeThrough, bool ignoreSomeObjects)
+CWorld::ProcessLineOfSightSector(CWorldQuery &query, CSector &sector, const CColLine &line, CColPoint &point, float &dist,
+                                 CEntity *&entity, bool checkBuildings, bool checkVehicles, bool checkPeds,
+                                 bool checkObjects, bool checkDummies, bool ignoreSeeThrough, bool ignoreSomeObjects)
 {
 	float mindist = dist;
-	bool deadPeds = !!bIncludeDeadPeds;
-	bIncludeDeadPeds = false;
 
 	if(checkBuildings) {
-		ProcessLineOfSightSectorList(sector.m_lists[ENTITYLIST_BUILDINGS], line, point, mindist, entity,
+		ProcessLineOfSightSectorList(query, sector.m_arrays[ENTITYLIST_BUILDINGS], line, point, mindist, entity,
 		                             ignoreSeeThrough);
-		ProcessLineOfSightSectorList(sector.m_lists[ENTITYLIST_BUILDINGS_OVERLAP], line, point, mindist, entity,
+		ProcessLineOfSightSectorList(query, sector.m_arrays[ENTITYLIST_BUILDINGS_OVERLAP], line, point, mindist, entity,
 		                             ignoreSeeThrough);
 	}
 
 	if(checkVehicles) {
-		ProcessLineOfSightSectorList(sector.m_lists[ENTITYLIST_VEHICLES], line, point, mindist, entity,
+		ProcessLineOfSightSectorList(query, sector.m_arrays[ENTITYLIST_VEHICLES], line, point, mindist, entity,
 		                             ignoreSeeThrough);
-		ProcessLineOfSightSectorList(sector.m_lists[ENTITYLIST_VEHICLES_OVERLAP], line, point, mindist, entity,
+		ProcessLineOfSightSectorList(query, sector.m_arrays[ENTITYLIST_VEHICLES_OVERLAP], line, point, mindist, entity,
 		                             ignoreSeeThrough);
 	}
 
 	if(checkPeds) {
-		if(deadPeds) bIncludeDeadPeds = true;
-		ProcessLineOfSightSectorList(sector.m_lists[ENTITYLIST_PEDS], line, point, mindist, entity,
+		ProcessLineOfSightSectorList(query, sector.m_arrays[ENTITYLIST_PEDS], line, point, mindist, entity,
 		                             ignoreSeeThrough);
-		ProcessLineOfSightSectorList(sector.m_lists[ENTITYLIST_PEDS_OVERLAP], line, point, mindist, entity,
+		ProcessLineOfSightSectorList(query, sector.m_arrays[ENTITYLIST_PEDS_OVERLAP], line, point, mindist, entity,
 		                             ignoreSeeThrough);
-		bIncludeDeadPeds = false;
 	}
 
 	if(checkObjects) {
-		ProcessLineOfSightSectorList(sector.m_lists[ENTITYLIST_OBJECTS], line, point, mindist, entity,
+		ProcessLineOfSightSectorList(query, sector.m_arrays[ENTITYLIST_OBJECTS], line, point, mindist, entity,
 		                             ignoreSeeThrough, ignoreSomeObjects);
-		ProcessLineOfSightSectorList(sector.m_lists[ENTITYLIST_OBJECTS_OVERLAP], line, point, mindist, entity,
+		ProcessLineOfSightSectorList(query, sector.m_arrays[ENTITYLIST_OBJECTS_OVERLAP], line, point, mindist, entity,
 		                             ignoreSeeThrough, ignoreSomeObjects);
 	}
 
 	if(checkDummies) {
-		ProcessLineOfSightSectorList(sector.m_lists[ENTITYLIST_DUMMIES], line, point, mindist, entity,
+		ProcessLineOfSightSectorList(query, sector.m_arrays[ENTITYLIST_DUMMIES], line, point, mindist, entity,
 		                             ignoreSeeThrough);
-		ProcessLineOfSightSectorList(sector.m_lists[ENTITYLIST_DUMMIES_OVERLAP], line, point, mindist, entity,
+		ProcessLineOfSightSectorList(query, sector.m_arrays[ENTITYLIST_DUMMIES_OVERLAP], line, point, mindist, entity,
 		                             ignoreSeeThrough);
 	}
 
-	bIncludeDeadPeds = deadPeds;
-
 	if(mindist < dist) {
 		dist = mindist;
 		return true;
@@ -317,49 +478,23 @@ CWorld::ProcessLineOfSightSector(CSector &sector, const CColLine &line, CColPoin
 }
 
 bool
-CWorld::ProcessLineOfSightSectorList(CPtrList &list, const CColLine &line, CColPoint &point, float &dist,
-                                     CEntity *&entity, bool ignoreSeeThrough, bool ignoreSomeObjects)
+CWorld::ProcessLineOfSightSectorList(CWorldQuery &query, CSectorEntityArray &list, const CColLine &line, CColPoint &point,
+                                     float &dist, CEntity *&entity, bool ignoreSeeThrough, bool ignoreSomeObjects)
 {
 	bool deadPeds = false;
 	float mindist = dist;
-	CPtrNode *node;
 	CEntity *e;
 	CColModel *colmodel;
 
-	if(list.first && bIncludeDeadPeds && ((CEntity *)list.first->item)->IsPed()) deadPeds = true;
-
-	for(node = list.first; node; node = node->next) {
-		e = (CEntity *)node->item;
-		if(e->m_scanCode != GetCurrentScanCode() && e != pIgnoreEntity && (e->bUsesCollision || deadPeds) &&
-		   !(ignoreSomeObjects && CameraToIgnoreThisObject(e))) {
-			colmodel = nil;
-			e->m_scanCode = GetCurrentScanCode();
-
-			if(e->IsPed()) {
-				if(e->bUsesCollision || deadPeds && ((CPed *)e)->m_nPedState == PED_DEAD) {
-#ifdef PED_SKIN
-					if(IsClumpSkinned(e->GetClump()))
-						colmodel = ((CPedModelInfo *)CModelInfo::GetModelInfo(e->GetModelIndex()))->AnimatePedColModelSkinned(e->GetClump());
-					else
-#endif
-					if(((CPed *)e)->UseGroundColModel())
-						colmodel = &CTempColModels::ms_colModelPedGroundHit;
-					else
-#ifdef ANIMATE_PED_COL_MODEL
-						colmodel = CPedModelInfo::AnimatePedColModel(
-						    ((CPedModelInfo *)CModelInfo::GetModelInfo(e->GetModelIndex()))
-						        ->GetHitColModel(),
-						    RpClumpGetFrame(e->GetClump()));
-#else
-						colmodel =
-						    ((CPedModelInfo *)CModelInfo::GetModelInfo(e->GetModelIndex()))
-						        ->GetHitColModel();
-#endif
-				} else
-					colmodel = nil;
-			} else if(e->bUsesCollision)
-				colmodel = CModelInfo::GetColModel(e->GetModelIndex());
+	if(list.numEntries > 0 && query.bIncludeDeadPeds && list.entities[0]->IsPed()) deadPeds = true;
 
+	for(int32 i = 0; i < list.numEntries; i++) {
+		if(list.staticBounds && LineMissesCachedBounds(list, i, line))
+			continue;
+		e = list.entities[i];
+		if(e != query.pIgnoreEntity && (e->bUsesCollision || deadPeds) &&
+		   !(ignoreSomeObjects && CameraToIgnoreThisObject(e)) && query.Visit(e)) {
+			colmodel = GetLineOfSightColModel(e, deadPeds);
 			if(colmodel && CCollision::ProcessLineOfSight(line, e->GetMatrix(), *colmodel, point, mindist,
 			                                              ignoreSeeThrough))
 				entity = e;
@@ -378,52 +513,61 @@ CWorld::ProcessVerticalLine(const CVector &point1, float z2, CColPoint &point, C
                             bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies,
                             bool ignoreSeeThrough, CStoredCollPoly *poly)
 {
-	AdvanceCurrentScanCode();
+	return ProcessVerticalLine(ms_mainQuery, point1, z2, point, entity, checkBuildings, checkVehicles, checkPeds,
+	                           checkObjects, checkDummies, ignoreSeeThrough, poly);
+}
+
+bool
+CWorld::ProcessVerticalLine(CWorldQuery &query, const CVector &point1, float z2, CColPoint &point, CEntity *&entity,
+                            bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects,
+                            bool checkDummies, bool ignoreSeeThrough, CStoredCollPoly *poly)
+{
+	query.Begin();
 	CVector point2(point1.x, point1.y, z2);
-	return ProcessVerticalLineSector(*GetSector(GetSectorIndexX(point1.x), GetSectorIndexY(point1.y)),
+	return ProcessVerticalLineSector(query, *GetSector(GetSectorIndexX(point1.x), GetSectorIndexY(point1.y)),
 	                                 CColLine(point1, point2), point, entity, checkBuildings, checkVehicles,
 	                                 checkPeds, checkObjects, checkDummies, ignoreSeeThrough, poly);
 }
 
 bool
-CWorld::ProcessVerticalLineSector(CSector &sector, const CColLine &line, CColPoint &point, CEntity *&entity,
-                                  bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects,
-                                  bool checkDummies, bool ignoreSeeThrough, CStoredCollPoly *poly)
+CWorld::ProcessVerticalLineSector(CWorldQuery &query, CSector &sector, const CColLine &line, CColPoint &point,
+                                  CEntity *&entity, bool checkBuildings, bool checkVehicles, bool checkPeds,
+                                  bool checkObjects, bool checkDummies, bool ignoreSeeThrough, CStoredCollPoly *poly)
 {
 	float mindist = 1.0f;
 
 	if(checkBuildings) {
-		ProcessVerticalLineSectorList(sector.m_lists[ENTITYLIST_BUILDINGS], line, point, mindist, entity,
+		ProcessVerticalLineSectorList(query, sector.m_arrays[ENTITYLIST_BUILDINGS], line, point, mindist, entity,
 		                              ignoreSeeThrough, poly);
-		ProcessVerticalLineSectorList(sector.m_lists[ENTITYLIST_BUILDINGS_OVERLAP], line, point, mindist,
+		ProcessVerticalLineSectorList(query, sector.m_arrays[ENTITYLIST_BUILDINGS_OVERLAP], line, point, mindist,
 		                              entity, ignoreSeeThrough, poly);
 	}
 
 	if(checkVehicles) {
-		ProcessVerticalLineSectorList(sector.m_lists[ENTITYLIST_VEHICLES], line, point, mindist, entity,
+		ProcessVerticalLineSectorList(query, sector.m_arrays[ENTITYLIST_VEHICLES], line, point, mindist, entity,
 		                              ignoreSeeThrough, poly);
-		ProcessVerticalLineSectorList(sector.m_lists[ENTITYLIST_VEHICLES_OVERLAP], line, point, mindist, entity,
+		ProcessVerticalLineSectorList(query, sector.m_arrays[ENTITYLIST_VEHICLES_OVERLAP], line, point, mindist, entity,
 		                              ignoreSeeThrough, poly);
 	}
 
 	if(checkPeds) {
-		ProcessVerticalLineSectorList(sector.m_lists[ENTITYLIST_PEDS], line, point, mindist, entity,
+		ProcessVerticalLineSectorList(query, sector.m_arrays[ENTITYLIST_PEDS], line, point, mindist, entity,
 		                              ignoreSeeThrough, poly);
-		ProcessVerticalLineSectorList(sector.m_lists[ENTITYLIST_PEDS_OVERLAP], line, point, mindist, entity,
+		ProcessVerticalLineSectorList(query, sector.m_arrays[ENTITYLIST_PEDS_OVERLAP], line, point, mindist, entity,
 		                              ignoreSeeThrough, poly);
 	}
 
 	if(checkObjects) {
-		ProcessVerticalLineSectorList(sector.m_lists[ENTITYLIST_OBJECTS], line, point, mindist, entity,
+		ProcessVerticalLineSectorList(query, sector.m_arrays[ENTITYLIST_OBJECTS], line, point, mindist, entity,
 		                              ignoreSeeThrough, poly);
-		ProcessVerticalLineSectorList(sector.m_lists[ENTITYLIST_OBJECTS_OVERLAP], line, point, mindist, entity,
+		ProcessVerticalLineSectorList(query, sector.m_arrays[ENTITYLIST_OBJECTS_OVERLAP], line, point, mindist, entity,
 		                              ignoreSeeThrough, poly);
 	}
 
 	if(checkDummies) {
-		ProcessVerticalLineSectorList(sector.m_lists[ENTITYLIST_DUMMIES], line, point, mindist, entity,
+		ProcessVerticalLineSectorList(query, sector.m_arrays[ENTITYLIST_DUMMIES], line, point, mindist, entity,
 		                              ignoreSeeThrough, poly);
-		ProcessVerticalLineSectorList(sector.m_lists[ENTITYLIST_DUMMIES_OVERLAP], line, point, mindist, entity,
+		ProcessVerticalLineSectorList(query, sector.m_arrays[ENTITYLIST_DUMMIES_OVERLAP], line, point, mindist, entity,
 		                              ignoreSeeThrough, poly);
 	}
 
@@ -431,19 +575,18 @@ CWorld::ProcessVerticalLineSector(CSector &sector, const CColLine &line, CColPoi
 }
 
 bool
-CWorld::ProcessVerticalLineSectorList(CPtrList &list, const CColLine &line, CColPoint &point, float &dist,
-                                      CEntity *&entity, bool ignoreSeeThrough, CStoredCollPoly *poly)
+CWorld::ProcessVerticalLineSectorList(CWorldQuery &query, CSectorEntityArray &list, const CColLine &line, CColPoint &point,
+                                      float &dist, CEntity *&entity, bool ignoreSeeThrough, CStoredCollPoly *poly)
 {
 	float mindist = dist;
-	CPtrNode *node;
 	CEntity *e;
 	CColModel *colmodel;
 
-	for(node = list.first; node; node = node->next) {
-		e = (CEntity *)node->item;
-		if(e->m_scanCode != GetCurrentScanCode() && e->bUsesCollision) {
-			e->m_scanCode = GetCurrentScanCode();
-
+	for(int32 i = 0; i < list.numEntries; i++) {
+		if(list.staticBounds && LineMissesCachedBounds(list, i, line))
+			continue;
+		e = list.entities[i];
+		if(e->bUsesCollision && query.Visit(e)) {
 			colmodel = CModelInfo::GetColModel(e->GetModelIndex());
 			if(CCollision::ProcessVerticalLine(line, e->GetMatrix(), *colmodel, point, mindist,
 			                                   ignoreSeeThrough, poly))
@@ -462,12 +605,22 @@ bool
 CWorld::GetIsLineOfSightClear(const CVector &point1, const CVector &point2, bool checkBuildings, bool checkVehicles,
                               bool checkPeds, bool checkObjects, bool checkDummies, bool ignoreSeeThrough,
                               bool ignoreSomeObjects)
+{
+	ms_mainQuery.pIgnoreEntity = pIgnoreEntity;
+	return GetIsLineOfSightClear(ms_mainQuery, point1, point2, checkBuildings, checkVehicles, checkPeds, checkObjects,
+	                             checkDummies, ignoreSeeThrough, ignoreSomeObjects);
+}
+
+bool
+CWorld::GetIsLineOfSightClear(CWorldQuery &query, const CVector &point1, const CVector &point2, bool checkBuildings,
+                              bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies,
+                              bool ignoreSeeThrough, bool ignoreSomeObjects)
 {
 	int x, xstart, xend;
 	int y, ystart, yend;
 	int y1, y2;
 
-	AdvanceCurrentScanCode();
+	query.Begin();
 
 	xstart = GetSectorIndexX(point1.x);
 	ystart = GetSectorIndexY(point1.y);
@@ -480,24 +633,24 @@ CWorld::GetIsLineOfSightClear(const CVector &point1, const CVector &point2, bool
 
 	if(xstart == xend && ystart == yend) {
 		// Only one sector
-		return GetIsLineOfSightSectorClear(*GetSector(xstart, ystart), LOSARGS);
+		return GetIsLineOfSightSectorClear(query, *GetSector(xstart, ystart), LOSARGS);
 	} else if(xstart == xend) {
 		// Only step in y
 		if(ystart < yend) {
 			for(y = ystart; y <= yend; y++)
-				if(!GetIsLineOfSightSectorClear(*GetSector(xstart, y), LOSARGS)) return false;
+				if(!GetIsLineOfSightSectorClear(query, *GetSector(xstart, y), LOSARGS)) return false;
 		} else {
 			for(y = ystart; y >= yend; y--)
-				if(!GetIsLineOfSightSectorClear(*GetSector(xstart, y), LOSARGS)) return false;
+				if(!GetIsLineOfSightSectorClear(query, *GetSector(xstart, y), LOSARGS)) return false;
 		}
 	} else if(ystart == yend) {
 		// Only step in x
 		if(xstart < xend) {
 			for(x = xstart; x <= xend; x++)
-				if(!GetIsLineOfSightSectorClear(*GetSector(x, ystart), LOSARGS)) return false;
+				if(!GetIsLineOfSightSectorClear(query, *GetSector(x, ystart), LOSARGS)) return false;
 		} else {
 			for(x = xstart; x >= xend; x--)
-				if(!GetIsLineOfSightSectorClear(*GetSector(x, ystart), LOSARGS)) return false;
+				if(!GetIsLineOfSightSectorClear(query, *GetSector(x, ystart), LOSARGS)) return false;
 		}
 	} else {
 		if(point1.x < point2.x) {
@@ -508,10 +661,10 @@ CWorld::GetIsLineOfSightClear(const CVector &point1, const CVector &point2, bool
 			y2 = GetSectorIndexY((GetWorldX(xstart + 1) - point1.x) * m + point1.y);
 			if(y1 < y2) {
 				for(y = y1; y <= y2; y++)
-					if(!GetIsLineOfSightSectorClear(*GetSector(xstart, y), LOSARGS)) return false;
+					if(!GetIsLineOfSightSectorClear(query, *GetSector(xstart, y), LOSARGS)) return false;
 			} else {
 				for(y = y1; y >= y2; y--)
-					if(!GetIsLineOfSightSectorClear(*GetSector(xstart, y), LOSARGS)) return false;
+					if(!GetIsLineOfSightSectorClear(query, *GetSector(xstart, y), LOSARGS)) return false;
 			}
 
 			for(x = xstart + 1; x < xend; x++) {
@@ -519,11 +672,11 @@ CWorld::GetIsLineOfSightClear(const CVector &point1, const CVector &point2, bool
 				y2 = GetSectorIndexY((GetWorldX(x + 1) - point1.x) * m + point1.y);
 				if(y1 < y2) {
 					for(y = y1; y <= y2; y++)
-						if(!GetIsLineOfSightSectorClear(*GetSector(x, y), LOSARGS))
+						if(!GetIsLineOfSightSectorClear(query, *GetSector(x, y), LOSARGS))
 							return false;
 				} else {
 					for(y = y1; y >= y2; y--)
-						if(!GetIsLineOfSightSectorClear(*GetSector(x, y), LOSARGS))
+						if(!GetIsLineOfSightSectorClear(query, *GetSector(x, y), LOSARGS))
 							return false;
 				}
 			}
@@ -532,10 +685,10 @@ CWorld::GetIsLineOfSightClear(const CVector &point1, const CVector &point2, bool
 			y2 = yend;
 			if(y1 < y2) {
 				for(y = y1; y <= y2; y++)
-					if(!GetIsLineOfSightSectorClear(*GetSector(xend, y), LOSARGS)) return false;
+					if(!GetIsLineOfSightSectorClear(query, *GetSector(xend, y), LOSARGS)) return false;
 			} else {
 				for(y = y1; y >= y2; y--)
-					if(!GetIsLineOfSightSectorClear(*GetSector(xend, y), LOSARGS)) return false;
+					if(!GetIsLineOfSightSectorClear(query, *GetSector(xend, y), LOSARGS)) return false;
 			}
 		} else {
 			// Step from right to left
@@ -545,10 +698,10 @@ CWorld::GetIsLineOfSightClear(const CVector &point1, const CVector &point2, bool
 			y2 = GetSectorIndexY((GetWorldX(xstart) - point1.x) * m + point1.y);
 			if(y1 < y2) {
 				for(y = y1; y <= y2; y++)
-					if(!GetIsLineOfSightSectorClear(*GetSector(xstart, y), LOSARGS)) return false;
+					if(!GetIsLineOfSightSectorClear(query, *GetSector(xstart, y), LOSARGS)) return false;
 			} else {
 				for(y = y1; y >= y2; y--)
-					if(!GetIsLineOfSightSectorClear(*GetSector(xstart, y), LOSARGS)) return false;
+					if(!GetIsLineOfSightSectorClear(query, *GetSector(xstart, y), LOSARGS)) return false;
 			}
 
 			for(x = xstart - 1; x > xend; x--) {
@@ -556,11 +709,11 @@ CWorld::GetIsLineOfSightClear(const CVector &point1, const CVector &point2, bool
 				y2 = GetSectorIndexY((GetWorldX(x) - point1.x) * m + point1.y);
 				if(y1 < y2) {
 					for(y = y1; y <= y2; y++)
-						if(!GetIsLineOfSightSectorClear(*GetSector(x, y), LOSARGS))
+						if(!GetIsLineOfSightSectorClear(query, *GetSector(x, y), LOSARGS))
 							return false;
 				} else {
 					for(y = y1; y >= y2; y--)
-						if(!GetIsLineOfSightSectorClear(*GetSector(x, y), LOSARGS))
+						if(!GetIsLineOfSightSectorClear(query, *GetSector(x, y), LOSARGS))
 							return false;
 				}
 			}
@@ -569,10 +722,10 @@ CWorld::GetIsLineOfSightClear(const CVector &point1, const CVector &point2, bool
 			y2 = yend;
 			if(y1 < y2) {
 				for(y = y1; y <= y2; y++)
-					if(!GetIsLineOfSightSectorClear(*GetSector(xend, y), LOSARGS)) return false;
+					if(!GetIsLineOfSightSectorClear(query, *GetSector(xend, y), LOSARGS)) return false;
 			} else {
 				for(y = y1; y >= y2; y--)
-					if(!GetIsLineOfSightSectorClear(*GetSector(xend, y), LOSARGS)) return false;
+					if(!GetIsLineOfSightSectorClear(query, *GetSector(xend, y), LOSARGS)) return false;
 			}
 		}
 	}
@@ -583,46 +736,46 @@ CWorld::GetIsLineOfSightClear(const CVector &point1, const CVector &point2, bool
 }
 
 bool
-CWorld::GetIsLineOfSightSectorClear(CSector &sector, const CColLine &line, bool checkBuildings, bool checkVehicles,
-                                    bool checkPeds, bool checkObjects, bool checkDummies, bool ignoreSeeThrough,
-                                    bool ignoreSomeObjects)
+CWorld::GetIsLineOfSightSectorClear(CWorldQuery &query, CSector &sector, const CColLine &line, bool checkBuildings,
+                                    bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies,
+                                    bool ignoreSeeThrough, bool ignoreSomeObjects)
 {
 	if(checkBuildings) {
-		if(!GetIsLineOfSightSectorListClear(sector.m_lists[ENTITYLIST_BUILDINGS], line, ignoreSeeThrough))
+		if(!GetIsLineOfSightSectorListClear(query, sector.m_arrays[ENTITYLIST_BUILDINGS], line, ignoreSeeThrough))
 			return false;
-		if(!GetIsLineOfSightSectorListClear(sector.m_lists[ENTITYLIST_BUILDINGS_OVERLAP], line,
+		if(!GetIsLineOfSightSectorListClear(query, sector.m_arrays[ENTITYLIST_BUILDINGS_OVERLAP], line,
 		                                    ignoreSeeThrough))
 			return false;
 	}
 
 	if(checkVehicles) {
-		if(!GetIsLineOfSightSectorListClear(sector.m_lists[ENTITYLIST_VEHICLES], line, ignoreSeeThrough))
+		if(!GetIsLineOfSightSectorListClear(query, sector.m_arrays[ENTITYLIST_VEHICLES], line, ignoreSeeThrough))
 			return false;
-		if(!GetIsLineOfSightSectorListClear(sector.m_lists[ENTITYLIST_VEHICLES_OVERLAP], line,
+		if(!GetIsLineOfSightSectorListClear(query, sector.m_arrays[ENTITYLIST_VEHICLES_OVERLAP], line,
 		                                    ignoreSeeThrough))
 			return false;
 	}
 
 	if(checkPeds) {
-		if(!GetIsLineOfSightSectorListClear(sector.m_lists[ENTITYLIST_PEDS], line, ignoreSeeThrough))
+		if(!GetIsLineOfSightSectorListClear(query, sector.m_arrays[ENTITYLIST_PEDS], line, ignoreSeeThrough))
 			return false;
-		if(!GetIsLineOfSightSectorListClear(sector.m_lists[ENTITYLIST_PEDS_OVERLAP], line, ignoreSeeThrough))
+		if(!GetIsLineOfSightSectorListClear(query, sector.m_arrays[ENTITYLIST_PEDS_OVERLAP], line, ignoreSeeThrough))
 			return false;
 	}
 
 	if(checkObjects) {
-		if(!GetIsLineOfSightSectorListClear(sector.m_lists[ENTITYLIST_OBJECTS], line, ignoreSeeThrough,
+		if(!GetIsLineOfSightSectorListClear(query, sector.m_arrays[ENTITYLIST_OBJECTS], line, ignoreSeeThrough,
 		                                    ignoreSomeObjects))
 			return false;
-		if(!GetIsLineOfSightSectorListClear(sector.m_lists[ENTITYLIST_OBJECTS_OVERLAP], line, ignoreSeeThrough,
+		if(!GetIsLineOfSightSectorListClear(query, sector.m_arrays[ENTITYLIST_OBJECTS_OVERLAP], line, ignoreSeeThrough,
 		                                    ignoreSomeObjects))
 			return false;
 	}
 
 	if(checkDummies) {
-		if(!GetIsLineOfSightSectorListClear(sector.m_lists[ENTITYLIST_DUMMIES], line, ignoreSeeThrough))
+		if(!GetIsLineOfSightSectorListClear(query, sector.m_arrays[ENTITYLIST_DUMMIES], line, ignoreSeeThrough))
 			return false;
-		if(!GetIsLineOfSightSectorListClear(sector.m_lists[ENTITYLIST_DUMMIES_OVERLAP], line, ignoreSeeThrough))
+		if(!GetIsLineOfSightSectorListClear(query, sector.m_arrays[ENTITYLIST_DUMMIES_OVERLAP], line, ignoreSeeThrough))
 			return false;
 	}
 
@@ -630,20 +783,19 @@ CWorld::GetIsLineOfSightSectorClear(CSector &sector, const CColLine &line, bool
 }
 
 bool
-CWorld::GetIsLineOfSightSectorListClear(CPtrList &list, const CColLine &line, bool ignoreSeeThrough,
-                                        bool ignoreSomeObjects)
+CWorld::GetIsLineOfSightSectorListClear(CWorldQuery &query, CSectorEntityArray &list, const CColLine &line,
+                                        bool ignoreSeeThrough, bool ignoreSomeObjects)
 {
-	CPtrNode *node;
 	CEntity *e;
 	CColModel *colmodel;
 
-	for(node = list.first; node; node = node->next) {
-		e = (CEntity *)node->item;
-		if(e->m_scanCode != GetCurrentScanCode() && e->bUsesCollision) {
-
-			e->m_scanCode = GetCurrentScanCode();
+	for(int32 i = 0; i < list.numEntries; i++) {
+		if(list.staticBounds && LineMissesCachedBounds(list, i, line))
+			continue;
+		e = list.entities[i];
+		if(e->bUsesCollision && query.Visit(e)) {
 
-			if(e != pIgnoreEntity && !(ignoreSomeObjects && CameraToIgnoreThisObject(e))) {
+			if(e != query.pIgnoreEntity && !(ignoreSomeObjects && CameraToIgnoreThisObject(e))) {
 
 				colmodel = CModelInfo::GetColModel(e->GetModelIndex());
 
@@ -656,25 +808,316 @@ CWorld::GetIsLineOfSightSectorListClear(CPtrList &list, const CColLine &line, bo
 	return true;
 }
 
+// Batched line of sight.
+// Rays are handled in chunks of up to LOS_BATCH_CHUNK so a set of rays fits in a mask.
+// Every sector touched by a chunk is walked once for all of its rays, entities are
+// gathered with the mask of rays that may hit them, merged, and then tested once
+// per ray with a col model fetched once per entity.
+
+#define LOS_BATCH_CHUNK 32
+#define LOS_BATCH_MAX_SECTORS 1024
+#define LOS_BATCH_MAX_CANDIDATES 512
+
+struct tLosBatchSector
+{
+	int32 sector;
+	uint32 rays;
+};
+
+struct tLosBatchCandidate
+{
+	CEntity *entity;
+	uint32 rays;
+	bool deadPeds;
+};
+
+static int
+CompareLosBatchSectors(const void *a, const void *b)
+{
+	return ((tLosBatchSector*)a)->sector - ((tLosBatchSector*)b)->sector;
+}
+
+static int
+CompareLosBatchCandidates(const void *a, const void *b)
+{
+	uintptr ea = (uintptr)((tLosBatchCandidate*)a)->entity;
+	uintptr eb = (uintptr)((tLosBatchCandidate*)b)->entity;
+	return ea < eb ? -1 : ea > eb ? 1 : 0;
+}
+
+// Same sectors ProcessLineOfSight steps through, as x + y*NUMSECTORS_X.
+// Returns -1 if they don't fit.
+static int32
+GetSectorsAlongLine(const CVector &point1, const CVector &point2, int32 *sectors, int32 maxSectors)
+{
+	int x, xstart, xend;
+	int y, ystart, yend;
+	int y1, y2;
+	int32 n = 0;
+
+	xstart = CWorld::GetSectorIndexX(point1.x);
+	ystart = CWorld::GetSectorIndexY(point1.y);
+	xend = CWorld::GetSectorIndexX(point2.x);
+	yend = CWorld::GetSectorIndexY(point2.y);
+
+#define ADDSECTOR(sx, sy) { if(n >= maxSectors) return -1; sectors[n++] = (sx) + (sy)*NUMSECTORS_X; }
+#define ADDCOLUMN(sx, ya, yb) \
+	if(ya < yb) { for(y = ya; y <= yb; y++) ADDSECTOR(sx, y) } \
+	else { for(y = ya; y >= yb; y--) ADDSECTOR(sx, y) }
+
+	if(xstart == xend) {
+		ADDCOLUMN(xstart, ystart, yend)
+	} else if(ystart == yend) {
+		if(xstart < xend)
+			for(x = xstart; x <= xend; x++) ADDSECTOR(x, ystart)
+		else
+			for(x = xstart; x >= xend; x--) ADDSECTOR(x, ystart)
+	} else {
+		float m = (point2.y - point1.y) / (point2.x - point1.x);
+		if(point1.x < point2.x) {
+			// Step from left to right
+			y1 = ystart;
+			y2 = CWorld::GetSectorIndexY((CWorld::GetWorldX(xstart + 1) - point1.x) * m + point1.y);
+			ADDCOLUMN(xstart, y1, y2)
+			for(x = xstart + 1; x < xend; x++) {
+				y1 = y2;
+				y2 = CWorld::GetSectorIndexY((CWorld::GetWorldX(x + 1) - point1.x) * m + point1.y);
+				ADDCOLUMN(x, y1, y2)
+			}
+			ADDCOLUMN(xend, y2, yend)
+		} else {
+			// Step from right to left
+			y1 = ystart;
+			y2 = CWorld::GetSectorIndexY((CWorld::GetWorldX(xstart) - point1.x) * m + point1.y);
+			ADDCOLUMN(xstart, y1, y2)
+			for(x = xstart - 1; x > xend; x--) {
+				y1 = y2;
+				y2 = CWorld::GetSectorIndexY((CWorld::GetWorldX(x) - point1.x) * m + point1.y);
+				ADDCOLUMN(x, y1, y2)
+			}
+			ADDCOLUMN(xend, y2, yend)
+		}
+	}
+
+#undef ADDCOLUMN
+#undef ADDSECTOR
+	return n;
+}
+
+// Tests the gathered entities against their rays and empties the candidate list.
+static void
+FlushLosBatchCandidates(tLosBatchCandidate *candidates, int32 &numCandidates, CWorldLosRay *rays, const CColLine *lines,
+                        uint32 &raysLeft, bool clearTest)
+{
+	int32 i, j, r;
+
+	qsort(candidates, numCandidates, sizeof(tLosBatchCandidate), CompareLosBatchCandidates);
+
+	for(i = 0; i < numCandidates; i = j) {
+		CEntity *e = candidates[i].entity;
+		uint32 mask = 0;
+		bool deadPeds = false;
+		for(j = i; j < numCandidates && candidates[j].entity == e; j++) {
+			mask |= candidates[j].rays;
+			deadPeds |= candidates[j].deadPeds;
+		}
+		mask &= raysLeft;
+		if(mask == 0)
+			continue;
+
+		CColModel *colmodel = clearTest ? CModelInfo::GetColModel(e->GetModelIndex()) : GetLineOfSightColModel(e, deadPeds);
+		if(colmodel == nil)
+			continue;
+		const CMatrix &matrix = e->GetMatrix();
+		for(r = 0; r < LOS_BATCH_CHUNK; r++) {
+			if((mask & (1u << r)) == 0)
+				continue;
+			CWorldLosRay &ray = rays[r];
+			bool ignoreSeeThrough = !!(ray.flags & LOS_IGNORESEETHROUGH);
+			if(clearTest) {
+				if(CCollision::TestLineOfSight(lines[r], matrix, *colmodel, ignoreSeeThrough)) {
+					ray.hit = true;
+					ray.entity = e;
+					ray.dist = 0.0f;
+					raysLeft &= ~(1u << r);
+				}
+			} else if(CCollision::ProcessLineOfSight(lines[r], matrix, *colmodel, ray.point, ray.dist, ignoreSeeThrough)) {
+				ray.hit = true;
+				ray.entity = e;
+			}
+		}
+	}
+
+	numCandidates = 0;
+}
+
+static int32
+LineOfSightBatchChunk(CWorldQuery &query, CWorldLosRay *rays, int32 numRays, bool clearTest)
+{
+	static const uint32 listFlags[NUMSECTORENTITYLISTS] = {
+		LOS_BUILDINGS, LOS_BUILDINGS,
+		LOS_OBJECTS, LOS_OBJECTS,
+		LOS_VEHICLES, LOS_VEHICLES,
+		LOS_PEDS, LOS_PEDS,
+		LOS_DUMMIES, LOS_DUMMIES
+	};
+	CColLine lines[LOS_BATCH_CHUNK];
+	uint32 listRays[NUMSECTORENTITYLISTS];
+	uint32 ignoreSomeObjectsRays = 0;
+	uint32 raysLeft = 0;
+	tLosBatchSector sectors[LOS_BATCH_MAX_SECTORS];
+	int32 raySectors[NUMSECTORS_X + NUMSECTORS_Y];
+	tLosBatchCandidate candidates[LOS_BATCH_MAX_CANDIDATES];
+	int32 numSectors = 0;
+	int32 numCandidates = 0;
+	int32 i, j, k, l, r;
+
+	for(l = 0; l < NUMSECTORENTITYLISTS; l++)
+		listRays[l] = 0;
+
+	for(r = 0; r < numRays; r++) {
+		CWorldLosRay &ray = rays[r];
+		ray.entity = nil;
+		ray.dist = 1.0f;
+		ray.hit = false;
+		lines[r].Set(ray.point1, ray.point2);
+
+		int32 n = GetSectorsAlongLine(ray.point1, ray.point2, raySectors, ARRAY_SIZE(raySectors));
+		if(n < 0 || numSectors + n > LOS_BATCH_MAX_SECTORS) {
+			// doesn't fit, do this one on its own
+			if(clearTest)
+				ray.hit = !CWorld::GetIsLineOfSightClear(query, ray.point1, ray.point2,
+					!!(ray.flags & LOS_BUILDINGS), !!(ray.flags & LOS_VEHICLES), !!(ray.flags & LOS_PEDS),
+					!!(ray.flags & LOS_OBJECTS), !!(ray.flags & LOS_DUMMIES),
+					!!(ray.flags & LOS_IGNORESEETHROUGH), !!(ray.flags & LOS_IGNORESOMEOBJECTS));
+			else if(CWorld::ProcessLineOfSight(query, ray.point1, ray.point2, ray.point, ray.entity,
+					!!(ray.flags & LOS_BUILDINGS), !!(ray.flags & LOS_VEHICLES), !!(ray.flags & LOS_PEDS),
+					!!(ray.flags & LOS_OBJECTS), !!(ray.flags & LOS_DUMMIES),
+					!!(ray.flags & LOS_IGNORESEETHROUGH), !!(ray.flags & LOS_IGNORESOMEOBJECTS))) {
+				ray.hit = true;
+				ray.dist = (ray.point.point - ray.point1).Magnitude() / (ray.point2 - ray.point1).Magnitude();
+			}
+			continue;
+		}
+		for(i = 0; i < n; i++) {
+			sectors[numSectors].sector = raySectors[i];
+			sectors[numSectors].rays = 1u << r;
+			numSectors++;
+		}
+
+		raysLeft |= 1u << r;
+		for(l = 0; l < NUMSECTORENTITYLISTS; l++)
+			if(ray.flags & listFlags[l])
+				listRays[l] |= 1u << r;
+		if(ray.flags & LOS_IGNORESOMEOBJECTS)
+			ignoreSomeObjectsRays |= 1u << r;
+	}
+
+	// walk each sector once for all rays that cross it
+	qsort(sectors, numSectors, sizeof(tLosBatchSector), CompareLosBatchSectors);
+	for(i = 0; i < numSectors && raysLeft; i = j) {
+		uint32 sectorRays = 0;
+		for(j = i; j < numSectors && sectors[j].sector == sectors[i].sector; j++)
+			sectorRays |= sectors[j].rays;
+		CSector *sector = CWorld::GetSector(sectors[i].sector % NUMSECTORS_X, sectors[i].sector / NUMSECTORS_X);
+
+		for(l = 0; l < NUMSECTORENTITYLISTS; l++) {
+			uint32 wantRays = sectorRays & listRays[l] & raysLeft;
+			if(wantRays == 0)
+				continue;
+			CSectorEntityArray &list = sector->m_arrays[l];
+			bool pedList = listFlags[l] == LOS_PEDS;
+			bool deadPeds = pedList && query.bIncludeDeadPeds && !clearTest;
+
+			for(k = 0; k < list.numEntries; k++) {
+				CEntity *e = list.entities[k];
+				if(e == query.pIgnoreEntity || !(e->bUsesCollision || deadPeds))
+					continue;
+
+				uint32 entRays = wantRays;
+				if(list.staticBounds) {
+					// shared bounding test, the sphere is loaded once for all rays
+					for(r = 0; r < numRays; r++)
+						if((entRays & (1u << r)) && LineMissesCachedBounds(list, k, lines[r]))
+							entRays &= ~(1u << r);
+					if(entRays == 0)
+						continue;
+				}
+				if(listFlags[l] == LOS_OBJECTS && (entRays & ignoreSomeObjectsRays) && CWorld::CameraToIgnoreThisObject(e)) {
+					entRays &= ~ignoreSomeObjectsRays;
+					if(entRays == 0)
+						continue;
+				}
+
+				if(numCandidates == LOS_BATCH_MAX_CANDIDATES)
+					FlushLosBatchCandidates(candidates, numCandidates, rays, lines, raysLeft, clearTest);
+				candidates[numCandidates].entity = e;
+				candidates[numCandidates].rays = entRays;
+				candidates[numCandidates].deadPeds = deadPeds;
+				numCandidates++;
+			}
+		}
+	}
+	FlushLosBatchCandidates(candidates, numCandidates, rays, lines, raysLeft, clearTest);
+
+	int32 numHit = 0;
+	for(r = 0; r < numRays; r++)
+		if(rays[r].hit)
+			numHit++;
+	return numHit;
+}
+
+int32
+CWorld::ProcessLineOfSightBatch(CWorldLosRay *rays, int32 numRays)
+{
+	ms_mainQuery.pIgnoreEntity = pIgnoreEntity;
+	ms_mainQuery.bIncludeDeadPeds = bIncludeDeadPeds;
+	return ProcessLineOfSightBatch(ms_mainQuery, rays, numRays);
+}
+
+int32
+CWorld::ProcessLineOfSightBatch(CWorldQuery &query, CWorldLosRay *rays, int32 numRays)
+{
+	int32 numHit = 0;
+	for(int32 i = 0; i < numRays; i += LOS_BATCH_CHUNK)
+		numHit += LineOfSightBatchChunk(query, &rays[i], Min(numRays - i, LOS_BATCH_CHUNK), false);
+	return numHit;
+}
+
+int32
+CWorld::GetIsLineOfSightClearBatch(CWorldLosRay *rays, int32 numRays)
+{
+	ms_mainQuery.pIgnoreEntity = pIgnoreEntity;
+	return GetIsLineOfSightClearBatch(ms_mainQuery, rays, numRays);
+}
+
+int32
+CWorld::GetIsLineOfSightClearBatch(CWorldQuery &query, CWorldLosRay *rays, int32 numRays)
+{
+	int32 numBlocked = 0;
+	for(int32 i = 0; i < numRays; i += LOS_BATCH_CHUNK)
+		numBlocked += LineOfSightBatchChunk(query, &rays[i], Min(numRays - i, LOS_BATCH_CHUNK), true);
+	return numBlocked;
+}
+
 void
-CWorld::FindObjectsInRangeSectorList(CPtrList &list, Const CVector &centre, float radius, bool ignoreZ, int16 *numObjects,
-                                     int16 lastObject, CEntity **objects)
+CWorld::FindObjectsInRangeSectorList(CWorldQuery &query, CSectorEntityArray &list, Const CVector &centre, float radius,
+                                     bool ignoreZ, int16 *numObjects, int16 lastObject, CEntity **objects,
+                                     WorldQueryFilter filter, void *filterData)
 {
 	float radiusSqr = radius * radius;
 	float objDistSqr;
 
-	for(CPtrNode *node = list.first; node; node = node->next) {
-		CEntity *object = (CEntity *)node->item;
-		if(object->m_scanCode != GetCurrentScanCode()) {
-			object->m_scanCode = GetCurrentScanCode();
-
+	for(int32 i = 0; i < list.numEntries; i++) {
+		CEntity *object = list.entities[i];
+		if(query.Visit(object)) {
 			CVector diff = centre - object->GetPosition();
 			if(ignoreZ)
 				objDistSqr = diff.MagnitudeSqr2D();
 			else
 				objDistSqr = diff.MagnitudeSqr();
 
-			if(objDistSqr < radiusSqr && *numObjects < lastObject) {
+			if(objDistSqr < radiusSqr && *numObjects < lastObject && (filter == nil || filter(object, filterData))) {
 				if(objects) { objects[*numObjects] = object; }
 				(*numObjects)++;
 			}
@@ -686,6 +1129,16 @@ void
 CWorld::FindObjectsInRange(Const CVector &centre, float radius, bool ignoreZ, int16 *numObjects, int16 lastObject,
                            CEntity **objects, bool checkBuildings, bool checkVehicles, bool checkPeds,
                            bool checkObjects, bool checkDummies)
+{
+	FindObjectsInRange(ms_mainQuery, centre, radius, ignoreZ, numObjects, lastObject, objects, checkBuildings,
+	                   checkVehicles, checkPeds, checkObjects, checkDummies);
+}
+
+void
+CWorld::FindObjectsInRange(CWorldQuery &query, Const CVector &centre, float radius, bool ignoreZ, int16 *numObjects,
+                           int16 lastObject, CEntity **objects, bool checkBuildings, bool checkVehicles,
+                           bool checkPeds, bool checkObjects, bool checkDummies, WorldQueryFilter filter,
+                           void *filterData)
 {
 	int minX = GetSectorIndexX(centre.x - radius);
 	if(minX <= 0) minX = 0;
@@ -707,46 +1160,162 @@ CWorld::FindObjectsInRange(Const CVector &centre, float radius, bool ignoreZ, in
 	if(maxY >= NUMSECTORS_Y) maxY = NUMSECTORS_Y;
 #endif
 
-	AdvanceCurrentScanCode();
+	query.Begin();
 
 	*numObjects = 0;
 	for(int curY = minY; curY <= maxY; curY++) {
 		for(int curX = minX; curX <= maxX; curX++) {
 			CSector *sector = GetSector(curX, curY);
 			if(checkBuildings) {
-				FindObjectsInRangeSectorList(sector->m_lists[ENTITYLIST_BUILDINGS], centre, radius,
-				                             ignoreZ, numObjects, lastObject, objects);
-				FindObjectsInRangeSectorList(sector->m_lists[ENTITYLIST_BUILDINGS_OVERLAP], centre,
-				                             radius, ignoreZ, numObjects, lastObject, objects);
+				FindObjectsInRangeSectorList(query, sector->m_arrays[ENTITYLIST_BUILDINGS], centre, radius,
+				                             ignoreZ, numObjects, lastObject, objects, filter, filterData);
+				FindObjectsInRangeSectorList(query, sector->m_arrays[ENTITYLIST_BUILDINGS_OVERLAP], centre,
+				                             radius, ignoreZ, numObjects, lastObject, objects, filter, filterData);
 			}
 			if(checkVehicles) {
-				FindObjectsInRangeSectorList(sector->m_lists[ENTITYLIST_VEHICLES], centre, radius,
-				                             ignoreZ, numObjects, lastObject, objects);
-				FindObjectsInRangeSectorList(sector->m_lists[ENTITYLIST_VEHICLES_OVERLAP], centre,
-				                             radius, ignoreZ, numObjects, lastObject, objects);
+				FindObjectsInRangeSectorList(query, sector->m_arrays[ENTITYLIST_VEHICLES], centre, radius,
+				                             ignoreZ, numObjects, lastObject, objects, filter, filterData);
+				FindObjectsInRangeSectorList(query, sector->m_arrays[ENTITYLIST_VEHICLES_OVERLAP], centre,
+				                             radius, ignoreZ, numObjects, lastObject, objects, filter, filterData);
 			}
 			if(checkPeds) {
-				FindObjectsInRangeSectorList(sector->m_lists[ENTITYLIST_PEDS], centre, radius, ignoreZ,
-				                             numObjects, lastObject, objects);
-				FindObjectsInRangeSectorList(sector->m_lists[ENTITYLIST_PEDS_OVERLAP], centre, radius,
-				                             ignoreZ, numObjects, lastObject, objects);
+				FindObjectsInRangeSectorList(query, sector->m_arrays[ENTITYLIST_PEDS], centre, radius, ignoreZ,
+				                             numObjects, lastObject, objects, filter, filterData);
+				FindObjectsInRangeSectorList(query, sector->m_arrays[ENTITYLIST_PEDS_OVERLAP], centre, radius,
+				                             ignoreZ, numObjects, lastObject, objects, filter, filterData);
 			}
 			if(checkObjects) {
-				FindObjectsInRangeSectorList(sector->m_lists[ENTITYLIST_OBJECTS], centre, radius,
-				                             ignoreZ, numObjects, lastObject, objects);
-				FindObjectsInRangeSectorList(sector->m_lists[ENTITYLIST_OBJECTS_OVERLAP], centre,
-				                             radius, ignoreZ, numObjects, lastObject, objects);
+				FindObjectsInRangeSectorList(query, sector->m_arrays[ENTITYLIST_OBJECTS], centre, radius,
+				                             ignoreZ, numObjects, lastObject, objects, filter, filterData);
+				FindObjectsInRangeSectorList(query, sector->m_arrays[ENTITYLIST_OBJECTS_OVERLAP], centre,
+				                             radius, ignoreZ, numObjects, lastObject, objects, filter, filterData);
 			}
 			if(checkDummies) {
-				FindObjectsInRangeSectorList(sector->m_lists[ENTITYLIST_DUMMIES], centre, radius,
-				                             ignoreZ, numObjects, lastObject, objects);
-				FindObjectsInRangeSectorList(sector->m_lists[ENTITYLIST_DUMMIES_OVERLAP], centre,
-				                             radius, ignoreZ, numObjects, lastObject, objects);
+				FindObjectsInRangeSectorList(query, sector->m_arrays[ENTITYLIST_DUMMIES], centre, radius,
+				                             ignoreZ, numObjects, lastObject, objects, filter, filterData);
+				FindObjectsInRangeSectorList(query, sector->m_arrays[ENTITYLIST_DUMMIES_OVERLAP], centre,
+				                             radius, ignoreZ, numObjects, lastObject, objects, filter, filterData);
 			}
 		}
 	}
 }
 
+static const int32 aNearestObjectsLists[][2] = {
+	{ LOS_BUILDINGS, ENTITYLIST_BUILDINGS },
+	{ LOS_BUILDINGS, ENTITYLIST_BUILDINGS_OVERLAP },
+	{ LOS_VEHICLES, ENTITYLIST_VEHICLES },
+	{ LOS_VEHICLES, ENTITYLIST_VEHICLES_OVERLAP },
+	{ LOS_PEDS, ENTITYLIST_PEDS },
+	{ LOS_PEDS, ENTITYLIST_PEDS_OVERLAP },
+	{ LOS_OBJECTS, ENTITYLIST_OBJECTS },
+	{ LOS_OBJECTS, ENTITYLIST_OBJECTS_OVERLAP },
+	{ LOS_DUMMIES, ENTITYLIST_DUMMIES },
+	{ LOS_DUMMIES, ENTITYLIST_DUMMIES_OVERLAP }
+};
+
+void
+CWorld::FindNearestObjectsSectorList(CWorldQuery &query, CSectorEntityArray &list, Const CVector &centre, bool ignoreZ,
+                                     int32 maxObjects, int32 *numObjects, CEntity **objects, float *distancesSqr,
+                                     float *maxDistSqr, WorldQueryFilter filter, void *filterData)
+{
+	for(int32 i = 0; i < list.numEntries; i++) {
+		CEntity *object = list.entities[i];
+		if(!query.Visit(object))
+			continue;
+		CVector diff = centre - object->GetPosition();
+		float distSqr = ignoreZ ? diff.MagnitudeSqr2D() : diff.MagnitudeSqr();
+		// distance first, the filter may be expensive
+		if(distSqr >= *maxDistSqr)
+			continue;
+		if(filter && !filter(object, filterData))
+			continue;
+
+		// insertion sort, maxObjects is small
+		int32 j = *numObjects < maxObjects ? (*numObjects)++ : maxObjects - 1;
+		for(; j > 0 && distancesSqr[j - 1] > distSqr; j--) {
+			objects[j] = objects[j - 1];
+			distancesSqr[j] = distancesSqr[j - 1];
+		}
+		objects[j] = object;
+		distancesSqr[j] = distSqr;
+		if(*numObjects == maxObjects)
+			*maxDistSqr = distancesSqr[maxObjects - 1];
+	}
+}
+
+int32
+CWorld::FindNearestObjects(Const CVector &centre, float radius, bool ignoreZ, int32 maxObjects, CEntity **objects,
+                           float *distancesSqr, uint32 flags, WorldQueryFilter filter, void *filterData)
+{
+	return FindNearestObjects(ms_mainQuery, centre, radius, ignoreZ, maxObjects, objects, distancesSqr, flags,
+	                          filter, filterData);
+}
+
+// Walks the sectors in rings around the centre sector and stops as soon as
+// nothing in the next ring can be closer than what was found already.
+int32
+CWorld::FindNearestObjects(CWorldQuery &query, Const CVector &centre, float radius, bool ignoreZ, int32 maxObjects,
+                           CEntity **objects, float *distancesSqr, uint32 flags, WorldQueryFilter filter,
+                           void *filterData)
+{
+	float tmpDistances[NEARESTOBJECTS_MAX];
+	if(distancesSqr == nil) {
+		assert(maxObjects <= NEARESTOBJECTS_MAX);
+		distancesSqr = tmpDistances;
+		maxObjects = Min(maxObjects, NEARESTOBJECTS_MAX);
+	}
+	if(maxObjects <= 0)
+		return 0;
+
+	int32 minX = Max(GetSectorIndexX(centre.x - radius), 0);
+	int32 minY = Max(GetSectorIndexY(centre.y - radius), 0);
+	int32 maxX = Min(GetSectorIndexX(centre.x + radius), NUMSECTORS_X - 1);
+	int32 maxY = Min(GetSectorIndexY(centre.y + radius), NUMSECTORS_Y - 1);
+	int32 centreX = Clamp(GetSectorIndexX(centre.x), 0, NUMSECTORS_X - 1);
+	int32 centreY = Clamp(GetSectorIndexY(centre.y), 0, NUMSECTORS_Y - 1);
+	int32 maxRing = Max(Max(centreX - minX, maxX - centreX), Max(centreY - minY, maxY - centreY));
+
+	query.Begin();
+
+	int32 numObjects = 0;
+	float maxDistSqr = SQR(radius);
+	for(int32 ring = 0; ring <= maxRing; ring++) {
+		for(int32 y = Max(centreY - ring, minY); y <= Min(centreY + ring, maxY); y++) {
+			// inner rows only have the two sectors at the ends of the ring
+			bool edgeRow = y == centreY - ring || y == centreY + ring;
+			int32 step = edgeRow ? 1 : 2*ring;
+			for(int32 x = centreX - ring; x <= centreX + ring; x += step) {
+				if(x < minX || x > maxX)
+					continue;
+				CSector *sector = GetSector(x, y);
+				for(int32 i = 0; i < ARRAY_SIZE(aNearestObjectsLists); i++)
+					if(flags & aNearestObjectsLists[i][0])
+						FindNearestObjectsSectorList(query, sector->m_arrays[aNearestObjectsLists[i][1]],
+						                             centre, ignoreZ, maxObjects, &numObjects, objects,
+						                             distancesSqr, &maxDistSqr, filter, filterData);
+			}
+		}
+
+		// anything outside the rings done so far is at least this far away
+		float nextDist = Min(Min(centre.x - GetWorldX(centreX - ring), GetWorldX(centreX + ring + 1) - centre.x),
+		                     Min(centre.y - GetWorldY(centreY - ring), GetWorldY(centreY + ring + 1) - centre.y));
+		if(nextDist > 0.0f && SQR(nextDist) >= maxDistSqr)
+			break;
+	}
+	return numObjects;
+}
+
+CEntity *
+CWorld::FindNearestObject(Const CVector &centre, float radius, bool ignoreZ, uint32 flags, WorldQueryFilter filter,
+                          void *filterData)
+{
+	CEntity *object;
+	float distSqr;
+	if(FindNearestObjects(ms_mainQuery, centre, radius, ignoreZ, 1, &object, &distSqr, flags, filter, filterData) == 0)
+		return nil;
+	return object;
+}
+
 void
 CWorld::FindObjectsOfTypeInRangeSectorList(uint32 modelId, CPtrList &list, const CVector &position, float radius,
                                            bool bCheck2DOnly, int16 *nEntitiesFound, int16 maxEntitiesToFind,
@@ -771,6 +1340,30 @@ CWorld::FindObjectsOfTypeInRangeSectorList(uint32 modelId, CPtrList &list, const
 	}
 }
 
+void
+CWorld::FindObjectsOfTypeInRangeSectorList(uint32 modelId, CSectorEntityArray &list, const CVector &position, float radius,
+                                           bool bCheck2DOnly, int16 *nEntitiesFound, int16 maxEntitiesToFind,
+                                           CEntity **aEntities)
+{
+	for(int32 i = 0; i < list.numEntries; i++) {
+		CEntity *pEntity = list.entities[i];
+		if(pEntity->m_scanCode != GetCurrentScanCode()) {
+			pEntity->m_scanCode = GetCurrentScanCode();
+			if (modelId == pEntity->GetModelIndex()) {
+				float fMagnitude = 0.0f;
+				if(bCheck2DOnly)
+					fMagnitude = (position - pEntity->GetPosition()).MagnitudeSqr2D();
+				else
+					fMagnitude = (position - pEntity->GetPosition()).MagnitudeSqr();
+				if(fMagnitude < radius * radius && *nEntitiesFound < maxEntitiesToFind) {
+					if(aEntities) aEntities[*nEntitiesFound] = pEntity;
+					++*nEntitiesFound;
+				}
+			}
+		}
+	}
+}
+
 void
 CWorld::FindObjectsOfTypeInRange(uint32 modelId, const CVector &position, float radius, bool bCheck2DOnly,
                                  int16 *nEntitiesFound, int16 maxEntitiesToFind, CEntity **aEntities, bool bBuildings,
@@ -789,42 +1382,42 @@ CWorld::FindObjectsOfTypeInRange(uint32 modelId, const CVector &position, float
 			CSector *pSector = GetSector(x, y);
 			if(bBuildings) {
 				FindObjectsOfTypeInRangeSectorList(
-				    modelId, pSector->m_lists[ENTITYLIST_BUILDINGS], position, radius, bCheck2DOnly,
+				    modelId, pSector->m_arrays[ENTITYLIST_BUILDINGS], position, radius, bCheck2DOnly,
 				    nEntitiesFound, maxEntitiesToFind, aEntities);
 				FindObjectsOfTypeInRangeSectorList(
-				    modelId, pSector->m_lists[ENTITYLIST_BUILDINGS_OVERLAP], position, radius,
+				    modelId, pSector->m_arrays[ENTITYLIST_BUILDINGS_OVERLAP], position, radius,
 				    bCheck2DOnly, nEntitiesFound, maxEntitiesToFind, aEntities);
 			}
 			if(bVehicles) {
 				FindObjectsOfTypeInRangeSectorList(
-				    modelId, pSector->m_lists[ENTITYLIST_VEHICLES], position, radius, bCheck2DOnly,
+				    modelId, pSector->m_arrays[ENTITYLIST_VEHICLES], position, radius, bCheck2DOnly,
 				    nEntitiesFound, maxEntitiesToFind, aEntities);
 				FindObjectsOfTypeInRangeSectorList(
-				    modelId, pSector->m_lists[ENTITYLIST_VEHICLES_OVERLAP], position, radius,
+				    modelId, pSector->m_arrays[ENTITYLIST_VEHICLES_OVERLAP], position, radius,
 				    bCheck2DOnly, nEntitiesFound, maxEntitiesToFind, aEntities);
 			}
 			if(bPeds) {
 				FindObjectsOfTypeInRangeSectorList(
-				    modelId, pSector->m_lists[ENTITYLIST_PEDS], position, radius, bCheck2DOnly,
+				    modelId, pSector->m_arrays[ENTITYLIST_PEDS], position, radius, bCheck2DOnly,
 				    nEntitiesFound, maxEntitiesToFind, aEntities);
 				FindObjectsOfTypeInRangeSectorList(
-				    modelId, pSector->m_lists[ENTITYLIST_PEDS_OVERLAP], position, radius, bCheck2DOnly,
+				    modelId, pSector->m_arrays[ENTITYLIST_PEDS_OVERLAP], position, radius, bCheck2DOnly,
 				    nEntitiesFound, maxEntitiesToFind, aEntities);
 			}
 			if(bObjects) {
 				FindObjectsOfTypeInRangeSectorList(
-				    modelId, pSector->m_lists[ENTITYLIST_OBJECTS], position, radius, bCheck2DOnly,
+				    modelId, pSector->m_arrays[ENTITYLIST_OBJECTS], position, radius, bCheck2DOnly,
 				    nEntitiesFound, maxEntitiesToFind, aEntities);
 				FindObjectsOfTypeInRangeSectorList(
-				    modelId, pSector->m_lists[ENTITYLIST_OBJECTS_OVERLAP], position, radius,
+				    modelId, pSector->m_arrays[ENTITYLIST_OBJECTS_OVERLAP], position, radius,
 				    bCheck2DOnly, nEntitiesFound, maxEntitiesToFind, aEntities);
 			}
 			if(bDummies) {
 				FindObjectsOfTypeInRangeSectorList(
-				    modelId, pSector->m_lists[ENTITYLIST_DUMMIES], position, radius, bCheck2DOnly,
+				    modelId, pSector->m_arrays[ENTITYLIST_DUMMIES], position, radius, bCheck2DOnly,
 				    nEntitiesFound, maxEntitiesToFind, aEntities);
 				FindObjectsOfTypeInRangeSectorList(
-				    modelId, pSector->m_lists[ENTITYLIST_DUMMIES_OVERLAP], position, radius,
+				    modelId, pSector->m_arrays[ENTITYLIST_DUMMIES_OVERLAP], position, radius,
 				    bCheck2DOnly, nEntitiesFound, maxEntitiesToFind, aEntities);
 			}
 		}
@@ -835,6 +1428,18 @@ CEntity *
 CWorld::TestSphereAgainstWorld(CVector centre, float radius, CEntity *entityToIgnore, bool checkBuildings,
                                bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies,
                                bool ignoreSomeObjects)
+{
+	CEntity *foundE = TestSphereAgainstWorld(ms_mainQuery, centre, radius, entityToIgnore, checkBuildings,
+	                                         checkVehicles, checkPeds, checkObjects, checkDummies, ignoreSomeObjects);
+	if(foundE)
+		gaTempSphereColPoints[0] = ms_mainQuery.sphereColPoint;
+	return foundE;
+}
+
+CEntity *
+CWorld::TestSphereAgainstWorld(CWorldQuery &query, CVector centre, float radius, CEntity *entityToIgnore,
+                               bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects,
+                               bool checkDummies, bool ignoreSomeObjects)
 {
 	CEntity *foundE = nil;
 
@@ -858,53 +1463,53 @@ CWorld::TestSphereAgainstWorld(CVector centre, float radius, CEntity *entityToIg
 	if(maxY >= NUMSECTORS_Y) maxY = NUMSECTORS_Y;
 #endif
 
-	AdvanceCurrentScanCode();
+	query.Begin();
 
 	for(int curY = minY; curY <= maxY; curY++) {
 		for(int curX = minX; curX <= maxX; curX++) {
 			CSector *sector = GetSector(curX, curY);
 			if(checkBuildings) {
-				foundE = TestSphereAgainstSectorList(sector->m_lists[ENTITYLIST_BUILDINGS], centre,
+				foundE = TestSphereAgainstSectorList(query, sector->m_arrays[ENTITYLIST_BUILDINGS], centre,
 				                                     radius, entityToIgnore, false);
 				if(foundE) return foundE;
 
-				foundE = TestSphereAgainstSectorList(sector->m_lists[ENTITYLIST_BUILDINGS_OVERLAP],
+				foundE = TestSphereAgainstSectorList(query, sector->m_arrays[ENTITYLIST_BUILDINGS_OVERLAP],
 				                                     centre, radius, entityToIgnore, false);
 				if(foundE) return foundE;
 			}
 			if(checkVehicles) {
-				foundE = TestSphereAgainstSectorList(sector->m_lists[ENTITYLIST_VEHICLES], centre,
+				foundE = TestSphereAgainstSectorList(query, sector->m_arrays[ENTITYLIST_VEHICLES], centre,
 				                                     radius, entityToIgnore, false);
 				if(foundE) return foundE;
 
-				foundE = TestSphereAgainstSectorList(sector->m_lists[ENTITYLIST_VEHICLES_OVERLAP],
+				foundE = TestSphereAgainstSectorList(query, sector->m_arrays[ENTITYLIST_VEHICLES_OVERLAP],
 				                                     centre, radius, entityToIgnore, false);
 				if(foundE) return foundE;
 			}
 			if(checkPeds) {
-				foundE = TestSphereAgainstSectorList(sector->m_lists[ENTITYLIST_PEDS], centre, radius,
+				foundE = TestSphereAgainstSectorList(query, sector->m_arrays[ENTITYLIST_PEDS], centre, radius,
 				                                     entityToIgnore, false);
 				if(foundE) return foundE;
 
-				foundE = TestSphereAgainstSectorList(sector->m_lists[ENTITYLIST_PEDS_OVERLAP], centre,
+				foundE = TestSphereAgainstSectorList(query, sector->m_arrays[ENTITYLIST_PEDS_OVERLAP], centre,
 				                                     radius, entityToIgnore, false);
 				if(foundE) return foundE;
 			}
 			if(checkObjects) {
-				foundE = TestSphereAgainstSectorList(sector->m_lists[ENTITYLIST_OBJECTS], centre,
+				foundE = TestSphereAgainstSectorList(query, sector->m_arrays[ENTITYLIST_OBJECTS], centre,
 				                                     radius, entityToIgnore, ignoreSomeObjects);
 				if(foundE) return foundE;
 
-				foundE = TestSphereAgainstSectorList(sector->m_lists[ENTITYLIST_OBJECTS_OVERLAP],
+				foundE = TestSphereAgainstSectorList(query, sector->m_arrays[ENTITYLIST_OBJECTS_OVERLAP],
 				                                     centre, radius, entityToIgnore, ignoreSomeObjects);
 				if(foundE) return foundE;
 			}
 			if(checkDummies) {
-				foundE = TestSphereAgainstSectorList(sector->m_lists[ENTITYLIST_DUMMIES], centre,
+				foundE = TestSphereAgainstSectorList(query, sector->m_arrays[ENTITYLIST_DUMMIES], centre,
 				                                     radius, entityToIgnore, false);
 				if(foundE) return foundE;
 
-				foundE = TestSphereAgainstSectorList(sector->m_lists[ENTITYLIST_DUMMIES_OVERLAP],
+				foundE = TestSphereAgainstSectorList(query, sector->m_arrays[ENTITYLIST_DUMMIES_OVERLAP],
 				                                     centre, radius, entityToIgnore, false);
 				if(foundE) return foundE;
 			}
@@ -914,10 +1519,10 @@ CWorld::TestSphereAgainstWorld(CVector centre, float radius, CEntity *entityToIg
 }
 
 CEntity *
-CWorld::TestSphereAgainstSectorList(CPtrList &list, CVector spherePos, float radius, CEntity *entityToIgnore,
-                                    bool ignoreSomeObjects)
+CWorld::TestSphereAgainstSectorList(CWorldQuery &query, CSectorEntityArray &list, CVector spherePos, float radius,
+                                    CEntity *entityToIgnore, bool ignoreSomeObjects)
 {
-	static CColModel OurColModel;
+	CColModel OurColModel;
 
 	OurColModel.boundingSphere.center.x = 0.0f;
 	OurColModel.boundingSphere.center.y = 0.0f;
@@ -939,12 +1544,10 @@ CWorld::TestSphereAgainstSectorList(CPtrList &list, CVector spherePos, float rad
 	CMatrix sphereMat;
 	sphereMat.SetTranslate(spherePos);
 
-	for(CPtrNode *node = list.first; node; node = node->next) {
-		CEntity *e = (CEntity *)node->item;
-
-		if(e->m_scanCode != GetCurrentScanCode()) {
-			e->m_scanCode = GetCurrentScanCode();
+	for(int32 i = 0; i < list.numEntries; i++) {
+		CEntity *e = list.entities[i];
 
+		if(query.Visit(e)) {
 			if(e != entityToIgnore && e->bUsesCollision &&
 			   !(ignoreSomeObjects && CameraToIgnoreThisObject(e))) {
 #ifdef FIX_BUGS
@@ -958,7 +1561,7 @@ CWorld::TestSphereAgainstSectorList(CPtrList &list, CVector spherePos, float rad
 					CColModel *eCol = CModelInfo::GetColModel(e->GetModelIndex());
 					int collidedSpheres =
 					    CCollision::ProcessColModels(sphereMat, OurColModel, e->GetMatrix(), *eCol,
-					                                 gaTempSphereColPoints, nil, nil);
+					                                 &query.sphereColPoint, nil, nil);
 
 					if(collidedSpheres != 0 ||
 					   (e->IsVehicle() && ((CVehicle *)e)->m_vehType == VEHICLE_TYPE_CAR && e->GetModelIndex() != MI_DODO &&
@@ -978,6 +1581,12 @@ CWorld::FindGroundZForCoord(float x, float y)
 {
 	CColPoint point;
 	CEntity *ent;
+#ifdef GROUND_HEIGHT_CACHE
+	float z;
+	bool found;
+	if(CGroundCache::FindZ(x, y, 1000.0f, true, false, z, found))
+		return found ? z : 20.0f;
+#endif
 	if(ProcessVerticalLine(CVector(x, y, 1000.0f), -1000.0f, point, ent, true, false, false, false, true, false,
 	                       nil))
 		return point.point.z;
@@ -990,6 +1599,14 @@ CWorld::FindGroundZFor3DCoord(float x, float y, float z, bool *found)
 {
 	CColPoint point;
 	CEntity *ent;
+#ifdef GROUND_HEIGHT_CACHE
+	float groundZ;
+	bool bFound;
+	if(CGroundCache::FindZ(x, y, z, false, false, groundZ, bFound)) {
+		if(found) *found = bFound;
+		return bFound ? groundZ : 0.0f;
+	}
+#endif
 	if(ProcessVerticalLine(CVector(x, y, z), -1000.0f, point, ent, true, false, false, false, false, false, nil)) {
 		if(found) *found = true;
 		return point.point.z;
@@ -1004,6 +1621,14 @@ CWorld::FindRoofZFor3DCoord(float x, float y, float z, bool *found)
 {
 	CColPoint point;
 	CEntity *ent;
+#ifdef GROUND_HEIGHT_CACHE
+	float roofZ;
+	bool bFound;
+	if(CGroundCache::FindZ(x, y, z, true, true, roofZ, bFound) && bFound) {
+		if(found) *found = true;
+		return roofZ;
+	}
+#endif
 	if(ProcessVerticalLine(CVector(x, y, z), 1000.0f, point, ent, true, false, false, false, true, false, nil)) {
 		if(found) *found = true;
 		return point.point.z;
@@ -1060,42 +1685,42 @@ CWorld::FindObjectsKindaColliding(const CVector &position, float radius, bool bC
 			CSector *pSector = GetSector(x, y);
 			if(bBuildings) {
 				FindObjectsKindaCollidingSectorList(
-				    pSector->m_lists[ENTITYLIST_BUILDINGS], position, radius, bCheck2DOnly,
+				    pSector->m_arrays[ENTITYLIST_BUILDINGS], position, radius, bCheck2DOnly,
 				    nCollidingEntities, maxEntitiesToFind, aEntities);
 				FindObjectsKindaCollidingSectorList(
-				    pSector->m_lists[ENTITYLIST_BUILDINGS_OVERLAP], position, radius, bCheck2DOnly,
+				    pSector->m_arrays[ENTITYLIST_BUILDINGS_OVERLAP], position, radius, bCheck2DOnly,
 				    nCollidingEntities, maxEntitiesToFind, aEntities);
 			}
 			if(bVehicles) {
 				FindObjectsKindaCollidingSectorList(
-				    pSector->m_lists[ENTITYLIST_VEHICLES], position, radius, bCheck2DOnly,
+				    pSector->m_arrays[ENTITYLIST_VEHICLES], position, radius, bCheck2DOnly,
 				    nCollidingEntities, maxEntitiesToFind, aEntities);
 				FindObjectsKindaCollidingSectorList(
-				    pSector->m_lists[ENTITYLIST_VEHICLES_OVERLAP], position, radius, bCheck2DOnly,
+				    pSector->m_arrays[ENTITYLIST_VEHICLES_OVERLAP], position, radius, bCheck2DOnly,
 				    nCollidingEntities, maxEntitiesToFind, aEntities);
 			}
 			if(bPeds) {
-				FindObjectsKindaCollidingSectorList(pSector->m_lists[ENTITYLIST_PEDS], position,
+				FindObjectsKindaCollidingSectorList(pSector->m_arrays[ENTITYLIST_PEDS], position,
 				                                            radius, bCheck2DOnly, nCollidingEntities,
 				                                            maxEntitiesToFind, aEntities);
 				FindObjectsKindaCollidingSectorList(
-				    pSector->m_lists[ENTITYLIST_PEDS_OVERLAP], position, radius, bCheck2DOnly,
+				    pSector->m_arrays[ENTITYLIST_PEDS_OVERLAP], position, radius, bCheck2DOnly,
 				    nCollidingEntities, maxEntitiesToFind, aEntities);
 			}
 			if(bObjects) {
 				FindObjectsKindaCollidingSectorList(
-				    pSector->m_lists[ENTITYLIST_OBJECTS], position, radius, bCheck2DOnly,
+				    pSector->m_arrays[ENTITYLIST_OBJECTS], position, radius, bCheck2DOnly,
 				    nCollidingEntities, maxEntitiesToFind, aEntities);
 				FindObjectsKindaCollidingSectorList(
-				    pSector->m_lists[ENTITYLIST_OBJECTS_OVERLAP], position, radius, bCheck2DOnly,
+				    pSector->m_arrays[ENTITYLIST_OBJECTS_OVERLAP], position, radius, bCheck2DOnly,
 				    nCollidingEntities, maxEntitiesToFind, aEntities);
 			}
 			if(bDummies) {
 				FindObjectsKindaCollidingSectorList(
-				    pSector->m_lists[ENTITYLIST_DUMMIES], position, radius, bCheck2DOnly,
+				    pSector->m_arrays[ENTITYLIST_DUMMIES], position, radius, bCheck2DOnly,
 				    nCollidingEntities, maxEntitiesToFind, aEntities);
 				FindObjectsKindaCollidingSectorList(
-				    pSector->m_lists[ENTITYLIST_DUMMIES_OVERLAP], position, radius, bCheck2DOnly,
+				    pSector->m_arrays[ENTITYLIST_DUMMIES_OVERLAP], position, radius, bCheck2DOnly,
 				    nCollidingEntities, maxEntitiesToFind, aEntities);
 			}
 		}
@@ -1103,11 +1728,11 @@ CWorld::FindObjectsKindaColliding(const CVector &position, float radius, bool bC
 }
 
 void
-CWorld::FindObjectsKindaCollidingSectorList(CPtrList &list, const CVector &position, float radius, bool bCheck2DOnly,
+CWorld::FindObjectsKindaCollidingSectorList(CSectorEntityArray &list, const CVector &position, float radius, bool bCheck2DOnly,
                                             int16 *nCollidingEntities, int16 maxEntitiesToFind, CEntity **aEntities)
 {
-	for(CPtrNode *pNode = list.first; pNode; pNode = pNode->next) {
-		CEntity *pEntity = (CEntity *)pNode->item;
+	for(int32 i = 0; i < list.numEntries; i++) {
+		CEntity *pEntity = list.entities[i];
 		if(pEntity->m_scanCode != GetCurrentScanCode()) {
 			pEntity->m_scanCode = GetCurrentScanCode();
 			float fMagnitude = 0.0f;
@@ -1138,43 +1763,43 @@ CWorld::FindObjectsIntersectingCube(const CVector &vecStartPos, const CVector &v
 		for(int32 x = nStartX; x <= nEndX; x++) {
 			CSector *pSector = GetSector(x, y);
 			if(bBuildings) {
-				FindObjectsIntersectingCubeSectorList(pSector->m_lists[ENTITYLIST_BUILDINGS],
+				FindObjectsIntersectingCubeSectorList(pSector->m_arrays[ENTITYLIST_BUILDINGS],
 				                                              vecStartPos, vecEndPos, nIntersecting,
 				                                              maxEntitiesToFind, aEntities);
 				FindObjectsIntersectingCubeSectorList(
-				    pSector->m_lists[ENTITYLIST_BUILDINGS_OVERLAP], vecStartPos, vecEndPos,
+				    pSector->m_arrays[ENTITYLIST_BUILDINGS_OVERLAP], vecStartPos, vecEndPos,
 				    nIntersecting, maxEntitiesToFind, aEntities);
 			}
 			if(bVehicles) {
-				FindObjectsIntersectingCubeSectorList(pSector->m_lists[ENTITYLIST_VEHICLES],
+				FindObjectsIntersectingCubeSectorList(pSector->m_arrays[ENTITYLIST_VEHICLES],
 				                                              vecStartPos, vecEndPos, nIntersecting,
 				                                              maxEntitiesToFind, aEntities);
 				FindObjectsIntersectingCubeSectorList(
-				    pSector->m_lists[ENTITYLIST_VEHICLES_OVERLAP], vecStartPos, vecEndPos,
+				    pSector->m_arrays[ENTITYLIST_VEHICLES_OVERLAP], vecStartPos, vecEndPos,
 				    nIntersecting, maxEntitiesToFind, aEntities);
 			}
 			if(bPeds) {
-				FindObjectsIntersectingCubeSectorList(pSector->m_lists[ENTITYLIST_PEDS],
+				FindObjectsIntersectingCubeSectorList(pSector->m_arrays[ENTITYLIST_PEDS],
 				                                              vecStartPos, vecEndPos, nIntersecting,
 				                                              maxEntitiesToFind, aEntities);
-				FindObjectsIntersectingCubeSectorList(pSector->m_lists[ENTITYLIST_PEDS_OVERLAP],
+				FindObjectsIntersectingCubeSectorList(pSector->m_arrays[ENTITYLIST_PEDS_OVERLAP],
 				                                              vecStartPos, vecEndPos, nIntersecting,
 				                                              maxEntitiesToFind, aEntities);
 			}
 			if(bObjects) {
-				FindObjectsIntersectingCubeSectorList(pSector->m_lists[ENTITYLIST_OBJECTS],
+				FindObjectsIntersectingCubeSectorList(pSector->m_arrays[ENTITYLIST_OBJECTS],
 				                                              vecStartPos, vecEndPos, nIntersecting,
 				                                              maxEntitiesToFind, aEntities);
 				FindObjectsIntersectingCubeSectorList(
-				    pSector->m_lists[ENTITYLIST_OBJECTS_OVERLAP], vecStartPos, vecEndPos, nIntersecting,
+				    pSector->m_arrays[ENTITYLIST_OBJECTS_OVERLAP], vecStartPos, vecEndPos, nIntersecting,
 				    maxEntitiesToFind, aEntities);
 			}
 			if(bDummies) {
-				FindObjectsIntersectingCubeSectorList(pSector->m_lists[ENTITYLIST_DUMMIES],
+				FindObjectsIntersectingCubeSectorList(pSector->m_arrays[ENTITYLIST_DUMMIES],
 				                                              vecStartPos, vecEndPos, nIntersecting,
 				                                              maxEntitiesToFind, aEntities);
 				FindObjectsIntersectingCubeSectorList(
-				    pSector->m_lists[ENTITYLIST_DUMMIES_OVERLAP], vecStartPos, vecEndPos, nIntersecting,
+				    pSector->m_arrays[ENTITYLIST_DUMMIES_OVERLAP], vecStartPos, vecEndPos, nIntersecting,
 				    maxEntitiesToFind, aEntities);
 			}
 		}
@@ -1182,11 +1807,11 @@ CWorld::FindObjectsIntersectingCube(const CVector &vecStartPos, const CVector &v
 }
 
 void
-CWorld::FindObjectsIntersectingCubeSectorList(CPtrList &list, const CVector &vecStartPos, const CVector &vecEndPos,
+CWorld::FindObjectsIntersectingCubeSectorList(CSectorEntityArray &list, const CVector &vecStartPos, const CVector &vecEndPos,
                                               int16 *nIntersecting, int16 maxEntitiesToFind, CEntity **aEntities)
 {
-	for(CPtrNode *pNode = list.first; pNode; pNode = pNode->next) {
-		CEntity *pEntity = (CEntity *)pNode->item;
+	for(int32 i = 0; i < list.numEntries; i++) {
+		CEntity *pEntity = list.entities[i];
 		if(pEntity->m_scanCode != GetCurrentScanCode()) {
 			pEntity->m_scanCode = GetCurrentScanCode();
 			float fRadius = pEntity->GetBoundRadius();
@@ -1220,42 +1845,42 @@ CWorld::FindObjectsIntersectingAngledCollisionBox(const CColBox &boundingBox, co
 			CSector *pSector = GetSector(x, y);
 			if(bBuildings) {
 				FindObjectsIntersectingAngledCollisionBoxSectorList(
-				    pSector->m_lists[ENTITYLIST_BUILDINGS], boundingBox, matrix, position,
+				    pSector->m_arrays[ENTITYLIST_BUILDINGS], boundingBox, matrix, position,
 				    nEntitiesFound, maxEntitiesToFind, aEntities);
 				FindObjectsIntersectingAngledCollisionBoxSectorList(
-				    pSector->m_lists[ENTITYLIST_BUILDINGS_OVERLAP], boundingBox, matrix, position,
+				    pSector->m_arrays[ENTITYLIST_BUILDINGS_OVERLAP], boundingBox, matrix, position,
 				    nEntitiesFound, maxEntitiesToFind, aEntities);
 			}
 			if(bVehicles) {
 				FindObjectsIntersectingAngledCollisionBoxSectorList(
-				    pSector->m_lists[ENTITYLIST_VEHICLES], boundingBox, matrix, position,
+				    pSector->m_arrays[ENTITYLIST_VEHICLES], boundingBox, matrix, position,
 				    nEntitiesFound, maxEntitiesToFind, aEntities);
 				FindObjectsIntersectingAngledCollisionBoxSectorList(
-				    pSector->m_lists[ENTITYLIST_VEHICLES_OVERLAP], boundingBox, matrix, position,
+				    pSector->m_arrays[ENTITYLIST_VEHICLES_OVERLAP], boundingBox, matrix, position,
 				    nEntitiesFound, maxEntitiesToFind, aEntities);
 			}
 			if(bPeds) {
 				FindObjectsIntersectingAngledCollisionBoxSectorList(
-				    pSector->m_lists[ENTITYLIST_PEDS], boundingBox, matrix, position, nEntitiesFound,
+				    pSector->m_arrays[ENTITYLIST_PEDS], boundingBox, matrix, position, nEntitiesFound,
 				    maxEntitiesToFind, aEntities);
 				FindObjectsIntersectingAngledCollisionBoxSectorList(
-				    pSector->m_lists[ENTITYLIST_PEDS_OVERLAP], boundingBox, matrix, position,
+				    pSector->m_arrays[ENTITYLIST_PEDS_OVERLAP], boundingBox, matrix, position,
 				    nEntitiesFound, maxEntitiesToFind, aEntities);
 			}
 			if(bObjects) {
 				FindObjectsIntersectingAngledCollisionBoxSectorList(
-				    pSector->m_lists[ENTITYLIST_OBJECTS], boundingBox, matrix, position, nEntitiesFound,
+				    pSector->m_arrays[ENTITYLIST_OBJECTS], boundingBox, matrix, position, nEntitiesFound,
 				    maxEntitiesToFind, aEntities);
 				FindObjectsIntersectingAngledCollisionBoxSectorList(
-				    pSector->m_lists[ENTITYLIST_OBJECTS_OVERLAP], boundingBox, matrix, position,
+				    pSector->m_arrays[ENTITYLIST_OBJECTS_OVERLAP], boundingBox, matrix, position,
 				    nEntitiesFound, maxEntitiesToFind, aEntities);
 			}
 			if(bDummies) {
 				FindObjectsIntersectingAngledCollisionBoxSectorList(
-				    pSector->m_lists[ENTITYLIST_DUMMIES], boundingBox, matrix, position, nEntitiesFound,
+				    pSector->m_arrays[ENTITYLIST_DUMMIES], boundingBox, matrix, position, nEntitiesFound,
 				    maxEntitiesToFind, aEntities);
 				FindObjectsIntersectingAngledCollisionBoxSectorList(
-				    pSector->m_lists[ENTITYLIST_DUMMIES_OVERLAP], boundingBox, matrix, position,
+				    pSector->m_arrays[ENTITYLIST_DUMMIES_OVERLAP], boundingBox, matrix, position,
 				    nEntitiesFound, maxEntitiesToFind, aEntities);
 			}
 		}
@@ -1263,13 +1888,13 @@ CWorld::FindObjectsIntersectingAngledCollisionBox(const CColBox &boundingBox, co
 }
 
 void
-CWorld::FindObjectsIntersectingAngledCollisionBoxSectorList(CPtrList &list, const CColBox &boundingBox,
+CWorld::FindObjectsIntersectingAngledCollisionBoxSectorList(CSectorEntityArray &list, const CColBox &boundingBox,
                                                             const CMatrix &matrix, const CVector &position,
                                                             int16 *nEntitiesFound, int16 maxEntitiesToFind,
                                                             CEntity **aEntities)
 {
-	for(CPtrNode *pNode = list.first; pNode; pNode = pNode->next) {
-		CEntity *pEntity = (CEntity *)pNode->item;
+	for(int32 i = 0; i < list.numEntries; i++) {
+		CEntity *pEntity = list.entities[i];
 		if(pEntity->m_scanCode != GetCurrentScanCode()) {
 			pEntity->m_scanCode = GetCurrentScanCode();
 			CColSphere sphere;
@@ -1300,26 +1925,26 @@ CWorld::FindMissionEntitiesIntersectingCube(const CVector &vecStartPos, const CV
 			CSector *pSector = GetSector(x, y);
 			if(bVehicles) {
 				FindMissionEntitiesIntersectingCubeSectorList(
-				    pSector->m_lists[ENTITYLIST_VEHICLES], vecStartPos, vecEndPos, nIntersecting,
+				    pSector->m_arrays[ENTITYLIST_VEHICLES], vecStartPos, vecEndPos, nIntersecting,
 				    maxEntitiesToFind, aEntities, true, false);
 				FindMissionEntitiesIntersectingCubeSectorList(
-				    pSector->m_lists[ENTITYLIST_VEHICLES_OVERLAP], vecStartPos, vecEndPos,
+				    pSector->m_arrays[ENTITYLIST_VEHICLES_OVERLAP], vecStartPos, vecEndPos,
 				    nIntersecting, maxEntitiesToFind, aEntities, true, false);
 			}
 			if(bPeds) {
 				FindMissionEntitiesIntersectingCubeSectorList(
-				    pSector->m_lists[ENTITYLIST_PEDS], vecStartPos, vecEndPos, nIntersecting,
+				    pSector->m_arrays[ENTITYLIST_PEDS], vecStartPos, vecEndPos, nIntersecting,
 				    maxEntitiesToFind, aEntities, false, true);
 				FindMissionEntitiesIntersectingCubeSectorList(
-				    pSector->m_lists[ENTITYLIST_PEDS_OVERLAP], vecStartPos, vecEndPos, nIntersecting,
+				    pSector->m_arrays[ENTITYLIST_PEDS_OVERLAP], vecStartPos, vecEndPos, nIntersecting,
 				    maxEntitiesToFind, aEntities, false, true);
 			}
 			if(bObjects) {
 				FindMissionEntitiesIntersectingCubeSectorList(
-				    pSector->m_lists[ENTITYLIST_OBJECTS], vecStartPos, vecEndPos, nIntersecting,
+				    pSector->m_arrays[ENTITYLIST_OBJECTS], vecStartPos, vecEndPos, nIntersecting,
 				    maxEntitiesToFind, aEntities, false, false);
 				FindMissionEntitiesIntersectingCubeSectorList(
-				    pSector->m_lists[ENTITYLIST_OBJECTS_OVERLAP], vecStartPos, vecEndPos, nIntersecting,
+				    pSector->m_arrays[ENTITYLIST_OBJECTS_OVERLAP], vecStartPos, vecEndPos, nIntersecting,
 				    maxEntitiesToFind, aEntities, false, false);
 			}
 		}
@@ -1327,13 +1952,13 @@ CWorld::FindMissionEntitiesIntersectingCube(const CVector &vecStartPos, const CV
 }
 
 void
-CWorld::FindMissionEntitiesIntersectingCubeSectorList(CPtrList &list, const CVector &vecStartPos,
+CWorld::FindMissionEntitiesIntersectingCubeSectorList(CSectorEntityArray &list, const CVector &vecStartPos,
                                                       const CVector &vecEndPos, int16 *nIntersecting,
                                                       int16 maxEntitiesToFind, CEntity **aEntities, bool bIsVehicleList,
                                                       bool bIsPedList)
 {
-	for(CPtrNode *pNode = list.first; pNode; pNode = pNode->next) {
-		CEntity *pEntity = (CEntity *)pNode->item;
+	for(int32 i = 0; i < list.numEntries; i++) {
+		CEntity *pEntity = list.entities[i];
 		if(pEntity->m_scanCode != GetCurrentScanCode()) {
 			pEntity->m_scanCode = GetCurrentScanCode();
 			bool bIsMissionEntity = false;
@@ -1662,6 +2287,9 @@ CWorld::ShutDown(void)
 		}
 		ms_bigBuildingsList[i].Flush();
 	}
+#ifdef GROUND_HEIGHT_CACHE
+	CGroundCache::Flush();
+#endif
 	for(int i = 0; i < NUMSECTORS_X * NUMSECTORS_Y; i++) {
 		CSector *pSector = GetSector(i % NUMSECTORS_X, i / NUMSECTORS_Y);
 #ifdef FIX_BUGS
@@ -1698,6 +2326,8 @@ CWorld::ShutDown(void)
 			sprintf(gString, "Dummy overlap list %d,%d not empty\n", i % NUMSECTORS_X, i / NUMSECTORS_Y);
 			pSector->m_lists[ENTITYLIST_DUMMIES_OVERLAP].Flush();
 		}
+		for(int32 j = 0; j < NUMSECTORENTITYLISTS; j++)
+			pSector->m_arrays[j].Shutdown();
 	}
 	ms_listMovingEntityPtrs.Flush();
 #if GTA_VERSION <= GTA3_PS2_160
@@ -1834,8 +2464,40 @@ CWorld::RemoveStaticObjects()
 		pSector->m_lists[ENTITYLIST_BUILDINGS_OVERLAP].Flush();
 		pSector->m_lists[ENTITYLIST_DUMMIES].Flush();
 		pSector->m_lists[ENTITYLIST_DUMMIES_OVERLAP].Flush();
+		pSector->m_arrays[ENTITYLIST_BUILDINGS].Clear();
+		pSector->m_arrays[ENTITYLIST_BUILDINGS_OVERLAP].Clear();
+		pSector->m_arrays[ENTITYLIST_DUMMIES].Clear();
+		pSector->m_arrays[ENTITYLIST_DUMMIES_OVERLAP].Clear();
 	}
+#ifdef GROUND_HEIGHT_CACHE
+	CGroundCache::Flush();
+#endif
+}
+
+#ifdef PED_ANIM_LOD
+bool gbPedAnimLod = true;	// not original
+
+// Whether the bones of a moving entity are posed this frame. Peds past
+// ms_pedLod0Dist are posed every second frame, past ms_pedLod1Dist every
+// fourth and offscreen ones not at all. Their animations still advance
+// every frame, so a pose is always sampled at the right time.
+static bool
+IsAnimPoseNeeded(CEntity *ent)
+{
+	if(!gbPedAnimLod || !ent->IsPed() || ent == FindPlayerPed())
+		return true;
+	if(!ent->GetIsOnScreen())
+		return false;
+	float distSqr = (ent->GetPosition() - TheCamera.GetPosition()).MagnitudeSqr();
+	if(distSqr < CVisibilityPlugins::ms_pedLod0Dist)
+		return true;
+	// spread them over the frames
+	uint32 frame = CTimer::GetFrameCounter() + CPools::GetPedPool()->GetJustIndex((CPed*)ent);
+	if(distSqr < CVisibilityPlugins::ms_pedLod1Dist)
+		return (frame & 1) == 0;
+	return (frame & 3) == 0;
 }
+#endif
 
 void
 CWorld::Process(void)
@@ -1873,7 +2535,12 @@ CWorld::Process(void)
 				RpAnimBlendClumpUpdateAnimations(movingEnt->GetClump(),
 				                                 movingEnt->IsObject()
 				                                              ? CTimer::GetTimeStepNonClippedInSeconds()
+#ifdef PED_ANIM_LOD
+				                                              : CTimer::GetTimeStepInSeconds(),
+				                                 IsAnimPoseNeeded(movingEnt));
+#else
 				                                              : CTimer::GetTimeStepInSeconds());
+#endif
 			}
 		}
 		for(CPtrNode *node = ms_listMovingEntityPtrs.first; node; node = node->next) {
@@ -25,6 +25,8 @@
 
 #define MAP_Z_LOW_LIMIT -100.0f
 
+#define NEARESTOBJECTS_MAX (64)	// not original, FindNearestObjects without distancesSqr
+
 enum
 {
 	ENTITYLIST_BUILDINGS,
@@ -45,9 +47,94 @@ class CSector
 {
 public:
 	CPtrList m_lists[NUMSECTORENTITYLISTS];
+	CSectorEntityArray m_arrays[NUMSECTORENTITYLISTS];	// not original, packed copy of m_lists
+
+	CSectorEntityArray &GetArray(CPtrList *list) { return m_arrays[list - m_lists]; }
+};
+
+// The packed arrays can't be switched off, so check that the original lists
+// still come first and have their original size instead of checking sizeof.
+#ifdef CHECK_STRUCT_SIZES
+VALIDATE_OFFSET(CSector, m_arrays, 0x28);
+#endif
+
+// Not original. Caller owned state of a world query.
+// Entities seen by the running query are remembered in a small hash set
+// instead of being stamped with CWorld's scan code, so the query doesn't write
+// to the world and several can run at once from different threads, one
+// CWorldQuery each. The world must not change while they run, and since
+// ped hit models are animated in place, ped checks belong on the main thread.
+class CWorldQuery
+{
+	CEntity **m_visited;
+	uint16 *m_visitedEpoch;	// slot is in use if it matches m_epoch
+	int32 m_size;		// power of two
+	int32 m_numVisited;
+	uint16 m_epoch;
+
+	void Grow(void);
+public:
+	// these replace CWorld::pIgnoreEntity and CWorld::bIncludeDeadPeds
+	CEntity *pIgnoreEntity;
+	bool bIncludeDeadPeds;
+	// what gaTempSphereColPoints[0] is for TestSphereAgainstWorld
+	CColPoint sphereColPoint;
+
+	CWorldQuery(void);
+	~CWorldQuery(void);
+	void Begin(void);
+	// returns false if the entity was already seen by this query
+	bool Visit(CEntity *e) {
+		if(m_numVisited*2 >= m_size)
+			Grow();
+		uint32 mask = m_size-1;
+		uint32 i = ((uint32)((uintptr)e >> 4) * 2654435761u) & mask;
+		while(m_visitedEpoch[i] == m_epoch){
+			if(m_visited[i] == e)
+				return false;
+			i = (i+1) & mask;
+		}
+		m_visited[i] = e;
+		m_visitedEpoch[i] = m_epoch;
+		m_numVisited++;
+		return true;
+	}
 };
 
-VALIDATE_SIZE(CSector, 0x28);
+// Not original. Flags of a CWorldLosRay, the entity ones also select
+// the lists FindNearestObjects looks at.
+enum
+{
+	LOS_BUILDINGS = 1,
+	LOS_VEHICLES = 2,
+	LOS_PEDS = 4,
+	LOS_OBJECTS = 8,
+	LOS_DUMMIES = 0x10,
+	LOS_IGNORESEETHROUGH = 0x20,
+	LOS_IGNORESOMEOBJECTS = 0x40,
+
+	LOS_ALLENTITIES = LOS_BUILDINGS | LOS_VEHICLES | LOS_PEDS | LOS_OBJECTS | LOS_DUMMIES
+};
+
+// Not original. One segment of ProcessLineOfSightBatch or GetIsLineOfSightClearBatch,
+// the flags select what ProcessLineOfSight's bools would.
+struct CWorldLosRay
+{
+	CVector point1;
+	CVector point2;
+	uint32 flags;
+
+	// results
+	bool hit;		// for GetIsLineOfSightClearBatch: line is not clear
+	CEntity *entity;
+	CColPoint point;	// ProcessLineOfSightBatch only
+	float dist;		// ProcessLineOfSightBatch only, fraction of the segment to the hit
+
+	void Set(const CVector &p1, const CVector &p2, uint32 f) { point1 = p1; point2 = p2; flags = f; }
+};
+
+// Not original. Predicate for the filtered world queries, false rejects the entity.
+typedef bool (*WorldQueryFilter)(CEntity *entity, void *data);
 
 class CWorld
 {
@@ -55,6 +142,7 @@ class CWorld
 	static CPtrList ms_listMovingEntityPtrs;
 	static CSector ms_aSectors[NUMSECTORS_Y][NUMSECTORS_X];
 	static uint16 ms_nCurrentScanCode;
+	static CWorldQuery ms_mainQuery;	// used by the query functions that don't take a context
 
 public:
 	static uint8 PlayerInFocus;
@@ -82,38 +170,55 @@ public:
 		}
 	}
 	static void ClearScanCodes(void);
+	static void RebuildSectorArrays(void);
 	static void ClearExcitingStuffFromArea(const CVector &pos, float radius, bool bRemoveProjectilesAndTidyUpShadows);
 
 	static bool CameraToIgnoreThisObject(CEntity *ent);
 
 	static bool ProcessLineOfSight(const CVector &point1, const CVector &point2, CColPoint &point, CEntity *&entity, bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies, bool ignoreSeeThrough, bool ignoreSomeObjects = false);
-	static bool ProcessLineOfSightSector(CSector &sector, const CColLine &line, CColPoint &point, float &dist, CEntity *&entity, bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies, bool ignoreSeeThrough, bool ignoreSomeObjects = false);
-	static bool ProcessLineOfSightSectorList(CPtrList &list, const CColLine &line, CColPoint &point, float &dist, CEntity *&entity, bool ignoreSeeThrough, bool ignoreSomeObjects = false);
+	static bool ProcessLineOfSight(CWorldQuery &query, const CVector &point1, const CVector &point2, CColPoint &point, CEntity *&entity, bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies, bool ignoreSeeThrough, bool ignoreSomeObjects = false);
+	static bool ProcessLineOfSightSector(CWorldQuery &query, CSector &sector, const CColLine &line, CColPoint &point, float &dist, CEntity *&entity, bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies, bool ignoreSeeThrough, bool ignoreSomeObjects = false);
+	static bool ProcessLineOfSightSectorList(CWorldQuery &query, CSectorEntityArray &list, const CColLine &line, CColPoint &point, float &dist, CEntity *&entity, bool ignoreSeeThrough, bool ignoreSomeObjects = false);
 	static bool ProcessVerticalLine(const CVector &point1, float z2, CColPoint &point, CEntity *&entity, bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies, bool ignoreSeeThrough, CStoredCollPoly *poly);
-	static bool ProcessVerticalLineSector(CSector &sector, const CColLine &line, CColPoint &point, CEntity *&entity, bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies, bool ignoreSeeThrough, CStoredCollPoly *poly);
-	static bool ProcessVerticalLineSectorList(CPtrList &list, const CColLine &line, CColPoint &point, float &dist, CEntity *&entity, bool ignoreSeeThrough, CStoredCollPoly *poly);
+	static bool ProcessVerticalLine(CWorldQuery &query, const CVector &point1, float z2, CColPoint &point, CEntity *&entity, bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies, bool ignoreSeeThrough, CStoredCollPoly *poly);
+	static bool ProcessVerticalLineSector(CWorldQuery &query, CSector &sector, const CColLine &line, CColPoint &point, CEntity *&entity, bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies, bool ignoreSeeThrough, CStoredCollPoly *poly);
+	static bool ProcessVerticalLineSectorList(CWorldQuery &query, CSectorEntityArray &list, const CColLine &line, CColPoint &point, float &dist, CEntity *&entity, bool ignoreSeeThrough, CStoredCollPoly *poly);
 	static bool GetIsLineOfSightClear(const CVector &point1, const CVector &point2, bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies, bool ignoreSeeThrough, bool ignoreSomeObjects = false);
-	static bool GetIsLineOfSightSectorClear(CSector &sector, const CColLine &line, bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies, bool ignoreSeeThrough, bool ignoreSomeObjects = false);
-	static bool GetIsLineOfSightSectorListClear(CPtrList &list, const CColLine &line, bool ignoreSeeThrough, bool ignoreSomeObjects = false);
+	static bool GetIsLineOfSightClear(CWorldQuery &query, const CVector &point1, const CVector &point2, bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies, bool ignoreSeeThrough, bool ignoreSomeObjects = false);
+	static bool GetIsLineOfSightSectorClear(CWorldQuery &query, CSector &sector, const CColLine &line, bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies, bool ignoreSeeThrough, bool ignoreSomeObjects = false);
+	static bool GetIsLineOfSightSectorListClear(CWorldQuery &query, CSectorEntityArray &list, const CColLine &line, bool ignoreSeeThrough, bool ignoreSomeObjects = false);
 	
+	static int32 ProcessLineOfSightBatch(CWorldLosRay *rays, int32 numRays);
+	static int32 ProcessLineOfSightBatch(CWorldQuery &query, CWorldLosRay *rays, int32 numRays);
+	static int32 GetIsLineOfSightClearBatch(CWorldLosRay *rays, int32 numRays);
+	static int32 GetIsLineOfSightClearBatch(CWorldQuery &query, CWorldLosRay *rays, int32 numRays);
+
 	static CEntity *TestSphereAgainstWorld(CVector centre, float radius, CEntity *entityToIgnore, bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies, bool ignoreSomeObjects);
-	static CEntity *TestSphereAgainstSectorList(CPtrList&, CVector, float, CEntity*, bool);
-	static void FindObjectsInRangeSectorList(CPtrList &list, Const CVector &centre, float radius, bool ignoreZ, int16 *numObjects, int16 lastObject, CEntity **objects);
+	static CEntity *TestSphereAgainstWorld(CWorldQuery &query, CVector centre, float radius, CEntity *entityToIgnore, bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies, bool ignoreSomeObjects);
+	static CEntity *TestSphereAgainstSectorList(CWorldQuery &query, CSectorEntityArray&, CVector, float, CEntity*, bool);
+	static void FindObjectsInRangeSectorList(CWorldQuery &query, CSectorEntityArray &list, Const CVector &centre, float radius, bool ignoreZ, int16 *numObjects, int16 lastObject, CEntity **objects, WorldQueryFilter filter = nil, void *filterData = nil);
 	static void FindObjectsInRange(Const CVector &centre, float radius, bool ignoreZ, int16 *numObjects, int16 lastObject, CEntity **objects, bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies);
+	static void FindObjectsInRange(CWorldQuery &query, Const CVector &centre, float radius, bool ignoreZ, int16 *numObjects, int16 lastObject, CEntity **objects, bool checkBuildings, bool checkVehicles, bool checkPeds, bool checkObjects, bool checkDummies, WorldQueryFilter filter = nil, void *filterData = nil);
+	// not original, closest first. distancesSqr may be nil if maxObjects <= NEARESTOBJECTS_MAX
+	static int32 FindNearestObjects(Const CVector &centre, float radius, bool ignoreZ, int32 maxObjects, CEntity **objects, float *distancesSqr, uint32 flags, WorldQueryFilter filter = nil, void *filterData = nil);
+	static int32 FindNearestObjects(CWorldQuery &query, Const CVector &centre, float radius, bool ignoreZ, int32 maxObjects, CEntity **objects, float *distancesSqr, uint32 flags, WorldQueryFilter filter = nil, void *filterData = nil);
+	static void FindNearestObjectsSectorList(CWorldQuery &query, CSectorEntityArray &list, Const CVector &centre, bool ignoreZ, int32 maxObjects, int32 *numObjects, CEntity **objects, float *distancesSqr, float *maxDistSqr, WorldQueryFilter filter, void *filterData);
+	static CEntity *FindNearestObject(Const CVector &centre, float radius, bool ignoreZ, uint32 flags, WorldQueryFilter filter = nil, void *filterData = nil);
 	static void FindObjectsOfTypeInRangeSectorList(uint32 modelId, CPtrList& list, const CVector& position, float radius, bool bCheck2DOnly, int16* nEntitiesFound, int16 maxEntitiesToFind, CEntity** aEntities);
+	static void FindObjectsOfTypeInRangeSectorList(uint32 modelId, CSectorEntityArray &list, const CVector& position, float radius, bool bCheck2DOnly, int16* nEntitiesFound, int16 maxEntitiesToFind, CEntity** aEntities);
 	static void FindObjectsOfTypeInRange(uint32 modelId, const CVector& position, float radius, bool bCheck2DOnly, int16* nEntitiesFound, int16 maxEntitiesToFind, CEntity** aEntities, bool bBuildings, bool bVehicles, bool bPeds, bool bObjects, bool bDummies);
 	static float FindGroundZForCoord(float x, float y);
 	static float FindGroundZFor3DCoord(float x, float y, float z, bool *found);
 	static float FindRoofZFor3DCoord(float x, float y, float z, bool *found);
 	static void RemoveReferencesToDeletedObject(CEntity*);
 	static void FindObjectsKindaColliding(const CVector& position, float radius, bool bCheck2DOnly, int16* nCollidingEntities, int16 maxEntitiesToFind, CEntity** aEntities, bool bBuildings, bool bVehicles, bool bPeds, bool bObjects, bool bDummies);
-	static void FindObjectsKindaCollidingSectorList(CPtrList& list, const CVector& position, float radius, bool bCheck2DOnly, int16* nCollidingEntities, int16 maxEntitiesToFind, CEntity** aEntities);
+	static void FindObjectsKindaCollidingSectorList(CSectorEntityArray &list, const CVector& position, float radius, bool bCheck2DOnly, int16* nCollidingEntities, int16 maxEntitiesToFind, CEntity** aEntities);
 	static void FindObjectsIntersectingCube(const CVector& vecStartPos, const CVector& vecEndPos, int16* nIntersecting, int16 maxEntitiesToFind, CEntity** aEntities, bool bBuildings, bool bVehicles, bool bPeds, bool bObjects, bool bDummies);
-	static void FindObjectsIntersectingCubeSectorList(CPtrList& list, const CVector& vecStartPos, const CVector& vecEndPos, int16* nIntersecting, int16 maxEntitiesToFind, CEntity** aEntities);
+	static void FindObjectsIntersectingCubeSectorList(CSectorEntityArray &list, const CVector& vecStartPos, const CVector& vecEndPos, int16* nIntersecting, int16 maxEntitiesToFind, CEntity** aEntities);
 	static void FindObjectsIntersectingAngledCollisionBox(const CColBox &, const CMatrix &, const CVector &, float, float, float, float, int16*, int16, CEntity **, bool, bool, bool, bool, bool);
-	static void FindObjectsIntersectingAngledCollisionBoxSectorList(CPtrList& list, const CColBox& boundingBox, const CMatrix& matrix, const CVector& position, int16* nEntitiesFound, int16 maxEntitiesToFind, CEntity** aEntities);
+	static void FindObjectsIntersectingAngledCollisionBoxSectorList(CSectorEntityArray &list, const CColBox& boundingBox, const CMatrix& matrix, const CVector& position, int16* nEntitiesFound, int16 maxEntitiesToFind, CEntity** aEntities);
 	static void FindMissionEntitiesIntersectingCube(const CVector& vecStartPos, const CVector& vecEndPos, int16* nIntersecting, int16 maxEntitiesToFind, CEntity** aEntities, bool bVehicles, bool bPeds, bool bObjects);
-	static void FindMissionEntitiesIntersectingCubeSectorList(CPtrList& list, const CVector& vecStartPos, const CVector& vecEndPos, int16* nIntersecting, int16 maxEntitiesToFind, CEntity** aEntities, bool bIsVehicleList, bool bIsPedList);
+	static void FindMissionEntitiesIntersectingCubeSectorList(CSectorEntityArray &list, const CVector& vecStartPos, const CVector& vecEndPos, int16* nIntersecting, int16 maxEntitiesToFind, CEntity** aEntities, bool bIsVehicleList, bool bIsPedList);
 
 	static void ClearCarsFromArea(float x1, float y1, float z1, float x2, float y2, float z2);
 	static void ClearPedsFromArea(float x1, float y1, float z1, float x2, float y2, float z2);
@@ -152,4 +257,7 @@ public:
 };
 
 extern CColPoint gaTempSphereColPoints[MAX_COLLISION_POINTS];
+#ifdef PED_ANIM_LOD
+extern bool gbPedAnimLod;	// not original
+#endif
 
@@ -81,8 +81,16 @@ enum Config {
 
 	NUMEXTRADIRECTIONALS = 4,
 	NUMANTENNAS = 8,
+#ifdef VANILLA_DEFINES
 	NUMCORONAS = 56,
+#else
+	NUMCORONAS = 128,	// affordable with BATCHED_CORONA_LOS
+#endif
+#ifdef VANILLA_DEFINES
 	NUMPOINTLIGHTS = 32,
+#else
+	NUMPOINTLIGHTS = 128,	// affordable with CLUSTERED_POINTLIGHTS
+#endif
 	NUM3DMARKERS = 32,
 	NUMBRIGHTLIGHTS = 32,
 	NUMSHINYTEXTS = 32,
@@ -285,6 +293,10 @@ enum Config {
 #undef ASCII_STRCMP
 #endif
 
+#define MULTITHREADED_WORLD_QUERIES // CWorld queries taking a CWorldQuery may run on worker threads. requires C++11 or later
+#define GROUND_HEIGHT_CACHE // cache the surfaces FindGroundZForCoord and friends find
+#define WORKER_THREADS // pool of threads for parallel jobs, see WorkerThreads.h. requires C++11 or later
+
 // Just debug menu entries
 #ifdef DEBUGMENU
 #define MISSION_SWITCHER // from debug menu
@@ -316,13 +328,28 @@ enum Config {
 #endif
 
 #define FIX_SPRITES	// fix sprites aspect ratio(moon, coronas, particle etc)
+#define MULTITHREADED_RENDERLIST	// split the sector scan of CRenderer::ScanWorld across WORKER_THREADS
+#define OCCLUSION_CULLING	// don't draw entities hidden behind big buildings, see Occlusion.h
+#define CLUSTERED_POINTLIGHTS	// objects only look at the point lights in their cell of a grid around the camera
+#define BATCHED_CORONA_LOS	// corona line of sight checks are cached, spread over frames and batched
+#define STATIC_SHADOW_CACHE	// keep static shadows that don't fall on anything instead of casting them again every frame, more poly bunches
+#define GROWABLE_RENDERBUFFER	// RenderBuffer grows instead of flushing when it's full, with upload stats
+#define BATCHED_TEXT	// line layouts of strings are cached, fonts are drawn in bigger sprite banks
+#define STATIC_WATER_GEOMETRY	// flat water tables and index list are built once, visible flat quads are drawn in one batch
+#define BUILDING_IMPOSTORS	// far big buildings are drawn as billboards baked from their LOD model, see Impostors.h
 
 #ifndef EXTENDED_COLOURFILTER
 #undef SCREEN_DROPLETS		// we need the backbuffer for this effect
 #endif
 
+#ifndef WORKER_THREADS
+#undef MULTITHREADED_RENDERLIST
+#endif
+
 // Particle
 //#define PC_PARTICLE
+#define BATCHED_PARTICLE_COLLISION // find the ground under ZCHECK_STEP particles with one batched world query per system
+#define BATCHED_PARTICLE_RENDER // draw the particles of a system grouped by raster, bigger sprite buffer
 //#define PS2_ALTERNATIVE_CARSPLASH // unused on PS2
 
 // Pad
@@ -416,6 +443,10 @@ enum Config {
 // Peds
 #define PED_SKIN		// support for skinned geometry on peds, requires COMPATIBLE_SAVES
 #define ANIMATE_PED_COL_MODEL
+#define SIMD_ANIM_BLEND	// all bones of a clump are sampled first and then slerped and blended four at a time with SSE/NEON
+#define PED_ANIM_LOD	// far away peds are posed at half or quarter rate, offscreen ones only advance their animations
+#define SHARED_POSE_CACHE	// far away peds playing the same animation at about the same time share one evaluated pose, requires SIMD_ANIM_BLEND
+#define FAST_KEYFRAME_SEARCH	// key frames are found by binary search, or directly on evenly sampled sequences, instead of walking through all of them
 // #define VC_PED_PORTS			// various ports from VC's CPed, mostly subtle
 // #define NEW_WALK_AROUND_ALGORITHM	// to make walking around vehicles/objects less awkward
 #define CANCELLABLE_CAR_ENTER
@@ -441,6 +472,10 @@ enum Config {
 #define USE_TIME_SCALE_FOR_AUDIO // slow down/speed up sounds according to the speed of the game
 #define MULTITHREADED_AUDIO // for streams. requires C++11 or later
 
+#ifndef SIMD_ANIM_BLEND
+#undef SHARED_POSE_CACHE
+#endif
+
 #ifdef AUDIO_OPUS
 #define AUDIO_OAL_USE_OPUS // enable support of opus files
 #define OPUS_AUDIO_PATHS // changes audio paths to opus paths (doesn't work if AUDIO_OAL_USE_OPUS isn't enabled)
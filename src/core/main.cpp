@@ -72,6 +72,8 @@
 #include "custompipes.h"
 #include "screendroplets.h"
 #include "MemoryHeap.h"
+#include "RenderBuffer.h"
+#include "Impostors.h"
 #ifdef USE_OUR_VERSIONING
 #include "GitSHA1.h"
 #endif
@@ -1407,6 +1409,9 @@ RenderScene(void)
 	CCoronas::RenderReflections();
 	RwRenderStateSet(rwRENDERSTATEFOGENABLE, (void*)TRUE);
 	CRenderer::RenderEverythingBarRoads();
+#ifdef BUILDING_IMPOSTORS
+	CImpostors::Render();
+#endif
 	CRenderer::RenderBoats();
 	DefinedState();
 	CWaterLevel::RenderWater();
@@ -1683,6 +1688,10 @@ Idle(void *arg)
 		RwCameraSetFogDistance(Scene.camera, CTimeCycle::GetFogStart());
 #endif
 
+#ifdef GROWABLE_RENDERBUFFER
+		RenderBuffer::NewFrame();
+#endif
+
 		tbStartTimer(0, "RenderScene");
 		RenderScene();
 		tbEndTimer("RenderScene");
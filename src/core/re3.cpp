@@ -45,6 +45,12 @@
 #include "Population.h"
 #include "IniFile.h"
 #include "Zones.h"
+#include "GroundCache.h"
+#include "Occlusion.h"
+#include "Impostors.h"
+#include "RpAnimBlend.h"
+#include "RenderBuffer.h"
+#include "Timer.h"
 
 #include "crossplatform.h"
 
@@ -792,6 +798,42 @@ ResetCamStatics(void)
 	TheCamera.Cams[TheCamera.ActiveCam].ResetStatics = true;
 }
 
+// compare CCamera::AreSpheresVisible with GetIsOnScreen on all static sector lists
+static void
+BenchmarkFrustumCull(void)
+{
+	static uint8 onScreen[1024];
+	int32 numEntities = 0, numVisibleScalar = 0, numVisibleBatch = 0, numMismatches = 0;
+	uint32 scalarCycles = 0, batchCycles = 0;
+	for(int32 y = 0; y < NUMSECTORS_Y; y++)
+		for(int32 x = 0; x < NUMSECTORS_X; x++)
+			for(int32 l = 0; l < NUMSECTORENTITYLISTS; l++){
+				CSectorEntityArray &list = CWorld::GetSector(x, y)->m_arrays[l];
+				if(!list.staticBounds)
+					continue;
+				for(int32 i = 0; i < list.numEntries; i += ARRAY_SIZE(onScreen)){
+					int32 n = Min(list.numEntries - i, (int32)ARRAY_SIZE(onScreen));
+					uint32 start = CTimer::GetCurrentTimeInCycles();
+					numVisibleBatch += TheCamera.AreSpheresVisible(&list.boundX[i], &list.boundY[i], &list.boundZ[i],
+						&list.boundRadius[i], n, onScreen);
+					uint32 mid = CTimer::GetCurrentTimeInCycles();
+					for(int32 j = 0; j < n; j++)
+						if(list.entities[i+j]->GetIsOnScreen())
+							numVisibleScalar++;
+					uint32 end = CTimer::GetCurrentTimeInCycles();
+					batchCycles += mid - start;
+					scalarCycles += end - mid;
+					for(int32 j = 0; j < n; j++)
+						if(onScreen[j] != list.entities[i+j]->GetIsOnScreen())
+							numMismatches++;
+					numEntities += n;
+				}
+			}
+	float cyclesPerUs = CTimer::GetCyclesPerMillisecond() / 1000.0f;
+	debug("Frustum cull benchmark: %d spheres, scalar %d visible in %.1fus, batched %d visible in %.1fus, %d mismatches\n",
+		numEntities, numVisibleScalar, scalarCycles / cyclesPerUs, numVisibleBatch, batchCycles / cyclesPerUs, numMismatches);
+}
+
 #ifdef MISSION_SWITCHER
 int8 nextMissionToSwitch = 0;
 static void
@@ -964,6 +1006,15 @@ DebugMenuPopulate(void)
 		DebugMenuAddVar("Render", "Max FPS", &RsGlobal.maxFPS, nil, 1, 1, 1000, nil);
 #ifdef NEW_RENDERER
 		DebugMenuAddVarBool8("Render", "New Renderer", &gbNewRenderer, nil);
+		DebugMenuAddVarBool8("Render", "Instanced world", &gbInstancedWorld, nil);
+		DebugMenuAddVarBool8("Render", "Sort world by state", &gbStateSortWorld, nil);
+		DebugMenuAddVar("Render", "World draws", &WorldRender::numDraws, nil, 1, 0, 1000000, nil);
+		DebugMenuAddVar("Render", "World shader changes", &WorldRender::numShaderChanges, nil, 1, 0, 1000000, nil);
+		DebugMenuAddVar("Render", "World geometry changes", &WorldRender::numGeometryChanges, nil, 1, 0, 1000000, nil);
+		DebugMenuAddVar("Render", "World matrix changes", &WorldRender::numMatrixChanges, nil, 1, 0, 1000000, nil);
+		DebugMenuAddVar("Render", "World material changes", &WorldRender::numMaterialChanges, nil, 1, 0, 1000000, nil);
+		DebugMenuAddVar("Render", "World texture changes", &WorldRender::numTextureChanges, nil, 1, 0, 1000000, nil);
+		DebugMenuAddVar("Render", "World cull mode changes", &WorldRender::numCullModeChanges, nil, 1, 0, 1000000, nil);
 extern bool gbRenderRoads;
 extern bool gbRenderEverythingBarRoads;
 //extern bool gbRenderFadingInUnderwaterEntities;
@@ -1043,6 +1094,34 @@ extern bool gbRenderWorld2;
 #endif
 		DebugMenuAddVarBool8("Debug", "Show cullzone debug stuff", &gbShowCullZoneDebugStuff, nil);
 		DebugMenuAddVarBool8("Debug", "Disable zone cull", &gbDisableZoneCull, nil);
+#ifdef GROUND_HEIGHT_CACHE
+		DebugMenuAddVarBool8("Debug", "Ground height cache", &CGroundCache::bEnabled, nil);
+#endif
+#ifdef MULTITHREADED_RENDERLIST
+		DebugMenuAddVarBool8("Debug", "Multithreaded render list", &gbMultithreadedRenderList, nil);
+#endif
+		DebugMenuAddVarBool8("Debug", "Batched frustum cull", &gbBatchFrustumCull, nil);
+		DebugMenuAddCmd("Debug", "Benchmark frustum cull", BenchmarkFrustumCull);
+#ifdef OCCLUSION_CULLING
+		DebugMenuAddVarBool8("Debug", "Occlusion culling", &COcclusion::bEnabled, nil);
+#endif
+#ifdef BUILDING_IMPOSTORS
+		DebugMenuAddVarBool8("Debug", "Building impostors", &CImpostors::bEnabled, nil);
+		DebugMenuAddVar("Debug", "Impostor distance", &CImpostors::ms_fDistance, nil, 50.0f, 100.0f, 2000.0f);
+#endif
+#ifdef SIMD_ANIM_BLEND
+		DebugMenuAddVarBool8("Debug", "SIMD anim blending", &gbSimdAnimBlend, nil);
+		DebugMenuAddCmd("Debug", "Benchmark anim blending", BenchmarkAnimBlend);
+#endif
+#ifdef PED_ANIM_LOD
+		DebugMenuAddVarBool8("Debug", "Ped animation LOD", &gbPedAnimLod, nil);
+#endif
+#ifdef SHARED_POSE_CACHE
+		DebugMenuAddVarBool8("Debug", "Share poses between peds", &gbSharedPoseCache, nil);
+#endif
+#ifdef GROWABLE_RENDERBUFFER
+		DebugMenuAddVarBool8("Debug", "Show render buffer stats", &RenderBuffer::bShowStats, nil);
+#endif
 
 		DebugMenuAddVarBool8("Debug", "pad 1 -> pad 2", &CPad::m_bMapPadOneToPadTwo, nil);
 #ifdef GTA_SCENE_EDIT
@@ -267,3 +267,107 @@ public:
 		return n;
 	}
 };
+
+// Not original. Items with a float sort member that are collected unsorted
+// and then sorted in one go, which is much cheaper than CLinkList::InsertSorted
+// for long lists. Grows instead of dropping items when full.
+template<typename T>
+class CSortedList
+{
+	T *m_items;
+	T *m_temp;
+	int32 m_numItems;
+	int32 m_size;
+	bool m_bSorted;
+
+	static uint32 GetKey(const T &item){
+		// flip floats so they sort like unsigned ints
+		uint32 u;
+		memcpy(&u, &item.sort, sizeof(u));
+		return u & 0x80000000 ? ~u : u | 0x80000000;
+	}
+	void Grow(void){
+		int32 size = m_size*2;
+		T *items = new T[size];
+		memcpy(items, m_items, m_numItems*sizeof(T));
+		delete[] m_items;
+		delete[] m_temp;
+		m_items = items;
+		m_temp = new T[size];
+		m_size = size;
+	}
+public:
+	void Init(int32 n){
+		m_size = Max(n, 16);
+		m_items = new T[m_size];
+		m_temp = new T[m_size];
+		m_numItems = 0;
+		m_bSorted = true;
+	}
+	void Shutdown(void){
+		delete[] m_items;
+		delete[] m_temp;
+		m_items = nil;
+		m_temp = nil;
+		m_numItems = 0;
+		m_size = 0;
+	}
+	void Clear(void){
+		m_numItems = 0;
+		m_bSorted = true;
+	}
+	void Insert(T const &item){
+		if(m_numItems >= m_size)
+			Grow();
+		m_items[m_numItems++] = item;
+		m_bSorted = false;
+	}
+	// ascending, stable. does nothing if nothing was inserted since the last sort
+	void Sort(void){
+		if(m_bSorted)
+			return;
+		m_bSorted = true;
+		int32 n = m_numItems;
+		if(n < 64){
+			for(int32 i = 1; i < n; i++){
+				T item = m_items[i];
+				uint32 key = GetKey(item);
+				int32 j;
+				for(j = i; j > 0 && GetKey(m_items[j-1]) > key; j--)
+					m_items[j] = m_items[j-1];
+				m_items[j] = item;
+			}
+			return;
+		}
+		// LSD radix sort, 8 bits per pass
+		int32 counts[4][256];
+		memset(counts, 0, sizeof(counts));
+		for(int32 i = 0; i < n; i++){
+			uint32 key = GetKey(m_items[i]);
+			counts[0][key & 0xFF]++;
+			counts[1][(key >> 8) & 0xFF]++;
+			counts[2][(key >> 16) & 0xFF]++;
+			counts[3][key >> 24]++;
+		}
+		for(int32 pass = 0; pass < 4; pass++){
+			int32 shift = pass*8;
+			int32 *c = counts[pass];
+			// all keys have the same byte, nothing to do
+			if(c[(GetKey(m_items[0]) >> shift) & 0xFF] == n)
+				continue;
+			int32 offset = 0;
+			for(int32 i = 0; i < 256; i++){
+				int32 num = c[i];
+				c[i] = offset;
+				offset += num;
+			}
+			for(int32 i = 0; i < n; i++)
+				m_temp[c[(GetKey(m_items[i]) >> shift) & 0xFF]++] = m_items[i];
+			T *tmp = m_items;
+			m_items = m_temp;
+			m_temp = tmp;
+		}
+	}
+	int32 GetNumItems(void) const { return m_numItems; }
+	T &operator[](int32 i) { return m_items[i]; }
+};
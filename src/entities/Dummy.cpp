@@ -36,7 +36,7 @@ CDummy::Add(void)
 				list = &s->m_lists[ENTITYLIST_DUMMIES_OVERLAP];
 			CPtrNode *node = list->InsertItem(this);
 			assert(node);
-			m_entryInfoList.InsertItem(list, node, s);
+			s->GetArray(list).Add(this, m_entryInfoList.InsertItem(list, node, s));
 		}
 }
 
@@ -46,6 +46,7 @@ CDummy::Remove(void)
 	CEntryInfoNode *node, *next;
 	for(node = m_entryInfoList.first; node; node = next){
 		next = node->next;
+		node->sector->GetArray(node->list).RemoveAt(node->arrayIndex);
 		node->list->DeleteNode(node->listnode);
 		m_entryInfoList.DeleteNode(node);
 	}
@@ -515,6 +515,7 @@ CEntity::Add(void)
 				break;
 			}
 			list->InsertItem(this);
+			s->GetArray(list).Add(this, nil);
 		}
 }
 
@@ -575,6 +576,40 @@ CEntity::Remove(void)
 				break;
 			}
 			list->RemoveItem(this);
+			s->GetArray(list).Remove(this);
+		}
+}
+
+// Not original. Buildings that are moved in place, without being removed and
+// added again, have to refresh the bounds cached in the sector arrays.
+// The move must not change which sectors the building is in.
+void
+CEntity::UpdateSectorBounds(void)
+{
+	int x, xstart, xmid, xend;
+	int y, ystart, ymid, yend;
+	CSector *s;
+
+	assert(IsBuilding());
+	CRect bounds = GetBoundRect();
+	xstart = CWorld::GetSectorIndexX(bounds.left);
+	xend   = CWorld::GetSectorIndexX(bounds.right);
+	xmid   = CWorld::GetSectorIndexX((bounds.left + bounds.right)/2.0f);
+	ystart = CWorld::GetSectorIndexY(bounds.top);
+	yend   = CWorld::GetSectorIndexY(bounds.bottom);
+	ymid   = CWorld::GetSectorIndexY((bounds.top + bounds.bottom)/2.0f);
+	assert(xstart >= 0);
+	assert(xend < NUMSECTORS_X);
+	assert(ystart >= 0);
+	assert(yend < NUMSECTORS_Y);
+
+	for(y = ystart; y <= yend; y++)
+		for(x = xstart; x <= xend; x++){
+			s = CWorld::GetSector(x, y);
+			if(x == xmid && y == ymid)
+				s->m_arrays[ENTITYLIST_BUILDINGS].UpdateBounds(this);
+			else
+				s->m_arrays[ENTITYLIST_BUILDINGS_OVERLAP].UpdateBounds(this);
 		}
 }
 
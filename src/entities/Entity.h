@@ -153,6 +153,7 @@ public:
 	int16 GetModelIndex(void) const { return m_modelIndex; }
 	void UpdateRwFrame(void);
 	void SetupBigBuilding(void);
+	void UpdateSectorBounds(void);
 
 	void AttachToRwObject(RwObject *obj);
 	void DetachFromRwObject(void);
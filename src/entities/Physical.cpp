@@ -129,7 +129,7 @@ CPhysical::Add(void)
 			}
 			CPtrNode *node = list->InsertItem(this);
 			assert(node);
-			m_entryInfoList.InsertItem(list, node, s);
+			s->GetArray(list).Add(this, m_entryInfoList.InsertItem(list, node, s));
 		}
 }
 
@@ -139,6 +139,7 @@ CPhysical::Remove(void)
 	CEntryInfoNode *node, *next;
 	for(node = m_entryInfoList.first; node; node = next){
 		next = node->next;
+		node->sector->GetArray(node->list).RemoveAt(node->arrayIndex);
 		node->list->DeleteNode(node->listnode);
 		m_entryInfoList.DeleteNode(node);
 	}
@@ -193,14 +194,16 @@ CPhysical::RemoveAndAdd(void)
 			}
 			if(next){
 				// If we still have old nodes, use them
+				next->sector->GetArray(next->list).RemoveAt(next->arrayIndex);
 				next->list->RemoveNode(next->listnode);
 				list->InsertNode(next->listnode);
 				next->list = list;
 				next->sector = s;
+				s->GetArray(list).Add(this, next);
 				next = next->next;
 			}else{
 				CPtrNode *node = list->InsertItem(this);
-				m_entryInfoList.InsertItem(list, node, s);
+				s->GetArray(list).Add(this, m_entryInfoList.InsertItem(list, node, s));
 			}
 		}
 
@@ -208,6 +211,7 @@ CPhysical::RemoveAndAdd(void)
 	CEntryInfoNode *node;
 	for(node = next; node; node = next){
 		next = node->next;
+		node->sector->GetArray(node->list).RemoveAt(node->arrayIndex);
 		node->list->DeleteNode(node->listnode);
 		m_entryInfoList.DeleteNode(node);
 	}
@@ -137,8 +137,18 @@ void AttachRimPipe(rw::Clump *clump);
 
 namespace WorldRender{
 extern int numBlendInsts[3];
+// state changes of the world passes this frame
+extern int numDraws;
+extern int numShaderChanges;
+extern int numGeometryChanges;
+extern int numMatrixChanges;
+extern int numMaterialChanges;
+extern int numTextureChanges;
+extern int numCullModeChanges;
+void ResetStats(void);
 void AtomicFirstPass(RpAtomic *atomic, int pass);
 void AtomicFullyTransparent(RpAtomic *atomic, int pass, int fadeAlpha);
+void RenderQueuedAtomics(void);
 void RenderBlendPass(int pass);
 }
 
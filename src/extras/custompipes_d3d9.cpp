@@ -575,8 +575,28 @@ struct BuildingInst
 BuildingInst blendInsts[3][2000];
 int numBlendInsts[3];
 
+int numDraws;
+int numShaderChanges;
+int numGeometryChanges;
+int numMatrixChanges;
+int numMaterialChanges;
+int numTextureChanges;
+int numCullModeChanges;
+
 static RwRGBAReal black;
 
+void
+ResetStats(void)
+{
+	numDraws = 0;
+	numShaderChanges = 0;
+	numGeometryChanges = 0;
+	numMatrixChanges = 0;
+	numMaterialChanges = 0;
+	numTextureChanges = 0;
+	numCullModeChanges = 0;
+}
+
 static void
 SetMatrix(BuildingInst *building, rw::Matrix *worldMat)
 {
@@ -643,17 +663,24 @@ AtomicFirstPass(RpAtomic *atomic, int pass)
 			else
 				setAmbient(black);
 			setupDone = true;
+			numCullModeChanges++;
+			numShaderChanges++;
+			numGeometryChanges++;
+			numMatrixChanges++;
 		}
 
 		setMaterial(flags, m->color, m->surfaceProps);
+		numMaterialChanges++;
 
 		if(m->texture){
 			d3d::setTexture(0, m->texture);
 			setPixelShader(default_tex_PS);
+			numTextureChanges++;
 		}else
 			setPixelShader(default_PS);
 
 		drawInst(building->instHeader, inst);
+		numDraws++;
 	}
 	if(defer)
 		numBlendInsts[pass]++;
@@ -679,6 +706,12 @@ AtomicFullyTransparent(RpAtomic *atomic, int pass, int fadeAlpha)
 	numBlendInsts[pass]++;
 }
 
+// AtomicFirstPass doesn't queue anything here, no instancing or state sorting on D3D9
+void
+RenderQueuedAtomics(void)
+{
+}
+
 void
 RenderBlendPass(int pass)
 {
@@ -701,6 +734,9 @@ RenderBlendPass(int pass)
 			setAmbient(pAmbient->color);
 		else
 			setAmbient(black);
+		numCullModeChanges++;
+		numGeometryChanges++;
+		numMatrixChanges++;
 
 		InstanceData *inst = building->instHeader->inst;
 		for(rw::uint32 j = 0; j < building->instHeader->numMeshes; j++, inst++){
@@ -711,14 +747,17 @@ RenderBlendPass(int pass)
 			rw::RGBA color = m->color;
 			color.alpha = (color.alpha * building->fadeAlpha)/255;
 			setMaterial(color, m->surfaceProps);	// always modulate here
+			numMaterialChanges++;
 
 			if(m->texture){
 				d3d::setTexture(0, m->texture);
 				setPixelShader(default_tex_PS);
+				numTextureChanges++;
 			}else
 				setPixelShader(default_PS);
 
 			drawInst(building->instHeader, inst);
+			numDraws++;
 		}
 	}
 }
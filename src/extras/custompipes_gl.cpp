@@ -596,12 +596,87 @@ struct BuildingInst
 	rw::Matrix matrix;
 	rw::gl3::InstanceDataHeader *instHeader;
 	uint32 cullMode;
+	uint32 geoFlags;
 	uint8 fadeAlpha;
 	bool lighting;
 };
 BuildingInst blendInsts[3][2000];
 int numBlendInsts[3];
 
+// Opaque atomics are queued until the end of the pass and then
+// drawn sorted by state, models with many copies instanced.
+struct QueuedInst
+{
+	BuildingInst building;
+	int pass;
+	bool instanced;
+};
+static QueuedInst queuedInsts[4000];
+static int sortedQueuedInsts[4000];
+static int numQueuedInsts;
+
+#define MIN_INSTANCES (4)	// smaller groups are drawn one by one
+#define MAX_INSTANCES (256)	// per draw
+
+// queued buildings with the same model, in sortedQueuedInsts
+struct InstanceGroup
+{
+	int first;
+	int num;
+};
+static InstanceGroup instanceGroups[4000];
+static int numInstanceGroups;
+
+// one opaque mesh of a queued building or a whole instance group
+struct DrawItem
+{
+	uint64 key;
+	int index;	// into queuedInsts or instanceGroups
+	int mesh;	// -1 for instance groups
+};
+static DrawItem drawItems[16000];
+static int numDrawItems;
+
+int numDraws;
+int numShaderChanges;
+int numGeometryChanges;
+int numMatrixChanges;
+int numMaterialChanges;
+int numTextureChanges;
+int numCullModeChanges;
+
+// what was set last, so redundant state changes can be skipped
+static struct
+{
+	rw::gl3::Shader *shader;
+	rw::gl3::InstanceDataHeader *header;
+	BuildingInst *building;
+	rw::Material *material;
+	rw::uint32 geoFlags;
+	rw::Texture *texture;
+	uint32 cullMode;
+	int lighting;
+} cur;
+
+// per instance vertex data, rows of the world matrix
+struct WorldInstance
+{
+	float row[3][4];
+	float alpha;
+};
+
+// texcoord sets above 1 are never used by map geometry
+enum {
+	ATTRIB_INSTANCE_ROW0 = 12,
+	ATTRIB_INSTANCE_ROW1,
+	ATTRIB_INSTANCE_ROW2,
+	ATTRIB_INSTANCE_ALPHA
+};
+
+static rw::gl3::Shader *instancedShader;
+static GLuint instanceVbo;
+static int instancingState;	// 0 not initialized, 1 available, -1 not supported
+
 static RwRGBAReal black;
 
 static bool
@@ -612,24 +687,149 @@ IsTextureTransparent(RwTexture *tex)
 	return PLUGINOFFSET(rw::gl3::Gl3Raster, tex->raster, rw::gl3::nativeRasterOffset)->hasAlpha;
 }
 
-// Render all opaque meshes and put atomics that needs blending
-// into the deferred list.
-void
-AtomicFirstPass(RpAtomic *atomic, int pass)
+static bool
+IsMeshTransparent(rw::gl3::InstanceData *inst)
+{
+	return inst->vertexAlpha || inst->material->color.alpha != 255 || IsTextureTransparent(inst->material->texture);
+}
+
+static bool
+InitInstancing(void)
 {
 	using namespace rw;
 	using namespace rw::gl3;
 
-	BuildingInst *building = &blendInsts[pass][numBlendInsts[pass]];
+	if(instancingState == 0){
+		instancingState = -1;
+		if(glVertexAttribDivisor == nil || glDrawElementsInstanced == nil)
+			return false;
+#include "shaders/obj/simple_frag.inc"
+#include "shaders/obj/worldInstanced_vert.inc"
+		const char *vs[] = { shaderDecl,
+			"#define ATTRIB_INSTANCE_ROW0 12\n#define ATTRIB_INSTANCE_ROW1 13\n"
+			"#define ATTRIB_INSTANCE_ROW2 14\n#define ATTRIB_INSTANCE_ALPHA 15\n",
+			header_vert_src, worldInstanced_vert_src, nil };
+		const char *fs[] = { shaderDecl, header_frag_src, simple_frag_src, nil };
+		instancedShader = Shader::create(vs, fs);
+		if(instancedShader == nil)
+			return false;
+		glGenBuffers(1, &instanceVbo);
+		instancingState = 1;
+	}
+	return instancingState == 1;
+}
 
+static void
+SetupBuildingInst(BuildingInst *building, RpAtomic *atomic, int fadeAlpha)
+{
 	atomic->getPipeline()->instance(atomic);
-	building->instHeader = (gl3::InstanceDataHeader*)atomic->geometry->instData;
+	building->instHeader = (rw::gl3::InstanceDataHeader*)atomic->geometry->instData;
 	assert(building->instHeader != nil);
-	assert(building->instHeader->platform == PLATFORM_GL3);
-	building->fadeAlpha = 255;
+	assert(building->instHeader->platform == rw::PLATFORM_GL3);
+	building->fadeAlpha = fadeAlpha;
 	building->lighting = !!(atomic->geometry->flags & rw::Geometry::LIGHT);
+	building->geoFlags = atomic->geometry->flags;
 	building->cullMode = rw::GetRenderState(rw::CULLMODE);
-	rw::uint32 flags = atomic->geometry->flags;
+	building->matrix = *atomic->getFrame()->getLTM();
+}
+
+void
+ResetStats(void)
+{
+	numDraws = 0;
+	numShaderChanges = 0;
+	numGeometryChanges = 0;
+	numMatrixChanges = 0;
+	numMaterialChanges = 0;
+	numTextureChanges = 0;
+	numCullModeChanges = 0;
+}
+
+// Other code sets render states behind our back between calls
+static void
+ResetStateCache(void)
+{
+	cur.shader = nil;
+	cur.header = nil;
+	cur.building = nil;
+	cur.material = nil;
+	cur.texture = nil;
+	cur.cullMode = ~0u;
+	cur.lighting = -1;
+}
+
+static void
+SetCullMode(uint32 cullMode)
+{
+	if(cur.cullMode != cullMode){
+		rw::SetRenderState(rw::CULLMODE, cullMode);
+		cur.cullMode = cullMode;
+		numCullModeChanges++;
+	}
+}
+
+static void
+UseShader(rw::gl3::Shader *shader)
+{
+	if(cur.shader != shader){
+		shader->use();
+		cur.shader = shader;
+		numShaderChanges++;
+	}
+}
+
+static void
+SetVertexInput(rw::gl3::InstanceDataHeader *header)
+{
+	if(cur.header != header){
+		if(cur.header)
+			rw::gl3::teardownVertexInput(cur.header);
+		if(header){
+			rw::gl3::setupVertexInput(header);
+			numGeometryChanges++;
+		}
+		cur.header = header;
+	}
+}
+
+static void
+SetTexture(rw::Texture *texture)
+{
+	if(cur.texture != texture){
+		rw::gl3::setTexture(0, texture);
+		cur.texture = texture;
+		numTextureChanges++;
+	}
+}
+
+static void
+SetOpaqueMaterial(rw::Material *m, rw::uint32 geoFlags)
+{
+	if(cur.material != m || cur.geoFlags != geoFlags){
+		rw::gl3::setMaterial(geoFlags, m->color, m->surfaceProps);
+		cur.material = m;
+		cur.geoFlags = geoFlags;
+		numMaterialChanges++;
+	}
+}
+
+// blended materials are modulated with the fade alpha, never the same twice
+static void
+SetBlendMaterial(const rw::RGBA &color, const rw::SurfaceProperties &surfaceProps)
+{
+	rw::gl3::setMaterial(color, surfaceProps);	// always modulate here
+	cur.material = nil;
+	numMaterialChanges++;
+}
+
+static void
+SetBuildingLights(BuildingInst *building)
+{
+	using namespace rw::gl3;
+
+	if(cur.lighting == building->lighting)
+		return;
+	cur.lighting = building->lighting;
 
 	WorldLights lights;
 	lights.numAmbients = 1;
@@ -639,58 +839,305 @@ AtomicFirstPass(RpAtomic *atomic, int pass)
 		lights.ambient = pAmbient->color;
 	else
 		lights.ambient = black;
+	setLights(&lights);
+}
 
-	bool setupDone = false;
-	bool defer = false;
-	building->matrix = *atomic->getFrame()->getLTM();
+static void
+SetBuilding(BuildingInst *building)
+{
+	if(cur.building != building){
+		rw::gl3::setWorldMatrix(&building->matrix);
+		cur.building = building;
+		numMatrixChanges++;
+	}
+	SetBuildingLights(building);
+}
+
+static bool
+HasTransparentMeshes(BuildingInst *building)
+{
+	for(rw::uint32 i = 0; i < building->instHeader->numMeshes; i++)
+		if(IsMeshTransparent(&building->instHeader->inst[i]))
+			return true;
+	return false;
+}
+
+// one opaque mesh of a building with the default shader
+static void
+RenderOpaqueMesh(BuildingInst *building, rw::gl3::InstanceData *inst)
+{
+	SetCullMode(building->cullMode);
+	UseShader(rw::gl3::defaultShader);
+	SetVertexInput(building->instHeader);
+	SetBuilding(building);
+	SetOpaqueMaterial(inst->material, building->geoFlags);
+	SetTexture(inst->material->texture);
+	rw::gl3::drawInst(building->instHeader, inst);
+	numDraws++;
+}
 
-	InstanceData *inst = building->instHeader->inst;
-	for(rw::uint32 i = 0; i < building->instHeader->numMeshes; i++, inst++){
+// pipeline, texture dictionary, raster, material from high to low bits
+static uint64
+GetSortKey(int pipeline, rw::Material *m)
+{
+	rw::Texture *tex = m->texture;
+	uint64 key = (uint64)pipeline << 62;
+	if(tex){
+		key |= (uint64)(((uintptr)tex->dict >> 4) & 0x3FFF) << 48;
+		key |= (uint64)(((uintptr)tex->raster >> 4) & 0xFFFFFF) << 24;
+	}
+	key |= (uint64)(((uintptr)m >> 4) & 0xFFFFFF);
+	return key;
+}
+
+static int
+CompareDrawItems(const void *a, const void *b)
+{
+	const DrawItem *da = (const DrawItem*)a;
+	const DrawItem *db = (const DrawItem*)b;
+	if(da->key != db->key)
+		return da->key < db->key ? -1 : 1;
+	if(da->index != db->index)
+		return da->index - db->index;
+	return da->mesh - db->mesh;
+}
+
+// Draw the meshes of n buildings with the same geometry and state with
+// one draw per mesh. Like RenderOpaqueMesh or the blend pass, depending
+// on transparent.
+static void
+RenderInstanced(BuildingInst *buildings, int n, bool transparent)
+{
+	using namespace rw;
+	using namespace rw::gl3;
+
+	static WorldInstance instances[MAX_INSTANCES];
+	BuildingInst *building = &buildings[0];
+	InstanceDataHeader *header = building->instHeader;
+
+	for(int i = 0; i < n; i++){
+		rw::Matrix *m = &buildings[i].matrix;
+		WorldInstance *wi = &instances[i];
+		wi->row[0][0] = m->right.x; wi->row[0][1] = m->up.x; wi->row[0][2] = m->at.x; wi->row[0][3] = m->pos.x;
+		wi->row[1][0] = m->right.y; wi->row[1][1] = m->up.y; wi->row[1][2] = m->at.y; wi->row[1][3] = m->pos.y;
+		wi->row[2][0] = m->right.z; wi->row[2][1] = m->up.z; wi->row[2][2] = m->at.z; wi->row[2][3] = m->pos.z;
+		wi->alpha = buildings[i].fadeAlpha/255.0f;
+	}
+
+	SetCullMode(building->cullMode);
+	UseShader(instancedShader);
+	SetVertexInput(nil);
+	setupVertexInput(header);
+	numGeometryChanges++;
+	SetBuildingLights(building);
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+	glBufferData(GL_ARRAY_BUFFER, n*sizeof(WorldInstance), instances, GL_STREAM_DRAW);
+	for(int i = 0; i < 3; i++){
+		glEnableVertexAttribArray(ATTRIB_INSTANCE_ROW0+i);
+		glVertexAttribPointer(ATTRIB_INSTANCE_ROW0+i, 4, GL_FLOAT, GL_FALSE, sizeof(WorldInstance), (void*)(i*4*sizeof(float)));
+		glVertexAttribDivisor(ATTRIB_INSTANCE_ROW0+i, 1);
+	}
+	glEnableVertexAttribArray(ATTRIB_INSTANCE_ALPHA);
+	glVertexAttribPointer(ATTRIB_INSTANCE_ALPHA, 1, GL_FLOAT, GL_FALSE, sizeof(WorldInstance), (void*)offsetof(WorldInstance, alpha));
+	glVertexAttribDivisor(ATTRIB_INSTANCE_ALPHA, 1);
+
+	InstanceData *inst = header->inst;
+	for(rw::uint32 i = 0; i < header->numMeshes; i++, inst++){
 		Material *m = inst->material;
+		if(transparent){
+			if(!IsMeshTransparent(inst) && building->fadeAlpha == 255)
+				continue;	// already done this one
+			SetBlendMaterial(m->color, m->surfaceProps);	// fade is per instance
+		}else{
+			if(IsMeshTransparent(inst))
+				continue;
+			SetOpaqueMaterial(m, building->geoFlags);
+		}
+
+		SetTexture(m->texture);
+
+		flushCache();
+		glDrawElementsInstanced(header->primType, inst->numIndex, GL_UNSIGNED_SHORT, (void*)(uintptr)inst->offset, n);
+		numDraws++;
+	}
+
+	for(int i = 0; i < 4; i++){
+		glVertexAttribDivisor(ATTRIB_INSTANCE_ROW0+i, 0);
+		glDisableVertexAttribArray(ATTRIB_INSTANCE_ROW0+i);
+	}
+	// back to what librw thinks is bound
+	glBindBuffer(GL_ARRAY_BUFFER, header->vbo);
+	teardownVertexInput(header);
+}
+
+static bool
+IsSameInstance(BuildingInst *a, BuildingInst *b)
+{
+	return a->instHeader == b->instHeader && a->cullMode == b->cullMode && a->lighting == b->lighting &&
+		(a->fadeAlpha == 255) == (b->fadeAlpha == 255);
+}
+
+static int
+CompareQueuedInsts(const void *a, const void *b)
+{
+	int ia = *(const int*)a;
+	int ib = *(const int*)b;
+	const BuildingInst *ba = &queuedInsts[ia].building;
+	const BuildingInst *bb = &queuedInsts[ib].building;
+	if(ba->instHeader != bb->instHeader)
+		return (uintptr)ba->instHeader < (uintptr)bb->instHeader ? -1 : 1;
+	if(ba->cullMode != bb->cullMode)
+		return ba->cullMode < bb->cullMode ? -1 : 1;
+	if(ba->lighting != bb->lighting)
+		return ba->lighting ? 1 : -1;
+	return ia - ib;
+}
+
+// Render all opaque meshes and put atomics that needs blending
+// into the deferred list.
+void
+AtomicFirstPass(RpAtomic *atomic, int pass)
+{
+	if(numQueuedInsts < (int)ARRAY_SIZE(queuedInsts)){
+		QueuedInst *q = &queuedInsts[numQueuedInsts];
+		SetupBuildingInst(&q->building, atomic, 255);
+		q->pass = pass;
+		numQueuedInsts++;
+		return;
+	}
+
+	// queue is full, draw it right away
+	BuildingInst *building = &blendInsts[pass][numBlendInsts[pass]];
+	SetupBuildingInst(building, atomic, 255);
+	ResetStateCache();
+	for(rw::uint32 i = 0; i < building->instHeader->numMeshes; i++)
+		if(!IsMeshTransparent(&building->instHeader->inst[i]))
+			RenderOpaqueMesh(building, &building->instHeader->inst[i]);
+	SetVertexInput(nil);
+	if(HasTransparentMeshes(building))
+		numBlendInsts[pass]++;
+}
 
-		if(inst->vertexAlpha || m->color.alpha != 255 ||
-		   IsTextureTransparent(m->texture)){
-			defer = true;
+static void
+FindInstanceGroups(void)
+{
+	int i, j;
+
+	for(i = 0; i < numQueuedInsts; i++)
+		sortedQueuedInsts[i] = i;
+	qsort(sortedQueuedInsts, numQueuedInsts, sizeof(int), CompareQueuedInsts);
+	for(i = 0; i < numQueuedInsts; i = j){
+		BuildingInst *first = &queuedInsts[sortedQueuedInsts[i]].building;
+		for(j = i+1; j < numQueuedInsts; j++)
+			if(!IsSameInstance(first, &queuedInsts[sortedQueuedInsts[j]].building))
+				break;
+		if(j-i < MIN_INSTANCES)
 			continue;
+		for(int k = i; k < j; k += MAX_INSTANCES){
+			instanceGroups[numInstanceGroups].first = k;
+			instanceGroups[numInstanceGroups].num = Min(j-k, MAX_INSTANCES);
+			numInstanceGroups++;
 		}
+		for(int k = i; k < j; k++)
+			queuedInsts[sortedQueuedInsts[k]].instanced = true;
+	}
+}
+
+// Draw the collected draw items sorted by their keys
+static void
+FlushDrawItems(void)
+{
+	static BuildingInst group[MAX_INSTANCES];
+	int i;
 
-		// alright we're rendering this atomic
-		if(!setupDone){
-			rw::SetRenderState(rw::CULLMODE, building->cullMode);
-			defaultShader->use();
-			setWorldMatrix(&building->matrix);
-			setupVertexInput(building->instHeader);
-			setLights(&lights);
-			setupDone = true;
+	qsort(drawItems, numDrawItems, sizeof(DrawItem), CompareDrawItems);
+	for(i = 0; i < numDrawItems; i++){
+		DrawItem *item = &drawItems[i];
+		if(item->mesh < 0){
+			InstanceGroup *g = &instanceGroups[item->index];
+			for(int k = 0; k < g->num; k++)
+				group[k] = queuedInsts[sortedQueuedInsts[g->first + k]].building;
+			RenderInstanced(group, g->num, false);
+		}else{
+			BuildingInst *building = &queuedInsts[item->index].building;
+			RenderOpaqueMesh(building, &building->instHeader->inst[item->mesh]);
 		}
+	}
+	numDrawItems = 0;
+}
 
-		setMaterial(flags, m->color, m->surfaceProps);
+// Buildings can have any number of meshes, so when the list is full
+// what's in it is drawn and it's started again.
+static DrawItem*
+AddDrawItem(void)
+{
+	if(numDrawItems >= (int)ARRAY_SIZE(drawItems))
+		FlushDrawItems();
+	return &drawItems[numDrawItems++];
+}
 
-		setTexture(0, m->texture);
+// Draw what AtomicFirstPass queued, has to be done before the blend passes.
+// Sorted by state if gbStateSortWorld is set, in the original order otherwise.
+// Models with enough copies are drawn instanced.
+void
+RenderQueuedAtomics(void)
+{
+	int i;
 
-		drawInst(building->instHeader, inst);
+	if(numQueuedInsts == 0)
+		return;
+
+	// the deferred list keeps its order
+	for(i = 0; i < numQueuedInsts; i++){
+		QueuedInst *q = &queuedInsts[i];
+		q->instanced = false;
+		if(HasTransparentMeshes(&q->building))
+			blendInsts[q->pass][numBlendInsts[q->pass]++] = q->building;
 	}
-	teardownVertexInput(building->instHeader);
-	if(defer)
-		numBlendInsts[pass]++;
+
+	numInstanceGroups = 0;
+	if(gbInstancedWorld && InitInstancing())
+		FindInstanceGroups();
+
+	ResetStateCache();
+	numDrawItems = 0;
+	for(i = 0; i < numQueuedInsts; i++){
+		QueuedInst *q = &queuedInsts[i];
+		if(q->instanced)
+			continue;
+		rw::gl3::InstanceDataHeader *header = q->building.instHeader;
+		for(rw::uint32 k = 0; k < header->numMeshes; k++){
+			if(IsMeshTransparent(&header->inst[k]))
+				continue;
+			DrawItem *item = AddDrawItem();
+			item->key = gbStateSortWorld ? GetSortKey(0, header->inst[k].material) : 0;
+			item->index = i;
+			item->mesh = k;
+		}
+	}
+	for(i = 0; i < numInstanceGroups; i++){
+		rw::gl3::InstanceDataHeader *header = queuedInsts[sortedQueuedInsts[instanceGroups[i].first]].building.instHeader;
+		DrawItem *item = AddDrawItem();
+		item->key = (uint64)1 << 62;
+		for(rw::uint32 k = 0; k < header->numMeshes; k++)
+			if(gbStateSortWorld && !IsMeshTransparent(&header->inst[k])){
+				item->key = GetSortKey(1, header->inst[k].material);
+				break;
+			}
+		item->index = i;
+		item->mesh = -1;
+	}
+	FlushDrawItems();
+	SetVertexInput(nil);
+	numQueuedInsts = 0;
 }
 
 void
 AtomicFullyTransparent(RpAtomic *atomic, int pass, int fadeAlpha)
 {
-	using namespace rw;
-	using namespace rw::gl3;
-
 	BuildingInst *building = &blendInsts[pass][numBlendInsts[pass]];
-
-	atomic->getPipeline()->instance(atomic);
-	building->instHeader = (gl3::InstanceDataHeader*)atomic->geometry->instData;
-	assert(building->instHeader != nil);
-	assert(building->instHeader->platform == PLATFORM_GL3);
-	building->fadeAlpha = fadeAlpha;
-	building->lighting = !!(atomic->geometry->flags & rw::Geometry::LIGHT);
-	building->cullMode = rw::GetRenderState(rw::CULLMODE);
-	building->matrix = *atomic->getFrame()->getLTM();
+	SetupBuildingInst(building, atomic, fadeAlpha);
 	numBlendInsts[pass]++;
 }
 
@@ -700,41 +1147,45 @@ RenderBlendPass(int pass)
 	using namespace rw;
 	using namespace rw::gl3;
 
-	defaultShader->use();
-	WorldLights lights;
-	lights.numAmbients = 1;
-	lights.numDirectionals = 0;
-	lights.numLocals = 0;
-
-	int i;
-	for(i = 0; i < numBlendInsts[pass]; i++){
+	int i, j;
+	ResetStateCache();
+	for(i = 0; i < numBlendInsts[pass]; i = j){
 		BuildingInst *building = &blendInsts[pass][i];
 
-		rw::SetRenderState(rw::CULLMODE, building->cullMode);
-		setupVertexInput(building->instHeader);
-		setWorldMatrix(&building->matrix);
-		if(building->lighting)
-			lights.ambient = pAmbient->color;
-		else
-			lights.ambient = black;
-		setLights(&lights);
+		// runs of the same model keep their order when drawn instanced
+		j = i+1;
+		if(gbInstancedWorld && InitInstancing()){
+			while(j < numBlendInsts[pass] && j-i < MAX_INSTANCES && IsSameInstance(building, &blendInsts[pass][j]))
+				j++;
+			if(j-i >= MIN_INSTANCES){
+				RenderInstanced(building, j-i, true);
+				continue;
+			}
+			j = i+1;
+		}
+
+		SetCullMode(building->cullMode);
+		UseShader(defaultShader);
+		SetVertexInput(building->instHeader);
+		SetBuilding(building);
 
 		InstanceData *inst = building->instHeader->inst;
-		for(rw::uint32 j = 0; j < building->instHeader->numMeshes; j++, inst++){
+		for(rw::uint32 k = 0; k < building->instHeader->numMeshes; k++, inst++){
 			Material *m = inst->material;
-			if(!inst->vertexAlpha && m->color.alpha == 255 && !IsTextureTransparent(m->texture) && building->fadeAlpha == 255)
+			if(!IsMeshTransparent(inst) && building->fadeAlpha == 255)
 				continue;	// already done this one
 
 			rw::RGBA color = m->color;
 			color.alpha = (color.alpha * building->fadeAlpha)/255;
-			setMaterial(color, m->surfaceProps);	// always modulate here
+			SetBlendMaterial(color, m->surfaceProps);
 
-			setTexture(0, m->texture);
+			SetTexture(m->texture);
 
 			drawInst(building->instHeader, inst);
+			numDraws++;
 		}
-		teardownVertexInput(building->instHeader);
 	}
+	SetVertexInput(nil);
 }
 }
 #endif
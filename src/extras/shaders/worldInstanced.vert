@@ -0,0 +1,29 @@
+VSIN(ATTRIB_POS)	vec3 in_pos;
+VSIN(ATTRIB_INSTANCE_ROW0)	vec4 in_instRow0;
+VSIN(ATTRIB_INSTANCE_ROW1)	vec4 in_instRow1;
+VSIN(ATTRIB_INSTANCE_ROW2)	vec4 in_instRow2;
+VSIN(ATTRIB_INSTANCE_ALPHA)	float in_instAlpha;
+
+VSOUT vec4 v_color;
+VSOUT vec2 v_tex0;
+VSOUT float v_fog;
+
+void
+main(void)
+{
+	vec4 pos = vec4(in_pos, 1.0);
+	vec4 Vertex = vec4(dot(in_instRow0, pos), dot(in_instRow1, pos), dot(in_instRow2, pos), 1.0);
+	gl_Position = u_proj * u_view * Vertex;
+	vec3 Normal = vec3(dot(in_instRow0.xyz, in_normal), dot(in_instRow1.xyz, in_normal), dot(in_instRow2.xyz, in_normal));
+
+	v_tex0 = in_tex0;
+
+	v_color = in_color;
+	v_color.rgb += u_ambLight.rgb*surfAmbient;
+	v_color.rgb += DoDynamicLight(Vertex.xyz, Normal)*surfDiffuse;
+	v_color = clamp(v_color, 0.0, 1.0);
+	v_color *= u_matColor;
+	v_color.a *= in_instAlpha;
+
+	v_fog = DoFog(gl_Position.w);
+}
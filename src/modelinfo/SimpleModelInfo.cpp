@@ -5,6 +5,9 @@
 #include "Renderer.h"
 #include "ModelInfo.h"
 #include "custompipes.h"
+#ifdef BUILDING_IMPOSTORS
+#include "Impostors.h"
+#endif
 
 void
 CSimpleModelInfo::DeleteRwObject(void)
@@ -13,6 +16,9 @@ CSimpleModelInfo::DeleteRwObject(void)
 	RwFrame *f;
 	for(i = 0; i < m_numAtomics; i++)
 		if(m_atomics[i]){
+#ifdef BUILDING_IMPOSTORS
+			CImpostors::RemoveAtomic(m_atomics[i]);
+#endif
 			f = RpAtomicGetFrame(m_atomics[i]);
 			RpAtomicDestroy(m_atomics[i]);
 			RwFrameDestroy(f);
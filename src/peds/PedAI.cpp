@@ -4851,6 +4851,17 @@ CPed::FindBestCoordsFromNodes(CVector unused, CVector *bestCoords)
 	return false;
 }
 
+static bool
+IsVehicleGoodCover(CEntity *entity, void *data)
+{
+	CVehicle *veh = (CVehicle*)entity;
+	return veh->m_vecMoveSpeed.Magnitude() <= 0.02f
+		&& !veh->bIsBus
+		&& !veh->bIsVan
+		&& !veh->bIsBig
+		&& veh->m_numPedsUseItAsCover < 3;
+}
+
 bool
 CPed::DuckAndCover(void)
 {
@@ -4882,29 +4893,11 @@ CPed::DuckAndCover(void)
 
 	bool justDucked = false;
 	CVehicle *foundVeh = nil;
-	float maxDist = 225.0f;
 	bIsDucking = false;
 	bCrouchWhenShooting = false;
 	if (CTimer::GetTimeInMilliseconds() > m_leaveCarTimer) {
-		CVector pos = GetPosition();
-		int16 lastVehicle;
-		CEntity *vehicles[8];
-		CWorld::FindObjectsInRange(pos, CHECK_NEARBY_THINGS_MAX_DIST, true, &lastVehicle, 6, vehicles, false, true, false, false, false);
-
-		for (int i = 0; i < lastVehicle; i++) {
-			CVehicle *veh = (CVehicle*) vehicles[i];
-			if (veh->m_vecMoveSpeed.Magnitude() <= 0.02f
-				&& !veh->bIsBus
-				&& !veh->bIsVan
-				&& !veh->bIsBig
-				&& veh->m_numPedsUseItAsCover < 3) {
-				float dist = (GetPosition() - veh->GetPosition()).MagnitudeSqr();
-				if (dist < maxDist) {
-					maxDist = dist;
-					foundVeh = veh;
-				}
-			}
-		}
+		// closest one within 15m, not just among the first 6 the sectors gave
+		foundVeh = (CVehicle*)CWorld::FindNearestObject(GetPosition(), CHECK_NEARBY_THINGS_MAX_DIST, false, LOS_VEHICLES, IsVehicleGoodCover);
 		if (foundVeh) {
 			// Unused.
 			// CVector lfWheelPos, rfWheelPos;
@@ -62,6 +62,25 @@ bool CCoronas::bSmallMoon;
 bool CCoronas::SunBlockedByClouds;
 int CCoronas::bChangeBrightnessImmediately;
 
+#ifdef BATCHED_CORONA_LOS
+// Not original. Every corona used to check its line of sight to the camera
+// every frame. Only buildings can block it, so a result stays good until the
+// camera or the corona moves. Stale results are checked again by importance,
+// a limited number per frame, all in one GetIsLineOfSightClearBatch.
+#define CORONA_LOS_PER_FRAME (24)
+#define CORONA_LOS_MOVE_DIST (0.5f)	// either end may move this much before the result is stale
+
+struct tCoronaLos
+{
+	CVector camPos;
+	CVector coors;
+	bool bValid;
+	bool bClear;
+};
+
+static tCoronaLos aCoronaLos[NUMCORONAS];
+#endif
+
 CRegisteredCorona CCoronas::aCoronas[NUMCORONAS];
 
 const char aCoronaSpriteNames[][32] = {
@@ -126,11 +145,87 @@ CCoronas::Update(void)
 		bChangeBrightnessImmediately = Max(bChangeBrightnessImmediately-1, 0);
 	LastCamLook = CamLook;
 
+#ifdef BATCHED_CORONA_LOS
+	UpdateLosChecks();
+#endif
+
 	for(i = 0; i < NUMCORONAS; i++)
 		if(aCoronas[i].id != 0)
 			aCoronas[i].Update();
 }
 
+#ifdef BATCHED_CORONA_LOS
+struct tCoronaLosRequest
+{
+	int32 corona;
+	float importance;
+};
+
+static int
+CompareCoronaLosRequests(const void *a, const void *b)
+{
+	float ia = ((tCoronaLosRequest*)a)->importance;
+	float ib = ((tCoronaLosRequest*)b)->importance;
+	return ia > ib ? -1 : ia < ib ? 1 : 0;
+}
+
+void
+CCoronas::UpdateLosChecks(void)
+{
+	int i;
+	tCoronaLosRequest requests[NUMCORONAS];
+	CWorldLosRay rays[CORONA_LOS_PER_FRAME];
+	int numRequests = 0;
+	CVector camPos = TheCamera.GetPosition();
+
+	for(i = 0; i < NUMCORONAS; i++){
+		CRegisteredCorona &corona = aCoronas[i];
+		tCoronaLos &los = aCoronaLos[i];
+		// Update doesn't need the check for these, they fade out either way
+		if(corona.id == 0 || !corona.LOScheck || corona.offScreen ||
+		   SunBlockedByClouds && corona.id == SUN_CORONA)
+			continue;
+		if(los.bValid &&
+		   (los.camPos - camPos).MagnitudeSqr() < sq(CORONA_LOS_MOVE_DIST) &&
+		   (los.coors - corona.coors).MagnitudeSqr() < sq(CORONA_LOS_MOVE_DIST))
+			continue;
+
+		// coronas without a result first, then the big and bright ones close by
+		float importance = corona.size * corona.alpha / Max((corona.coors - camPos).MagnitudeSqr(), 1.0f);
+		if(!los.bValid)
+			importance += 1000000.0f;
+		requests[numRequests].corona = i;
+		requests[numRequests].importance = importance;
+		numRequests++;
+	}
+	if(numRequests == 0)
+		return;
+
+	if(numRequests > CORONA_LOS_PER_FRAME){
+		qsort(requests, numRequests, sizeof(tCoronaLosRequest), CompareCoronaLosRequests);
+		numRequests = CORONA_LOS_PER_FRAME;
+	}
+	for(i = 0; i < numRequests; i++)
+		rays[i].Set(aCoronas[requests[i].corona].coors, camPos, LOS_BUILDINGS);
+	CWorld::GetIsLineOfSightClearBatch(rays, numRequests);
+	for(i = 0; i < numRequests; i++){
+		tCoronaLos &los = aCoronaLos[requests[i].corona];
+		los.camPos = camPos;
+		los.coors = aCoronas[requests[i].corona].coors;
+		los.bValid = true;
+		los.bClear = !rays[i].hit;
+	}
+}
+
+bool
+CCoronas::IsLosClear(const CRegisteredCorona *corona)
+{
+	const tCoronaLos &los = aCoronaLos[corona - aCoronas];
+	// not checked yet, stay invisible until it is
+	return los.bValid && los.bClear;
+}
+#endif
+
 void
 CCoronas::RegisterCorona(uint32 id, uint8 red, uint8 green, uint8 blue, uint8 alpha,
 	const CVector &coors, float size, float drawDist, RwTexture *tex,
@@ -167,6 +262,9 @@ CCoronas::RegisterCorona(uint32 id, uint8 red, uint8 green, uint8 blue, uint8 al
 		aCoronas[i].hasValue[3] = false;
 		aCoronas[i].hasValue[4] = false;
 		aCoronas[i].hasValue[5] = false;
+#ifdef BATCHED_CORONA_LOS
+		aCoronaLos[i].bValid = false;
+#endif
 
 	}else{
 		// use existing one
@@ -561,7 +659,11 @@ CRegisteredCorona::Update(void)
 
 	if(LOScheck &&
 	   (CCoronas::SunBlockedByClouds && id == CCoronas::SUN_CORONA ||
+#ifdef BATCHED_CORONA_LOS
+	    !CCoronas::IsLosClear(this))){
+#else
 	    !CWorld::GetIsLineOfSightClear(coors, TheCamera.GetPosition(), true, false, false, false, false, false))){
+#endif
 		// Corona is blocked, fade out
 		fadeAlpha = Max(fadeAlpha - 15.0f*CTimer::GetTimeStep(), 0.0f);
 	}else if(offScreen){
@@ -44,6 +44,9 @@ VALIDATE_SIZE(CRegisteredCorona, 0x80);
 class CCoronas
 {
 	static CRegisteredCorona aCoronas[NUMCORONAS];
+#ifdef BATCHED_CORONA_LOS
+	static void UpdateLosChecks(void);
+#endif
 public:
 	enum {
 		SUN_CORE = 1,
@@ -98,4 +101,7 @@ public:
 	static void Render(void);
 	static void RenderReflections(void);
 	static void DoSunAndMoon(void);
+#ifdef BATCHED_CORONA_LOS
+	static bool IsLosClear(const CRegisteredCorona *corona);
+#endif
 };
@@ -37,6 +37,128 @@ CFontDetails CFont::Details;
 bool16 CFont::NewLine;
 CSprite2d CFont::Sprite[MAX_FONTS];
 
+#ifdef BATCHED_TEXT
+// Not original.
+// The HUD, pager, subtitles and menus print the same strings every frame,
+// and every time they're split into lines word by word with GetStringWidth.
+// The lines of the last strings are remembered here, keyed on the string,
+// a hash of its text and everything in Details that changes the layout.
+// Colour tokens are still handled when the lines are printed.
+#define FONT_LAYOUT_CACHE_SIZE (64)
+#define FONT_LAYOUT_MAX_LINES (16)
+
+enum
+{
+	FONT_LAYOUT_PRINT,
+	FONT_LAYOUT_NUMLINES,
+	FONT_LAYOUT_TEXTRECT,
+};
+
+struct tFontLayoutKey
+{
+	wchar *str;
+	uint32 hash;
+	int32 kind;
+	float xstart;
+	float scaleX;
+	float scaleY;
+	float wrapX;
+	float centreSize;
+	float rightJustifyWrap;
+	int16 style;
+	bool8 justify;
+	bool8 centre;
+	bool8 rightJustify;
+	bool8 proportional;
+};
+
+struct tFontLayoutLine
+{
+	int16 start;
+	int16 end;
+	float x;
+	float y;	// from ystart
+	float spaceWidth;
+};
+
+struct tFontLayout
+{
+	tFontLayoutKey key;
+	int32 numLines;
+	float maxLength;	// only for FONT_LAYOUT_TEXTRECT
+	tFontLayoutLine lines[FONT_LAYOUT_MAX_LINES];
+};
+
+static tFontLayout aFontLayouts[FONT_LAYOUT_CACHE_SIZE];
+static int32 nNextFontLayout;
+
+static void
+FlushFontLayouts(void)
+{
+	for(int i = 0; i < FONT_LAYOUT_CACHE_SIZE; i++)
+		aFontLayouts[i].key.str = nil;
+}
+
+// returns nil if the layout has to be worked out, key is set up for AddFontLayout then
+static tFontLayout*
+FindFontLayout(tFontLayoutKey *key, wchar *s, int32 kind, float xstart)
+{
+	uint32 hash = 2166136261u;
+	for(wchar *t = s; *t != '\0'; t++)
+		hash = (hash ^ *t) * 16777619u;
+
+	memset(key, 0, sizeof(*key));	// compared with memcmp
+	key->str = s;
+	key->hash = hash;
+	key->kind = kind;
+	key->xstart = xstart;
+	key->scaleX = CFont::Details.scaleX;
+	key->scaleY = CFont::Details.scaleY;
+	key->wrapX = CFont::Details.wrapX;
+	key->centreSize = CFont::Details.centreSize;
+	key->rightJustifyWrap = CFont::Details.rightJustifyWrap;
+	key->style = CFont::Details.style;
+	key->justify = CFont::Details.justify;
+	key->centre = CFont::Details.centre;
+	key->rightJustify = CFont::Details.rightJustify;
+	key->proportional = CFont::Details.proportional;
+
+	for(int i = 0; i < FONT_LAYOUT_CACHE_SIZE; i++)
+		if(aFontLayouts[i].key.str == s && memcmp(&aFontLayouts[i].key, key, sizeof(*key)) == 0)
+			return &aFontLayouts[i];
+	return nil;
+}
+
+static tFontLayout*
+AddFontLayout(const tFontLayoutKey &key)
+{
+	tFontLayout *layout = &aFontLayouts[nNextFontLayout];
+	nNextFontLayout = (nNextFontLayout + 1) % FONT_LAYOUT_CACHE_SIZE;
+	layout->key = key;
+	layout->numLines = 0;
+	layout->maxLength = 0.0f;
+	return layout;
+}
+
+static void
+AddFontLayoutLine(tFontLayout *layout, wchar *s, wchar *start, wchar *end, float x, float y, float spaceWidth)
+{
+	if(layout->key.str == nil)
+		return;
+	if(layout->numLines >= FONT_LAYOUT_MAX_LINES){
+		// too long to keep
+		layout->key.str = nil;
+		return;
+	}
+	tFontLayoutLine *line = &layout->lines[layout->numLines++];
+	line->start = start - s;
+	line->end = end - s;
+	line->x = x;
+	line->y = y;
+	line->spaceWidth = spaceWidth;
+}
+#endif
+
 #ifdef MORE_LANGUAGES
 uint8 CFont::LanguageSet = FONT_LANGSET_EFIGS;
 int32 CFont::Slot = -1;
@@ -440,6 +562,9 @@ CFont::ReloadFonts(uint8 set)
 		CTxdStore::PopCurrentTxd();
 	}
 	LanguageSet = set;
+#ifdef BATCHED_TEXT
+	FlushFontLayouts();
+#endif
 }
 #endif
 
@@ -470,12 +595,23 @@ CFont::Shutdown(void)
 void
 CFont::InitPerFrame(void)
 {
+#ifdef BATCHED_TEXT
+	// big enough for most screens to go out in one draw per font
+	Details.bank = CSprite2d::GetBank(256, Sprite[0].m_pTexture);
+	CSprite2d::GetBank(128, Sprite[1].m_pTexture);
+	CSprite2d::GetBank(128, Sprite[2].m_pTexture);
+#ifdef MORE_LANGUAGES
+	if (IsJapanese())
+		CSprite2d::GetBank(128, Sprite[3].m_pTexture);
+#endif
+#else
 	Details.bank = CSprite2d::GetBank(30, Sprite[0].m_pTexture);
 	CSprite2d::GetBank(15, Sprite[1].m_pTexture);
 	CSprite2d::GetBank(15, Sprite[2].m_pTexture);
 #ifdef MORE_LANGUAGES
 	if (IsJapanese())
 		CSprite2d::GetBank(15, Sprite[3].m_pTexture);
+#endif
 #endif
 	SetDropShadowPosition(0);
 	NewLine = false;
@@ -664,6 +800,31 @@ CFont::PrintString(float xstart, float ystart, wchar *s)
 		CSprite2d::DrawRect(rect, Details.backgroundColor);
 	}
 
+#ifdef BATCHED_TEXT
+	tFontLayoutKey key;
+	tFontLayout *layout = nil;
+#ifdef MORE_LANGUAGES
+	if(!IsJapanese())
+#endif
+	{
+		layout = FindFontLayout(&key, s, FONT_LAYOUT_PRINT, xstart);
+		if(layout){
+			for(int i = 0; i < layout->numLines; i++){
+				tFontLayoutLine *line = &layout->lines[i];
+#ifdef MORE_LANGUAGES
+				wchar *end = s + line->end;
+				PrintString(line->x, ystart + line->y, s + line->start, end, line->spaceWidth, xstart);
+#else
+				PrintString(line->x, ystart + line->y, s + line->start, s + line->end, line->spaceWidth);
+#endif
+			}
+			return;
+		}
+		layout = AddFontLayout(key);
+	}
+	wchar *str = s;
+#endif
+
 	lineLength = 0.0f;
 	numSpaces = 0;
 	first = true;
@@ -698,6 +859,10 @@ CFont::PrintString(float xstart, float ystart, wchar *s)
 					float xleft = Details.centre ? xstart - x/2 :
 					              Details.rightJustify ? xstart - x :
 					              xstart;
+#ifdef BATCHED_TEXT
+					if(layout)
+						AddFontLayoutLine(layout, str, start, s, xleft, y - ystart, spaceWidth);
+#endif
 #ifdef MORE_LANGUAGES
 					PrintString(xleft, y, start, s, spaceWidth, xstart);
 #else
@@ -768,6 +933,10 @@ CFont::PrintString(float xstart, float ystart, wchar *s)
 		float xleft = Details.centre ? xstart - x/2 :
 		              Details.rightJustify ? xstart - x :
 		              xstart;
+#ifdef BATCHED_TEXT
+		if(layout)
+			AddFontLayoutLine(layout, str, start, s, xleft, y - ystart, 0.0f);
+#endif
 #ifdef MORE_LANGUAGES
 		if (PrintString(xleft, y, start, s, 0.0f, xstart) && IsJapaneseFont()) {
 			start = s;
@@ -794,6 +963,18 @@ CFont::GetNumberLines(float xstart, float ystart, wchar *s)
 	wchar *t;
 	n = 0;
 
+#ifdef BATCHED_TEXT
+	tFontLayoutKey key;
+#ifdef MORE_LANGUAGES
+	if(!IsJapanese())
+#endif
+	{
+		tFontLayout *layout = FindFontLayout(&key, s, FONT_LAYOUT_NUMLINES, xstart);
+		if(layout)
+			return layout->numLines;
+	}
+#endif
+
 #ifdef MORE_LANGUAGES
 	bool bSomeJapBool = false;
 
@@ -884,6 +1065,12 @@ CFont::GetNumberLines(float xstart, float ystart, wchar *s)
 		}
 	}
 
+#ifdef BATCHED_TEXT
+#ifdef MORE_LANGUAGES
+	if(!IsJapanese())
+#endif
+		AddFontLayout(key)->numLines = n;
+#endif
 	return n;
 }
 
@@ -903,6 +1090,14 @@ CFont::GetTextRect(CRect *rect, float xstart, float ystart, wchar *s)
 		numLines = GetNumberLines(xstart, ystart, s);
 	}else{
 #endif
+#ifdef BATCHED_TEXT
+	tFontLayoutKey key;
+	tFontLayout *layout = FindFontLayout(&key, s, FONT_LAYOUT_TEXTRECT, xstart);
+	if(layout){
+		numLines = layout->numLines;
+		maxlength = layout->maxLength;
+	}else{
+#endif
 
 #ifdef FIX_BUGS
 		if(Details.centre || Details.rightJustify)
@@ -953,6 +1148,12 @@ CFont::GetTextRect(CRect *rect, float xstart, float ystart, wchar *s)
 				}
 			}
 		}
+#ifdef BATCHED_TEXT
+		layout = AddFontLayout(key);
+		layout->numLines = numLines;
+		layout->maxLength = maxlength;
+	}
+#endif
 #ifdef MORE_LANGUAGES
 	}
 #endif
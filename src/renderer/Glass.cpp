@@ -551,11 +551,7 @@ CGlass::RenderHiLightPolys(void)
 
 		LittleTest();
 
-		if ( RwIm3DTransform(TempBufferRenderVertices, TempBufferVerticesStoredHiLight, nil, rwIM3D_VERTEXUV) )
-		{
-			RwIm3DRenderIndexedPrimitive(rwPRIMTYPETRILIST, TempBufferRenderIndexList, TempBufferIndicesStoredHiLight);
-			RwIm3DEnd();
-		}
+		RenderBuffer::RenderIndexed(TempBufferRenderVertices, TempBufferVerticesStoredHiLight, TempBufferRenderIndexList, TempBufferIndicesStoredHiLight);
 
 		TempBufferVerticesStoredHiLight = TEMPBUFFERVERTHILIGHTOFFSET;
 		TempBufferIndicesStoredHiLight  = TEMPBUFFERINDEXHILIGHTOFFSET;
@@ -573,11 +569,8 @@ CGlass::RenderShatteredPolys(void)
 
 		LittleTest();
 
-		if ( RwIm3DTransform(&TempBufferRenderVertices[TEMPBUFFERVERTSHATTEREDOFFSET], TempBufferVerticesStoredShattered - TEMPBUFFERVERTSHATTEREDOFFSET, nil, rwIM3D_VERTEXUV) )
-		{
-			RwIm3DRenderIndexedPrimitive(rwPRIMTYPETRILIST, &TempBufferRenderIndexList[TEMPBUFFERINDEXSHATTEREDOFFSET], TempBufferIndicesStoredShattered - TEMPBUFFERINDEXSHATTEREDOFFSET);
-			RwIm3DEnd();
-		}
+		RenderBuffer::RenderIndexed(&TempBufferRenderVertices[TEMPBUFFERVERTSHATTEREDOFFSET], TempBufferVerticesStoredShattered - TEMPBUFFERVERTSHATTEREDOFFSET,
+			&TempBufferRenderIndexList[TEMPBUFFERINDEXSHATTEREDOFFSET], TempBufferIndicesStoredShattered - TEMPBUFFERINDEXSHATTEREDOFFSET);
 
 		TempBufferIndicesStoredShattered  = TEMPBUFFERINDEXSHATTEREDOFFSET;
 		TempBufferVerticesStoredShattered = TEMPBUFFERVERTSHATTEREDOFFSET;
@@ -595,11 +588,8 @@ CGlass::RenderReflectionPolys(void)
 
 		LittleTest();
 
-		if ( RwIm3DTransform(&TempBufferRenderVertices[TEMPBUFFERVERTREFLECTIONOFFSET], TempBufferVerticesStoredReflection - TEMPBUFFERVERTREFLECTIONOFFSET, nil, rwIM3D_VERTEXUV) )
-		{
-			RwIm3DRenderIndexedPrimitive(rwPRIMTYPETRILIST, &TempBufferRenderIndexList[TEMPBUFFERINDEXREFLECTIONOFFSET], TempBufferIndicesStoredReflection - TEMPBUFFERINDEXREFLECTIONOFFSET);
-			RwIm3DEnd();
-		}
+		RenderBuffer::RenderIndexed(&TempBufferRenderVertices[TEMPBUFFERVERTREFLECTIONOFFSET], TempBufferVerticesStoredReflection - TEMPBUFFERVERTREFLECTIONOFFSET,
+			&TempBufferRenderIndexList[TEMPBUFFERINDEXREFLECTIONOFFSET], TempBufferIndicesStoredReflection - TEMPBUFFERINDEXREFLECTIONOFFSET);
 
 		TempBufferIndicesStoredReflection  = TEMPBUFFERINDEXREFLECTIONOFFSET;
 		TempBufferVerticesStoredReflection = TEMPBUFFERVERTREFLECTIONOFFSET;
@@ -0,0 +1,389 @@
+#include "common.h"
+
+#include "main.h"
+#include "General.h"
+#include "Timer.h"
+#include "Clock.h"
+#include "Camera.h"
+#include "Entity.h"
+#include "RwHelper.h"
+#include "Lights.h"
+#include "Impostors.h"
+
+#define IMPOSTOR_TEXTURE_WIDTH (IMPOSTOR_NUM_VIEWS*IMPOSTOR_VIEW_SIZE)
+#define IMPOSTOR_TEXTURE_HEIGHT (IMPOSTOR_VIEW_SIZE)
+
+CImpostor CImpostors::ms_aImpostors[IMPOSTOR_MAX_IMPOSTORS];
+int16 CImpostors::ms_aHash[IMPOSTOR_HASH_SIZE];
+CImpostorInstance CImpostors::ms_aInstances[IMPOSTOR_MAX_INSTANCES];
+int16 CImpostors::ms_aFirstInstance[IMPOSTOR_MAX_IMPOSTORS];
+int32 CImpostors::ms_nNumInstances;
+uint32 CImpostors::ms_nInstanceFrame;
+RwCamera *CImpostors::ms_pCamera;
+RpAtomic *CImpostors::ms_pAtomic;
+bool CImpostors::bEnabled = true;
+float CImpostors::ms_fDistance = 500.0f;
+
+static RwIm3DVertex aImpostorVertices[IMPOSTOR_MAX_INSTANCES*4];
+static RwImVertexIndex aImpostorIndices[IMPOSTOR_MAX_INSTANCES*6];
+
+static int32
+GetHashIndex(RpAtomic *atomic)
+{
+	return ((uintptr)atomic >> 4) & (IMPOSTOR_HASH_SIZE-1);
+}
+
+void
+CImpostors::Init(void)
+{
+	int i;
+
+	for(i = 0; i < IMPOSTOR_MAX_IMPOSTORS; i++){
+		ms_aImpostors[i].atomic = nil;
+		ms_aImpostors[i].texture = nil;
+		ms_aImpostors[i].next = -1;
+		ms_aImpostors[i].bakeHour = -1;
+		ms_aFirstInstance[i] = -1;
+	}
+	for(i = 0; i < IMPOSTOR_HASH_SIZE; i++)
+		ms_aHash[i] = -1;
+	for(i = 0; i < IMPOSTOR_MAX_INSTANCES; i++){
+		aImpostorIndices[i*6 + 0] = i*4 + 0;
+		aImpostorIndices[i*6 + 1] = i*4 + 1;
+		aImpostorIndices[i*6 + 2] = i*4 + 2;
+		aImpostorIndices[i*6 + 3] = i*4 + 2;
+		aImpostorIndices[i*6 + 4] = i*4 + 1;
+		aImpostorIndices[i*6 + 5] = i*4 + 3;
+	}
+	ms_nNumInstances = 0;
+
+	// Orthographic camera looking down +y, the views are rendered next to each other along x.
+	// Like the game's cameras this has up x at in the right vector, which really points left.
+	ms_pCamera = RwCameraCreate();
+	if(ms_pCamera == nil)
+		return;
+	RwFrame *frame = RwFrameCreate();
+	RwMatrix *mat = RwFrameGetMatrix(frame);
+	RwMatrixGetRight(mat)->x = -1.0f;
+	RwMatrixGetRight(mat)->y = 0.0f;
+	RwMatrixGetRight(mat)->z = 0.0f;
+	RwMatrixGetAt(mat)->x = 0.0f;
+	RwMatrixGetAt(mat)->y = 1.0f;
+	RwMatrixGetAt(mat)->z = 0.0f;
+	RwMatrixGetUp(mat)->x = 0.0f;
+	RwMatrixGetUp(mat)->y = 0.0f;
+	RwMatrixGetUp(mat)->z = 1.0f;
+	RwMatrixUpdate(mat);
+	RwCameraSetFrame(ms_pCamera, frame);
+	RwCameraSetProjection(ms_pCamera, rwPARALLEL);
+	RwCameraSetZRaster(ms_pCamera, RwRasterCreate(IMPOSTOR_TEXTURE_WIDTH, IMPOSTOR_TEXTURE_HEIGHT, 0, rwRASTERTYPEZBUFFER));
+	RpWorldAddCamera(Scene.world, ms_pCamera);
+
+	ms_pAtomic = RpAtomicCreate();
+	RpAtomicSetFrame(ms_pAtomic, RwFrameCreate());
+}
+
+void
+CImpostors::Shutdown(void)
+{
+	int i;
+
+	for(i = 0; i < IMPOSTOR_MAX_IMPOSTORS; i++){
+		if(ms_aImpostors[i].texture){
+			RwTextureDestroy(ms_aImpostors[i].texture);
+			ms_aImpostors[i].texture = nil;
+		}
+		ms_aImpostors[i].atomic = nil;
+	}
+	if(ms_pAtomic){
+		RwFrame *frame = RpAtomicGetFrame(ms_pAtomic);
+		RpAtomicSetFrame(ms_pAtomic, nil);
+		RwFrameDestroy(frame);
+		RpAtomicDestroy(ms_pAtomic);
+		ms_pAtomic = nil;
+	}
+	if(ms_pCamera){
+		RpWorldRemoveCamera(Scene.world, ms_pCamera);
+		RwRasterDestroy(RwCameraGetZRaster(ms_pCamera));
+		RwCameraSetZRaster(ms_pCamera, nil);
+		RwCameraSetRaster(ms_pCamera, nil);
+		RwFrame *frame = RwCameraGetFrame(ms_pCamera);
+		RwCameraSetFrame(ms_pCamera, nil);
+		RwFrameDestroy(frame);
+		RwCameraDestroy(ms_pCamera);
+		ms_pCamera = nil;
+	}
+}
+
+int32
+CImpostors::FindImpostor(RpAtomic *atomic)
+{
+	int32 i;
+	for(i = ms_aHash[GetHashIndex(atomic)]; i >= 0; i = ms_aImpostors[i].next)
+		if(ms_aImpostors[i].atomic == atomic)
+			return i;
+	return -1;
+}
+
+int32
+CImpostors::CreateImpostor(RpAtomic *atomic)
+{
+	int32 i;
+	int32 slot = -1;
+	uint32 oldest = CTimer::GetFrameCounter();
+
+	// free slot or the one that wasn't used for the longest time
+	for(i = 0; i < IMPOSTOR_MAX_IMPOSTORS; i++){
+		if(ms_aImpostors[i].atomic == nil){
+			slot = i;
+			break;
+		}
+		if(ms_aImpostors[i].lastFrameUsed < oldest){
+			oldest = ms_aImpostors[i].lastFrameUsed;
+			slot = i;
+		}
+	}
+	if(slot < 0)
+		return -1;
+	if(ms_aImpostors[slot].atomic)
+		RemoveImpostor(slot);
+
+	CImpostor *imp = &ms_aImpostors[slot];
+	RwSphere *sphere = RpMorphTargetGetBoundingSphere(RpGeometryGetMorphTarget(RpAtomicGetGeometry(atomic), 0));
+	imp->atomic = atomic;
+	imp->centre = sphere->center;
+	imp->radius = sphere->radius;
+	imp->bakeHour = -1;
+	int32 hash = GetHashIndex(atomic);
+	imp->next = ms_aHash[hash];
+	ms_aHash[hash] = slot;
+	return slot;
+}
+
+void
+CImpostors::RemoveImpostor(int32 i)
+{
+	// the texture is kept, they're all the same size
+	int16 *link = &ms_aHash[GetHashIndex(ms_aImpostors[i].atomic)];
+	while(*link != i)
+		link = &ms_aImpostors[*link].next;
+	*link = ms_aImpostors[i].next;
+	ms_aImpostors[i].atomic = nil;
+	ms_aImpostors[i].next = -1;
+	ms_aImpostors[i].bakeHour = -1;
+}
+
+// The model info is about to destroy this atomic, a new one
+// may well get the same address
+void
+CImpostors::RemoveAtomic(RpAtomic *atomic)
+{
+	if(ms_pCamera == nil)
+		return;
+	int32 i = FindImpostor(atomic);
+	if(i < 0)
+		return;
+	RemoveImpostor(i);
+	ms_aFirstInstance[i] = -1;
+}
+
+bool
+CImpostors::AddImpostor(CEntity *ent, RpAtomic *atomic, float dist)
+{
+	int32 i;
+
+	if(!bEnabled || dist < ms_fDistance || ms_pCamera == nil)
+		return false;
+#ifdef NEW_RENDERER
+	if(gbNewRenderer)
+		return false;
+#endif
+
+	uint32 frame = CTimer::GetFrameCounter();
+	if(ms_nInstanceFrame != frame){
+		ms_nInstanceFrame = frame;
+		ms_nNumInstances = 0;
+		for(i = 0; i < IMPOSTOR_MAX_IMPOSTORS; i++)
+			ms_aFirstInstance[i] = -1;
+	}
+
+	i = FindImpostor(atomic);
+	if(i < 0){
+		i = CreateImpostor(atomic);
+		if(i < 0)
+			return false;
+	}
+	CImpostor *imp = &ms_aImpostors[i];
+	imp->lastFrameUsed = frame;
+	// not baked yet, draw the mesh until Update has done that
+	if(imp->bakeHour < 0 || ms_nNumInstances >= IMPOSTOR_MAX_INSTANCES)
+		return false;
+
+	CImpostorInstance *inst = &ms_aInstances[ms_nNumInstances];
+	inst->impostor = i;
+	inst->centre = ent->GetMatrix() * imp->centre;
+	// pick the view that was baked closest to the direction we're looking from
+	CVector dir = Multiply3x3(TheCamera.GetPosition() - inst->centre, ent->GetMatrix());
+	float angle = CGeneral::GetATanOfXY(dir.x, dir.y);
+	inst->view = (int32)(angle * IMPOSTOR_NUM_VIEWS / TWOPI + 0.5f) % IMPOSTOR_NUM_VIEWS;
+	inst->next = ms_aFirstInstance[i];
+	ms_aFirstInstance[i] = ms_nNumInstances++;
+	return true;
+}
+
+void
+CImpostors::BakeImpostor(CImpostor *imp)
+{
+	int i;
+
+	if(imp->texture == nil){
+		RwRaster *raster = RwRasterCreate(IMPOSTOR_TEXTURE_WIDTH, IMPOSTOR_TEXTURE_HEIGHT,
+			RwRasterGetDepth(RwCameraGetRaster(Scene.camera)), rwRASTERTYPECAMERATEXTURE);
+		if(raster == nil)
+			return;
+		imp->texture = RwTextureCreate(raster);
+		RwTextureSetFilterMode(imp->texture, rwFILTERLINEAR);
+		RwTextureSetAddressing(imp->texture, rwTEXTUREADDRESSCLAMP);
+	}
+
+	float r = imp->radius;
+	RwV2d viewWindow;
+	viewWindow.x = IMPOSTOR_NUM_VIEWS*r;
+	viewWindow.y = r;
+	RwCameraSetRaster(ms_pCamera, RwTextureGetRaster(imp->texture));
+	RwCameraSetViewWindow(ms_pCamera, &viewWindow);
+	RwCameraSetNearClipPlane(ms_pCamera, 0.5f*r);
+	RwCameraSetFarClipPlane(ms_pCamera, 3.5f*r);
+	RwFrame *frame = RwCameraGetFrame(ms_pCamera);
+	RwMatrixGetPos(RwFrameGetMatrix(frame))->x = 0.0f;
+	RwMatrixGetPos(RwFrameGetMatrix(frame))->y = -2.0f*r;
+	RwMatrixGetPos(RwFrameGetMatrix(frame))->z = 0.0f;
+	RwMatrixUpdate(RwFrameGetMatrix(frame));
+	RwFrameUpdateObjects(frame);
+
+	RpAtomicSetGeometry(ms_pAtomic, RpAtomicGetGeometry(imp->atomic), 0);
+
+	RwRGBA clearColour = { 0, 0, 0, 0 };
+	RwCameraClear(ms_pCamera, &clearColour, rwCAMERACLEARIMAGE|rwCAMERACLEARZ);
+	if(RwCameraBeginUpdate(ms_pCamera)){
+		RwRenderStateSet(rwRENDERSTATEZTESTENABLE, (void*)TRUE);
+		RwRenderStateSet(rwRENDERSTATEZWRITEENABLE, (void*)TRUE);
+		RwRenderStateSet(rwRENDERSTATEFOGENABLE, (void*)FALSE);
+		RwRenderStateSet(rwRENDERSTATEVERTEXALPHAENABLE, (void*)FALSE);
+		// lit like buildings, not with whatever the last entity rendered left behind
+		DeActivateDirectional();
+		SetAmbientColours();
+		frame = RpAtomicGetFrame(ms_pAtomic);
+		RwMatrix *mat = RwFrameGetMatrix(frame);
+		for(i = 0; i < IMPOSTOR_NUM_VIEWS; i++){
+			// turn the model so view i (seen from angle i*TWOPI/N) faces the camera at -y
+			float angle = -HALFPI - i*TWOPI/IMPOSTOR_NUM_VIEWS;
+			float c = Cos(angle);
+			float s = Sin(angle);
+			RwMatrixGetRight(mat)->x = c;
+			RwMatrixGetRight(mat)->y = s;
+			RwMatrixGetRight(mat)->z = 0.0f;
+			RwMatrixGetUp(mat)->x = -s;
+			RwMatrixGetUp(mat)->y = c;
+			RwMatrixGetUp(mat)->z = 0.0f;
+			RwMatrixGetAt(mat)->x = 0.0f;
+			RwMatrixGetAt(mat)->y = 0.0f;
+			RwMatrixGetAt(mat)->z = 1.0f;
+			RwMatrixGetPos(mat)->x = (2*i + 1 - IMPOSTOR_NUM_VIEWS)*r - (c*imp->centre.x - s*imp->centre.y);
+			RwMatrixGetPos(mat)->y = -(s*imp->centre.x + c*imp->centre.y);
+			RwMatrixGetPos(mat)->z = -imp->centre.z;
+			RwMatrixUpdate(mat);
+			RwFrameUpdateObjects(frame);
+			RpAtomicRender(ms_pAtomic);
+		}
+		RwCameraEndUpdate(ms_pCamera);
+	}
+	// don't keep the geometry and its textures alive after the model is deleted
+	RpAtomicSetGeometry(ms_pAtomic, nil, 0);
+	imp->bakeHour = CClock::GetHours();
+}
+
+void
+CImpostors::Update(void)
+{
+	int i;
+	int numBaked = 0;
+
+	if(ms_pCamera == nil || ms_nInstanceFrame != CTimer::GetFrameCounter())
+		return;
+
+	// new impostors first, then the ones baked with the light of another hour
+	for(i = 0; i < IMPOSTOR_MAX_IMPOSTORS && numBaked < IMPOSTOR_BAKES_PER_FRAME; i++)
+		if(ms_aImpostors[i].atomic && ms_aImpostors[i].bakeHour < 0 &&
+		   ms_aImpostors[i].lastFrameUsed == ms_nInstanceFrame){
+			BakeImpostor(&ms_aImpostors[i]);
+			numBaked++;
+		}
+	for(i = 0; i < IMPOSTOR_MAX_IMPOSTORS && numBaked < IMPOSTOR_BAKES_PER_FRAME; i++)
+		if(ms_aImpostors[i].atomic && ms_aImpostors[i].bakeHour != CClock::GetHours() &&
+		   ms_aImpostors[i].lastFrameUsed == ms_nInstanceFrame){
+			BakeImpostor(&ms_aImpostors[i]);
+			numBaked++;
+		}
+}
+
+void
+CImpostors::Render(void)
+{
+	int i, j;
+
+	if(ms_nInstanceFrame != CTimer::GetFrameCounter() || ms_nNumInstances == 0)
+		return;
+
+	RwRenderStateSet(rwRENDERSTATEZTESTENABLE, (void*)TRUE);
+	RwRenderStateSet(rwRENDERSTATEZWRITEENABLE, (void*)TRUE);
+	RwRenderStateSet(rwRENDERSTATEVERTEXALPHAENABLE, (void*)TRUE);
+	RwRenderStateSet(rwRENDERSTATESRCBLEND, (void*)rwBLENDSRCALPHA);
+	RwRenderStateSet(rwRENDERSTATEDESTBLEND, (void*)rwBLENDINVSRCALPHA);
+	RwRenderStateSet(rwRENDERSTATETEXTUREFILTER, (void*)rwFILTERLINEAR);
+	SetAlphaRef(128);
+
+	const CVector &camPos = TheCamera.GetPosition();
+	for(i = 0; i < IMPOSTOR_MAX_IMPOSTORS; i++){
+		if(ms_aFirstInstance[i] < 0)
+			continue;
+		CImpostor *imp = &ms_aImpostors[i];
+		float r = imp->radius;
+		int32 n = 0;
+		for(j = ms_aFirstInstance[i]; j >= 0; j = ms_aInstances[j].next){
+			CImpostorInstance *inst = &ms_aInstances[j];
+			// turns around z to face the camera
+			CVector right(inst->centre.y - camPos.y, camPos.x - inst->centre.x, 0.0f);
+			right.Normalise();
+			right *= r;
+			float u0 = (float)inst->view/IMPOSTOR_NUM_VIEWS;
+			float u1 = (float)(inst->view+1)/IMPOSTOR_NUM_VIEWS;
+			RwIm3DVertex *v = &aImpostorVertices[n*4];
+			RwIm3DVertexSetPos(&v[0], inst->centre.x - right.x, inst->centre.y - right.y, inst->centre.z + r);
+			RwIm3DVertexSetPos(&v[1], inst->centre.x + right.x, inst->centre.y + right.y, inst->centre.z + r);
+			RwIm3DVertexSetPos(&v[2], inst->centre.x - right.x, inst->centre.y - right.y, inst->centre.z - r);
+			RwIm3DVertexSetPos(&v[3], inst->centre.x + right.x, inst->centre.y + right.y, inst->centre.z - r);
+			RwIm3DVertexSetRGBA(&v[0], 255, 255, 255, 255);
+			RwIm3DVertexSetRGBA(&v[1], 255, 255, 255, 255);
+			RwIm3DVertexSetRGBA(&v[2], 255, 255, 255, 255);
+			RwIm3DVertexSetRGBA(&v[3], 255, 255, 255, 255);
+			RwIm3DVertexSetU(&v[0], u0);
+			RwIm3DVertexSetV(&v[0], 0.0f);
+			RwIm3DVertexSetU(&v[1], u1);
+			RwIm3DVertexSetV(&v[1], 0.0f);
+			RwIm3DVertexSetU(&v[2], u0);
+			RwIm3DVertexSetV(&v[2], 1.0f);
+			RwIm3DVertexSetU(&v[3], u1);
+			RwIm3DVertexSetV(&v[3], 1.0f);
+			n++;
+		}
+		RwRenderStateSet(rwRENDERSTATETEXTURERASTER, RwTextureGetRaster(imp->texture));
+		if(RwIm3DTransform(aImpostorVertices, n*4, nil, rwIM3D_VERTEXUV)){
+			RwIm3DRenderIndexedPrimitive(rwPRIMTYPETRILIST, aImpostorIndices, n*6);
+			RwIm3DEnd();
+		}
+	}
+
+	SetAlphaRef(2);
+	RwRenderStateSet(rwRENDERSTATEVERTEXALPHAENABLE, (void*)FALSE);
+}
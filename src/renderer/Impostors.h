@@ -0,0 +1,65 @@
+#pragma once
+
+// Not original.
+// Far away big buildings are drawn as camera facing billboards instead of
+// their LOD meshes. The first time a LOD atomic is needed past ms_fDistance
+// it's rendered from IMPOSTOR_NUM_VIEWS directions around it into a texture,
+// the billboard then shows the view closest to the camera direction.
+// Impostors are baked again when the hour changes so they keep up with
+// the time of day lighting, and the least recently used ones are thrown
+// away when all slots are taken.
+
+#define IMPOSTOR_NUM_VIEWS (8)
+#define IMPOSTOR_VIEW_SIZE (64)		// pixels, every view is square
+#define IMPOSTOR_MAX_IMPOSTORS (128)	// ~128k of texture each
+#define IMPOSTOR_MAX_INSTANCES (512)	// drawn per frame
+#define IMPOSTOR_HASH_SIZE (256)	// power of two
+#define IMPOSTOR_BAKES_PER_FRAME (4)
+
+class CEntity;
+
+struct CImpostor
+{
+	RpAtomic *atomic;	// the LOD atomic of the model info this was baked from, nil if unused
+	RwTexture *texture;
+	CVector centre;		// bounding sphere in model space
+	float radius;
+	uint32 lastFrameUsed;
+	int16 next;		// in the hash chain
+	int8 bakeHour;		// -1 if not baked yet
+};
+
+struct CImpostorInstance
+{
+	int16 impostor;
+	int16 view;
+	int16 next;		// next instance of the same impostor
+	CVector centre;
+};
+
+class CImpostors
+{
+	static CImpostor ms_aImpostors[IMPOSTOR_MAX_IMPOSTORS];
+	static int16 ms_aHash[IMPOSTOR_HASH_SIZE];
+	static CImpostorInstance ms_aInstances[IMPOSTOR_MAX_INSTANCES];
+	static int16 ms_aFirstInstance[IMPOSTOR_MAX_IMPOSTORS];
+	static int32 ms_nNumInstances;
+	static uint32 ms_nInstanceFrame;
+	static RwCamera *ms_pCamera;
+	static RpAtomic *ms_pAtomic;
+
+	static int32 FindImpostor(RpAtomic *atomic);
+	static int32 CreateImpostor(RpAtomic *atomic);
+	static void RemoveImpostor(int32 i);
+	static void BakeImpostor(CImpostor *imp);
+public:
+	static bool bEnabled;
+	static float ms_fDistance;
+
+	static void Init(void);
+	static void Shutdown(void);
+	static void RemoveAtomic(RpAtomic *atomic);
+	static bool AddImpostor(CEntity *ent, RpAtomic *atomic, float dist);
+	static void Update(void);
+	static void Render(void);
+};
@@ -0,0 +1,326 @@
+#include "common.h"
+
+#include "main.h"
+#include "General.h"
+#include "Draw.h"
+#include "Camera.h"
+#include "World.h"
+#include "ModelInfo.h"
+#include "Collision.h"
+#include "SurfaceTable.h"
+#include "Occlusion.h"
+
+#if defined __SSE__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 1)
+#define OCCLUSION_SSE
+#include <xmmintrin.h>
+#elif defined __ARM_NEON
+#define OCCLUSION_NEON
+#include <arm_neon.h>
+#endif
+
+float COcclusion::ms_aDepth[OCCLUSION_BUFFER_HEIGHT][OCCLUSION_BUFFER_WIDTH];
+float COcclusion::ms_fScaleX;
+float COcclusion::ms_fScaleY;
+bool COcclusion::ms_bBufferValid;
+CEntity *COcclusion::ms_apOccluders[OCCLUSION_MAX_OCCLUDERS];
+float COcclusion::ms_afOccluderScores[OCCLUSION_MAX_OCCLUDERS];
+bool COcclusion::bEnabled = true;
+int32 COcclusion::ms_nNumOccluders;
+int32 COcclusion::ms_nNumTriangles;
+int32 COcclusion::ms_nNumOccluded;
+
+void
+COcclusion::ProcessBeforeRendering(void)
+{
+	ms_bBufferValid = false;
+	ms_nNumOccluders = 0;
+	ms_nNumTriangles = 0;
+	ms_nNumOccluded = 0;
+	if(!bEnabled)
+		return;
+
+	// same projection as the RW camera, so the buffer covers exactly the screen
+	RwV2d vw = *RwCameraGetViewWindow(TheCamera.m_pRwCamera);
+	ms_fScaleX = OCCLUSION_BUFFER_WIDTH*0.5f / vw.x;
+	ms_fScaleY = OCCLUSION_BUFFER_HEIGHT*0.5f / vw.y;
+
+	memset(ms_aDepth, 0, sizeof(ms_aDepth));
+	FindOccluders();
+	for(int32 i = 0; i < ms_nNumOccluders; i++)
+		RasterizeOccluder(ms_apOccluders[i]);
+	ms_bBufferValid = true;
+}
+
+// Only entities that are drawn solid with their full model
+// and whose collision has something to rasterize.
+bool
+COcclusion::IsOccluder(CEntity *ent, float dist)
+{
+	if(!ent->bIsVisible || ent->m_rwObject == nil)
+		return false;
+	CSimpleModelInfo *mi = (CSimpleModelInfo*)CModelInfo::GetModelInfo(ent->GetModelIndex());
+	if(mi->GetModelType() != MITYPE_SIMPLE)
+		return false;
+	if(mi->m_drawLast || mi->m_alpha != 255 || dist > mi->GetLargestLodDistance())
+		return false;
+	CColModel *col = mi->GetColModel();
+	return col && (col->numTriangles > 0 || col->numBoxes > 0);
+}
+
+// keeps the occluders sorted by score, biggest first
+void
+COcclusion::AddOccluder(CEntity *ent, float score)
+{
+	int32 i = ms_nNumOccluders;
+	if(i == OCCLUSION_MAX_OCCLUDERS){
+		if(score <= ms_afOccluderScores[i-1])
+			return;
+		i--;
+	}else
+		ms_nNumOccluders++;
+	for(; i > 0 && ms_afOccluderScores[i-1] < score; i--){
+		ms_apOccluders[i] = ms_apOccluders[i-1];
+		ms_afOccluderScores[i] = ms_afOccluderScores[i-1];
+	}
+	ms_apOccluders[i] = ent;
+	ms_afOccluderScores[i] = score;
+}
+
+void
+COcclusion::FindOccluders(void)
+{
+	static CWorldQuery query;
+	const CVector &camPos = TheCamera.GetPosition();
+	const CMatrix &camMat = TheCamera.GetCameraMatrix();
+
+	query.Begin();
+	int32 minX = Max(CWorld::GetSectorIndexX(camPos.x - OCCLUDER_MAX_DIST), 0);
+	int32 maxX = Min(CWorld::GetSectorIndexX(camPos.x + OCCLUDER_MAX_DIST), NUMSECTORS_X - 1);
+	int32 minY = Max(CWorld::GetSectorIndexY(camPos.y - OCCLUDER_MAX_DIST), 0);
+	int32 maxY = Min(CWorld::GetSectorIndexY(camPos.y + OCCLUDER_MAX_DIST), NUMSECTORS_Y - 1);
+	for(int32 y = minY; y <= maxY; y++)
+		for(int32 x = minX; x <= maxX; x++)
+			for(int32 l = ENTITYLIST_BUILDINGS; l <= ENTITYLIST_BUILDINGS_OVERLAP; l++){
+				CSectorEntityArray &list = CWorld::GetSector(x, y)->m_arrays[l];
+				for(int32 i = 0; i < list.numEntries; i++){
+					float radius = list.boundRadius[i];
+					if(radius < OCCLUDER_MIN_RADIUS)
+						continue;
+					CVector centre(list.boundX[i], list.boundY[i], list.boundZ[i]);
+					float dist = (centre - camPos).Magnitude();
+					if(dist - radius > OCCLUDER_MAX_DIST)
+						continue;
+					if(!TheCamera.IsSphereVisible(centre, radius, &camMat))
+						continue;
+					CEntity *ent = list.entities[i];
+					if(!query.Visit(ent) || !IsOccluder(ent, dist))
+						continue;
+					// roughly how much of the screen it covers
+					AddOccluder(ent, radius / Max(dist, 1.0f));
+				}
+			}
+}
+
+void
+COcclusion::RasterizeOccluder(CEntity *ent)
+{
+	CColModel *col = ent->GetColModel();
+	CMatrix mat = TheCamera.GetCameraMatrix() * ent->GetMatrix();
+
+	for(int32 i = 0; i < col->numTriangles; i++){
+		CColTriangle &tri = col->triangles[i];
+		if(IsSeeThrough(tri.surface))
+			continue;
+		if(ms_nNumTriangles >= OCCLUSION_MAX_TRIANGLES)
+			return;
+		RasterizeTriangle(mat * col->vertices[tri.a].Get(), mat * col->vertices[tri.b].Get(), mat * col->vertices[tri.c].Get());
+	}
+
+	static const uint8 boxTris[12][3] = {
+		{ 0, 1, 3 }, { 0, 3, 2 }, { 4, 6, 7 }, { 4, 7, 5 },
+		{ 0, 4, 5 }, { 0, 5, 1 }, { 2, 3, 7 }, { 2, 7, 6 },
+		{ 0, 2, 6 }, { 0, 6, 4 }, { 1, 5, 7 }, { 1, 7, 3 }
+	};
+	for(int32 i = 0; i < col->numBoxes; i++){
+		CColBox &box = col->boxes[i];
+		if(IsSeeThrough(box.surface))
+			continue;
+		if(ms_nNumTriangles + 12 > OCCLUSION_MAX_TRIANGLES)
+			return;
+		CVector corners[8];
+		for(int32 j = 0; j < 8; j++)
+			corners[j] = mat * CVector(j & 4 ? box.max.x : box.min.x, j & 2 ? box.max.y : box.min.y, j & 1 ? box.max.z : box.min.z);
+		for(int32 j = 0; j < 12; j++)
+			RasterizeTriangle(corners[boxTris[j][0]], corners[boxTris[j][1]], corners[boxTris[j][2]]);
+	}
+}
+
+// a, b and c are in camera space
+void
+COcclusion::RasterizeTriangle(const CVector &a, const CVector &b, const CVector &c)
+{
+	ms_nNumTriangles++;
+
+	// clip against the near plane, leaves at most a quad
+	float nearZ = CDraw::GetNearClipZ();
+	const CVector *in[3] = { &a, &b, &c };
+	CVector poly[4];
+	int32 n = 0;
+	for(int32 i = 0; i < 3; i++){
+		const CVector &p = *in[i];
+		const CVector &q = *in[(i+1)%3];
+		if(p.y >= nearZ)
+			poly[n++] = p;
+		if((p.y >= nearZ) != (q.y >= nearZ))
+			poly[n++] = p + (q - p)*((nearZ - p.y)/(q.y - p.y));
+	}
+	if(n < 3)
+		return;
+
+	COccluderVertex verts[4];
+	for(int32 i = 0; i < n; i++){
+		float w = 1.0f/poly[i].y;
+		verts[i].x = OCCLUSION_BUFFER_WIDTH*0.5f + poly[i].x*w*ms_fScaleX;
+		verts[i].y = OCCLUSION_BUFFER_HEIGHT*0.5f - poly[i].z*w*ms_fScaleY;
+		verts[i].w = w;
+	}
+	DrawTriangle(verts[0], verts[1], verts[2]);
+	if(n == 4)
+		DrawTriangle(verts[0], verts[2], verts[3]);
+}
+
+// Fills the pixels that are completely inside the triangle, four at a time,
+// with the farthest depth over the pixel, so the buffer never claims more
+// than the occluders really cover.
+// Collision doesn't have a consistent winding, so there is no backface culling.
+void
+COcclusion::DrawTriangle(const COccluderVertex &v0, const COccluderVertex &v1In, const COccluderVertex &v2In)
+{
+	const COccluderVertex *pv1 = &v1In;
+	const COccluderVertex *pv2 = &v2In;
+	float area = (pv1->x - v0.x)*(pv2->y - v0.y) - (pv2->x - v0.x)*(pv1->y - v0.y);
+	if(area < 0.0f){
+		const COccluderVertex *tmp = pv1;
+		pv1 = pv2;
+		pv2 = tmp;
+		area = -area;
+	}
+	if(area < 0.0001f)
+		return;
+	const COccluderVertex &v1 = *pv1;
+	const COccluderVertex &v2 = *pv2;
+
+	int32 minX = Max((int32)Floor(Min(v0.x, Min(v1.x, v2.x))), 0);
+	int32 maxX = Min((int32)Floor(Max(v0.x, Max(v1.x, v2.x))), OCCLUSION_BUFFER_WIDTH - 1);
+	int32 minY = Max((int32)Floor(Min(v0.y, Min(v1.y, v2.y))), 0);
+	int32 maxY = Min((int32)Floor(Max(v0.y, Max(v1.y, v2.y))), OCCLUSION_BUFFER_HEIGHT - 1);
+	if(minX > maxX || minY > maxY)
+		return;
+	minX &= ~3;
+
+	// edge i is inside where a*x + b*y + c >= 0
+	float ea[3], eb[3], ec[3];
+	const COccluderVertex *v[3] = { &v0, &v1, &v2 };
+	for(int32 i = 0; i < 3; i++){
+		const COccluderVertex &p = *v[i];
+		const COccluderVertex &q = *v[(i+1)%3];
+		ea[i] = p.y - q.y;
+		eb[i] = q.x - p.x;
+		ec[i] = -ea[i]*p.x - eb[i]*p.y;
+		// move the edge in so that evaluated at the top left corner
+		// it tells whether the least inside corner is inside
+		ec[i] += Min(ea[i], 0.0f) + Min(eb[i], 0.0f);
+	}
+	// w is linear in screen space
+	float dwdx = ((v1.w - v0.w)*(v2.y - v0.y) - (v2.w - v0.w)*(v1.y - v0.y)) / area;
+	float dwdy = ((v2.w - v0.w)*(v1.x - v0.x) - (v1.w - v0.w)*(v2.x - v0.x)) / area;
+	float w0 = v0.w - dwdx*v0.x - dwdy*v0.y;
+	// and the same for the farthest depth
+	w0 += Min(dwdx, 0.0f) + Min(dwdy, 0.0f);
+
+	for(int32 y = minY; y <= maxY; y++){
+		float py = (float)y;
+		float *row = ms_aDepth[y];
+		float e0 = eb[0]*py + ec[0];
+		float e1 = eb[1]*py + ec[1];
+		float e2 = eb[2]*py + ec[2];
+		float wy = dwdy*py + w0;
+#if defined OCCLUSION_SSE
+		const __m128 steps = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+		const __m128 zero = _mm_setzero_ps();
+		for(int32 x = minX; x <= maxX; x += 4){
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x), steps);
+			__m128 in0 = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(ea[0]), px), _mm_set1_ps(e0)), zero);
+			__m128 in1 = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(ea[1]), px), _mm_set1_ps(e1)), zero);
+			__m128 in2 = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(ea[2]), px), _mm_set1_ps(e2)), zero);
+			__m128 inside = _mm_and_ps(in0, _mm_and_ps(in1, in2));
+			__m128 w = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(dwdx), px), _mm_set1_ps(wy));
+			_mm_storeu_ps(&row[x], _mm_max_ps(_mm_loadu_ps(&row[x]), _mm_and_ps(w, inside)));
+		}
+#elif defined OCCLUSION_NEON
+		const float stepValues[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+		const float32x4_t steps = vld1q_f32(stepValues);
+		const float32x4_t zero = vdupq_n_f32(0.0f);
+		for(int32 x = minX; x <= maxX; x += 4){
+			float32x4_t px = vaddq_f32(vdupq_n_f32((float)x), steps);
+			uint32x4_t in0 = vcgeq_f32(vmlaq_f32(vdupq_n_f32(e0), vdupq_n_f32(ea[0]), px), zero);
+			uint32x4_t in1 = vcgeq_f32(vmlaq_f32(vdupq_n_f32(e1), vdupq_n_f32(ea[1]), px), zero);
+			uint32x4_t in2 = vcgeq_f32(vmlaq_f32(vdupq_n_f32(e2), vdupq_n_f32(ea[2]), px), zero);
+			uint32x4_t inside = vandq_u32(in0, vandq_u32(in1, in2));
+			float32x4_t w = vmlaq_f32(vdupq_n_f32(wy), vdupq_n_f32(dwdx), px);
+			w = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(w), inside));
+			vst1q_f32(&row[x], vmaxq_f32(vld1q_f32(&row[x]), w));
+		}
+#else
+		for(int32 x = minX; x <= maxX; x++){
+			float px = (float)x;
+			if(ea[0]*px + e0 >= 0.0f && ea[1]*px + e1 >= 0.0f && ea[2]*px + e2 >= 0.0f)
+				row[x] = Max(row[x], dwdx*px + wy);
+		}
+#endif
+	}
+}
+
+bool
+COcclusion::IsSphereOccluded(const CVector &centre, float radius)
+{
+	if(!ms_bBufferValid)
+		return false;
+
+	CVector c = TheCamera.GetCameraMatrix() * centre;
+	float nearY = c.y - radius;
+	float farY = c.y + radius;
+	if(nearY < CDraw::GetNearClipZ())
+		return false;
+
+	// screen rectangle of the box around the sphere
+	float minX = Min((c.x - radius)/nearY, (c.x - radius)/farY);
+	float maxX = Max((c.x + radius)/nearY, (c.x + radius)/farY);
+	float minZ = Min((c.z - radius)/nearY, (c.z - radius)/farY);
+	float maxZ = Max((c.z + radius)/nearY, (c.z + radius)/farY);
+	int32 x0 = Max((int32)Floor(OCCLUSION_BUFFER_WIDTH*0.5f + minX*ms_fScaleX), 0);
+	int32 x1 = Min((int32)Floor(OCCLUSION_BUFFER_WIDTH*0.5f + maxX*ms_fScaleX), OCCLUSION_BUFFER_WIDTH - 1);
+	int32 y0 = Max((int32)Floor(OCCLUSION_BUFFER_HEIGHT*0.5f - maxZ*ms_fScaleY), 0);
+	int32 y1 = Min((int32)Floor(OCCLUSION_BUFFER_HEIGHT*0.5f - minZ*ms_fScaleY), OCCLUSION_BUFFER_HEIGHT - 1);
+	if(x0 > x1 || y0 > y1)
+		return false;	// off screen, let the frustum test deal with it
+
+	// occluded if something is in front of the nearest point everywhere
+	float w = 1.0f/nearY;
+	for(int32 y = y0; y <= y1; y++)
+		for(int32 x = x0; x <= x1; x++)
+			if(ms_aDepth[y][x] <= w)
+				return false;
+	return true;
+}
+
+bool
+COcclusion::IsEntityOccluded(CEntity *ent)
+{
+	if(!ms_bBufferValid)
+		return false;
+	if(!IsSphereOccluded(ent->GetBoundCentre(), ent->GetBoundRadius()))
+		return false;
+	ms_nNumOccluded++;
+	return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+// Not original.
+// Software occlusion culling. Every frame the collision of the biggest
+// buildings in front of the camera is rasterized into a small depth buffer,
+// and entities whose bounding sphere is behind it everywhere aren't drawn.
+// CCullZones only knows what can be seen from a zone, this works for any view.
+
+#define OCCLUSION_BUFFER_WIDTH (128)	// multiple of 4
+#define OCCLUSION_BUFFER_HEIGHT (72)
+#define OCCLUSION_MAX_OCCLUDERS (32)
+#define OCCLUSION_MAX_TRIANGLES (8192)	// rasterized per frame
+#define OCCLUDER_MIN_RADIUS (15.0f)
+#define OCCLUDER_MAX_DIST (150.0f)
+
+class CEntity;
+
+struct COccluderVertex
+{
+	float x, y;	// buffer coordinates
+	float w;	// 1/depth
+};
+
+class COcclusion
+{
+	// 1/depth of the nearest occluder at the far side of the pixel, 0 where none covers it completely
+	static float ms_aDepth[OCCLUSION_BUFFER_HEIGHT][OCCLUSION_BUFFER_WIDTH];
+	static float ms_fScaleX;
+	static float ms_fScaleY;
+	static bool ms_bBufferValid;
+	static CEntity *ms_apOccluders[OCCLUSION_MAX_OCCLUDERS];
+	static float ms_afOccluderScores[OCCLUSION_MAX_OCCLUDERS];
+
+	static bool IsOccluder(CEntity *ent, float dist);
+	static void AddOccluder(CEntity *ent, float score);
+	static void FindOccluders(void);
+	static void RasterizeOccluder(CEntity *ent);
+	static void RasterizeTriangle(const CVector &a, const CVector &b, const CVector &c);
+	static void DrawTriangle(const COccluderVertex &v0, const COccluderVertex &v1, const COccluderVertex &v2);
+public:
+	static bool bEnabled;
+	static int32 ms_nNumOccluders;
+	static int32 ms_nNumTriangles;
+	static int32 ms_nNumOccluded;
+
+	static void ProcessBeforeRendering(void);
+	static bool IsSphereOccluded(const CVector &centre, float radius);
+	static bool IsEntityOccluded(CEntity *ent);
+};
@@ -1039,6 +1039,58 @@ CParticle *CParticle::AddParticle(tParticleType type, CVector const &vecPos, CVe
 	return pParticle;
 }
 
+#ifdef BATCHED_PARTICLE_COLLISION
+// Not original. The vertical lines of all particles of a ZCHECK_STEP system are
+// processed together by ProcessLineOfSightBatch, which walks every sector once
+// for all of them. Particles that didn't get a line are checked on their own.
+static CWorldLosRay aParticleRays[MAX_PARTICLES_ON_SCREEN];
+static CParticle *apRayParticles[MAX_PARTICLES_ON_SCREEN];
+static int16 aParticleRayIndex[MAX_PARTICLES_ON_SCREEN];	// by index in gParticleArray, -1 if none
+
+static void
+BatchParticleVerticalLines(tParticleSystemData *psystem, uint32 flags)
+{
+	int32 numRays = 0;
+
+	for ( CParticle *particle = psystem->m_pParticles; particle != nil; particle = particle->m_pNext )
+	{
+		int32 i = particle - gParticleArray;
+		aParticleRayIndex[i] = -1;
+
+		// these are removed before they get to the check
+		if ( CTimer::GetTimeInMilliseconds() > particle->m_nTimeWhenWillBeDestroyed || particle->m_nAlpha == 0 )
+			continue;
+
+		CVector moveStep = particle->m_vecPosition + ( particle->m_vecVelocity * CTimer::GetTimeStep() );
+		aParticleRays[numRays].Set(particle->m_vecPosition,
+			CVector(particle->m_vecPosition.x, particle->m_vecPosition.y, moveStep.z), flags);
+		apRayParticles[numRays] = particle;
+		aParticleRayIndex[i] = numRays++;
+	}
+
+	if ( numRays != 0 )
+		CWorld::ProcessLineOfSightBatch(aParticleRays, numRays);
+}
+#endif
+
+static bool
+ProcessParticleVerticalLine(CParticle *particle, float z, CColPoint &point, bool bCheckVehicles)
+{
+#ifdef BATCHED_PARTICLE_COLLISION
+	int32 ray = aParticleRayIndex[particle - gParticleArray];
+	if ( ray >= 0 && apRayParticles[ray] == particle )
+	{
+		if ( !aParticleRays[ray].hit )
+			return false;
+		point = aParticleRays[ray].point;
+		return true;
+	}
+#endif
+	CEntity *entity;
+	return CWorld::ProcessVerticalLine(particle->m_vecPosition, z, point, entity,
+										true, bCheckVehicles, false, false, true, false, nil);
+}
+
 void CParticle::Update()
 {
 	if ( CTimer::GetIsPaused() )
@@ -1064,6 +1116,17 @@ void CParticle::Update()
 		
 		if ( particle == nil )
 			continue;
+
+#ifdef BATCHED_PARTICLE_COLLISION
+		if ( psystem->Flags & ZCHECK_STEP )
+		{
+			// same conditions as the checks below
+			if ( psystem->m_fGravitationalAcceleration > 0.0f && !(psystem->Flags & ZCHECK_FIRST) )
+				BatchParticleVerticalLines(psystem, LOS_BUILDINGS | LOS_VEHICLES | LOS_DUMMIES);
+			else if ( psystem->m_fGravitationalAcceleration == 0.0f )
+				BatchParticleVerticalLines(psystem, LOS_BUILDINGS | LOS_DUMMIES);
+		}
+#endif
 				
 		for ( ; particle != nil; _Next(particle, prevParticle, psystem, bRemoveParticle) )
 		{
@@ -1262,10 +1325,8 @@ void CParticle::Update()
 				else if ( psystem->Flags & ZCHECK_STEP )
 				{
 					CColPoint point;
-					CEntity *entity;
 
-					if ( CWorld::ProcessVerticalLine(particle->m_vecPosition, moveStep.z, point, entity, 
-														true, true, false, false, true, false, nil) )
+					if ( ProcessParticleVerticalLine(particle, moveStep.z, point, true) )
 					{
 						if ( moveStep.z <= point.point.z )
 						{
@@ -1354,10 +1415,8 @@ void CParticle::Update()
 					if ( psystem->Flags & ZCHECK_STEP )
 					{
 						CColPoint point;
-						CEntity *entity;
 			
-						if ( CWorld::ProcessVerticalLine(particle->m_vecPosition, moveStep.z, point, entity,
-														true, false, false, false, true, false, nil) )
+						if ( ProcessParticleVerticalLine(particle, moveStep.z, point, false) )
 						{
 							if ( moveStep.z <= point.point.z )
 							{
@@ -1477,6 +1536,44 @@ void CParticle::Update()
 	}
 }
 
+#ifdef BATCHED_PARTICLE_RENDER
+// Not original. Animated systems switch the raster whenever the frame of the
+// next particle differs, which flushes the sprite buffer. Drawing them grouped
+// by frame (and in list order within a frame) gives one flush per raster.
+#define PARTICLE_SORT_FRAMES (8)	// later frames share the last group
+
+static CParticle *apSortedParticles[MAX_PARTICLES_ON_SCREEN];
+
+static int32
+SortParticlesByFrame(tParticleSystemData *psystem)
+{
+	CParticle *particle;
+	int32 numParticles = 0;
+
+	if ( psystem->m_nFinalAnimationFrame == 0 || psystem->m_ppRaster == nil )
+	{
+		for ( particle = psystem->m_pParticles; particle != nil; particle = particle->m_pNext )
+			apSortedParticles[numParticles++] = particle;
+		return numParticles;
+	}
+
+	int32 start[PARTICLE_SORT_FRAMES];
+	for ( int32 f = 0; f < PARTICLE_SORT_FRAMES; f++ )
+		start[f] = 0;
+	for ( particle = psystem->m_pParticles; particle != nil; particle = particle->m_pNext )
+		start[Min(particle->m_nCurrentFrame, PARTICLE_SORT_FRAMES-1)]++;
+	for ( int32 f = 0; f < PARTICLE_SORT_FRAMES; f++ )
+	{
+		int32 n = start[f];
+		start[f] = numParticles;
+		numParticles += n;
+	}
+	for ( particle = psystem->m_pParticles; particle != nil; particle = particle->m_pNext )
+		apSortedParticles[start[Min(particle->m_nCurrentFrame, PARTICLE_SORT_FRAMES-1)]++] = particle;
+	return numParticles;
+}
+#endif
+
 void CParticle::Render()
 {
 	PUSH_RENDERGROUP("CParticle::Render");
@@ -1494,6 +1591,9 @@ void CParticle::Render()
 	uint32 flags = DRAW_OPAQUE;
 	
 	RwRaster *prevFrame = nil;
+#ifdef BATCHED_PARTICLE_RENDER
+	bool bPrev2D = false;
+#endif
 	
 	for ( int32 i = 0; i < MAX_PARTICLES; i++ )
 	{
@@ -1522,6 +1622,14 @@ void CParticle::Render()
 
 		if ( particle )
 		{
+#ifdef BATCHED_PARTICLE_RENDER
+			// 2D and 3D sprites can't share a flush
+			if ( !!(psystem->Flags & DRAWTOP2D) != bPrev2D )
+			{
+				CSprite::FlushSpriteBuffer();
+				bPrev2D = !!(psystem->Flags & DRAWTOP2D);
+			}
+#endif
 			if ( (flags & DRAW_OPAQUE) != (psystem->Flags & DRAW_OPAQUE)
 				|| (flags & DRAW_DARK) != (psystem->Flags & DRAW_DARK) )
 			{
@@ -1557,8 +1665,15 @@ void CParticle::Render()
 			}
 		}
 		
+#ifdef BATCHED_PARTICLE_RENDER
+		int32 numParticles = SortParticlesByFrame(psystem);
+		for ( int32 n = 0; n < numParticles; n++ )
+		{
+			particle = apSortedParticles[n];
+#else
 		while ( particle != nil )
 		{
+#endif
 			bool canDraw = true;
 #ifdef PC_PARTICLE
 
@@ -1786,12 +1901,20 @@ void CParticle::Render()
 				}
 			}
 			
+#ifndef BATCHED_PARTICLE_RENDER
 			particle = particle->m_pNext;
+#endif
 		}
 
+#ifndef BATCHED_PARTICLE_RENDER
 		CSprite::FlushSpriteBuffer();
+#endif
 
 	}
+
+#ifdef BATCHED_PARTICLE_RENDER
+	CSprite::FlushSpriteBuffer();
+#endif
 	
 	RwRenderStateSet(rwRENDERSTATEVERTEXALPHAENABLE, (void *)FALSE);
 	RwRenderStateSet(rwRENDERSTATEZWRITEENABLE, (void *)TRUE);
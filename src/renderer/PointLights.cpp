@@ -13,10 +13,81 @@
 int16 CPointLights::NumLights;
 CRegisteredPointLight CPointLights::aLights[NUMPOINTLIGHTS];
 
+#ifdef CLUSTERED_POINTLIGHTS
+// Not original. A grid around the camera that has for every cell a mask
+// of the lights whose box overlaps it, rebuilt whenever lights were added.
+// Lights only exist close to the camera, so the grid stays small.
+#define LIGHTGRID_SIZE_XY (16)
+#define LIGHTGRID_SIZE_Z (4)
+#define LIGHTGRID_WORDS ((NUMPOINTLIGHTS+31)/32)
+
+static uint32 aLightGrid[LIGHTGRID_SIZE_Z][LIGHTGRID_SIZE_XY][LIGHTGRID_SIZE_XY][LIGHTGRID_WORDS];
+static CVector LightGridMin;
+static CVector LightGridRecipCellSize;
+static bool bLightGridDirty;
+static bool bLightGridEmpty;
+
+void
+CPointLights::BuildLightGrid(void)
+{
+	int i;
+	CVector bmin, bmax;
+
+	bLightGridDirty = false;
+	bLightGridEmpty = true;
+	for(i = 0; i < NumLights; i++){
+		if(aLights[i].type == LIGHT_FOGONLY || aLights[i].type == LIGHT_FOGONLY_ALWAYS)
+			continue;
+		CVector r(aLights[i].radius, aLights[i].radius, aLights[i].radius);
+		if(bLightGridEmpty){
+			bmin = aLights[i].coors - r;
+			bmax = aLights[i].coors + r;
+			bLightGridEmpty = false;
+		}else{
+			bmin.x = Min(bmin.x, aLights[i].coors.x - r.x);
+			bmin.y = Min(bmin.y, aLights[i].coors.y - r.y);
+			bmin.z = Min(bmin.z, aLights[i].coors.z - r.z);
+			bmax.x = Max(bmax.x, aLights[i].coors.x + r.x);
+			bmax.y = Max(bmax.y, aLights[i].coors.y + r.y);
+			bmax.z = Max(bmax.z, aLights[i].coors.z + r.z);
+		}
+	}
+	if(bLightGridEmpty)
+		return;
+
+	memset(aLightGrid, 0, sizeof(aLightGrid));
+	LightGridMin = bmin;
+	LightGridRecipCellSize.x = LIGHTGRID_SIZE_XY / Max(bmax.x - bmin.x, 0.01f);
+	LightGridRecipCellSize.y = LIGHTGRID_SIZE_XY / Max(bmax.y - bmin.y, 0.01f);
+	LightGridRecipCellSize.z = LIGHTGRID_SIZE_Z / Max(bmax.z - bmin.z, 0.01f);
+
+	for(i = 0; i < NumLights; i++){
+		if(aLights[i].type == LIGHT_FOGONLY || aLights[i].type == LIGHT_FOGONLY_ALWAYS)
+			continue;
+		float radius = aLights[i].radius;
+		CVector lmin = (aLights[i].coors - CVector(radius, radius, radius) - bmin);
+		CVector lmax = (aLights[i].coors + CVector(radius, radius, radius) - bmin);
+		int x0 = Clamp((int)(lmin.x * LightGridRecipCellSize.x), 0, LIGHTGRID_SIZE_XY-1);
+		int x1 = Clamp((int)(lmax.x * LightGridRecipCellSize.x), 0, LIGHTGRID_SIZE_XY-1);
+		int y0 = Clamp((int)(lmin.y * LightGridRecipCellSize.y), 0, LIGHTGRID_SIZE_XY-1);
+		int y1 = Clamp((int)(lmax.y * LightGridRecipCellSize.y), 0, LIGHTGRID_SIZE_XY-1);
+		int z0 = Clamp((int)(lmin.z * LightGridRecipCellSize.z), 0, LIGHTGRID_SIZE_Z-1);
+		int z1 = Clamp((int)(lmax.z * LightGridRecipCellSize.z), 0, LIGHTGRID_SIZE_Z-1);
+		for(int z = z0; z <= z1; z++)
+			for(int y = y0; y <= y1; y++)
+				for(int x = x0; x <= x1; x++)
+					aLightGrid[z][y][x][i/32] |= 1u << (i%32);
+	}
+}
+#endif
+
 void
 CPointLights::InitPerFrame(void)
 {
 	NumLights = 0;
+#ifdef CLUSTERED_POINTLIGHTS
+	bLightGridDirty = true;
+#endif
 }
 
 #define MAX_DIST 22.0f
@@ -53,6 +124,9 @@ CPointLights::AddLight(uint8 type, CVector coors, CVector dir, float radius, flo
 				aLights[NumLights].blue = blue * fade;
 			}
 			NumLights++;
+#ifdef CLUSTERED_POINTLIGHTS
+			bLightGridDirty = true;
+#endif
 		}
 	}
 }
@@ -66,9 +140,35 @@ CPointLights::GenerateLightsAffectingObject(Const CVector *objCoors)
 	float radius, distance;
 
 	ret = 1.0f;
+#ifdef CLUSTERED_POINTLIGHTS
+	if(bLightGridDirty)
+		BuildLightGrid();
+	if(bLightGridEmpty)
+		return ret;
+
+	// the grid covers all light boxes, outside of it there is no light
+	CVector cell = *objCoors - LightGridMin;
+	int cx = (int)Floor(cell.x * LightGridRecipCellSize.x);
+	int cy = (int)Floor(cell.y * LightGridRecipCellSize.y);
+	int cz = (int)Floor(cell.z * LightGridRecipCellSize.z);
+	if(cx < 0 || cx >= LIGHTGRID_SIZE_XY || cy < 0 || cy >= LIGHTGRID_SIZE_XY || cz < 0 || cz >= LIGHTGRID_SIZE_Z)
+		return ret;
+	const uint32 *mask = aLightGrid[cz][cy][cx];
+
+	// in ascending order like before, the extra directionals are limited
+	for(i = 0; i < NumLights; i++){
+		uint32 bits = mask[i/32] >> (i%32);
+		if(bits == 0){
+			i |= 31;	// none left in this word
+			continue;
+		}
+		if((bits & 1) == 0)
+			continue;
+#else
 	for(i = 0; i < NumLights; i++){
 		if(aLights[i].type == LIGHT_FOGONLY || aLights[i].type == LIGHT_FOGONLY_ALWAYS)
 			continue;
+#endif
 
 		// same weird distance calculation. simplified here
 		dist = aLights[i].coors - *objCoors;
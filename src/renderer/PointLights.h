@@ -17,6 +17,9 @@ VALIDATE_SIZE(CRegisteredPointLight, 0x2C);
 
 class CPointLights
 {
+#ifdef CLUSTERED_POINTLIGHTS
+	static void BuildLightGrid(void);
+#endif
 public:
 	static int16 NumLights;
 	static CRegisteredPointLight aLights[NUMPOINTLIGHTS];
@@ -1,12 +1,31 @@
 #include "common.h"
 
 #include "RenderBuffer.h"
+#include "Debug.h"
 
 int32 TempBufferVerticesStored;
 int32 TempBufferIndicesStored;
 
+#ifdef GROWABLE_RENDERBUFFER
+static RwIm3DVertex aInitialRenderVertices[TEMPBUFFERVERTSIZE];
+static RwImVertexIndex aInitialRenderIndexList[TEMPBUFFERINDEXSIZE];
+
+RwIm3DVertex *TempBufferRenderVertices = aInitialRenderVertices;
+RwImVertexIndex *TempBufferRenderIndexList = aInitialRenderIndexList;
+
+static int VertexCapacity = TEMPBUFFERVERTSIZE;
+static int IndexCapacity = TEMPBUFFERINDEXSIZE;
+static int32 NumUploads;
+static int32 NumBytesUploaded;
+static int32 NumUploadsLastFrame;
+static int32 NumBytesUploadedLastFrame;
+static int32 NumGrows;
+
+bool RenderBuffer::bShowStats;
+#else
 RwIm3DVertex TempBufferRenderVertices[TEMPBUFFERVERTSIZE];
 RwImVertexIndex TempBufferRenderIndexList[TEMPBUFFERINDEXSIZE];
+#endif
 
 int RenderBuffer::VerticesToBeStored;
 int RenderBuffer::IndicesToBeStored;
@@ -21,10 +40,15 @@ RenderBuffer::ClearRenderBuffer(void)
 void
 RenderBuffer::StartStoring(int numIndices, int numVertices, RwImVertexIndex **indexStart, RwIm3DVertex **vertexStart)
 {
+#ifdef GROWABLE_RENDERBUFFER
+	if(!Reserve(numIndices, numVertices))
+		RenderStuffInBuffer();
+#else
 	if(TempBufferIndicesStored + numIndices >= TEMPBUFFERINDEXSIZE)
 		RenderStuffInBuffer();
 	if(TempBufferVerticesStored + numVertices >= TEMPBUFFERVERTSIZE)
 		RenderStuffInBuffer();
+#endif
         *indexStart = &TempBufferRenderIndexList[TempBufferIndicesStored];
         *vertexStart = &TempBufferRenderVertices[TempBufferVerticesStored];
         IndicesToBeStored = numIndices;
@@ -44,9 +68,90 @@ RenderBuffer::StopStoring(void)
 void
 RenderBuffer::RenderStuffInBuffer(void)
 {
-	if(TempBufferVerticesStored && RwIm3DTransform(TempBufferRenderVertices, TempBufferVerticesStored, nil, rwIM3D_VERTEXUV)){
-		RwIm3DRenderIndexedPrimitive(rwPRIMTYPETRILIST, TempBufferRenderIndexList, TempBufferIndicesStored);
+	if(TempBufferVerticesStored)
+		RenderIndexed(TempBufferRenderVertices, TempBufferVerticesStored, TempBufferRenderIndexList, TempBufferIndicesStored);
+	ClearRenderBuffer();
+}
+
+// Not original. Everything that draws out of the buffers goes through here so it's counted.
+void
+RenderBuffer::RenderIndexed(RwIm3DVertex *vertices, int numVertices, RwImVertexIndex *indices, int numIndices)
+{
+	if(RwIm3DTransform(vertices, numVertices, nil, rwIM3D_VERTEXUV)){
+		RwIm3DRenderIndexedPrimitive(rwPRIMTYPETRILIST, indices, numIndices);
 		RwIm3DEnd();
 	}
-	ClearRenderBuffer();
+#ifdef GROWABLE_RENDERBUFFER
+	NumUploads++;
+	NumBytesUploaded += numVertices*sizeof(RwIm3DVertex) + numIndices*sizeof(RwImVertexIndex);
+#endif
+}
+
+// Not original.
+// Makes room for numIndices and numVertices more after what is stored,
+// returns false if the caller has to flush first.
+bool
+RenderBuffer::Reserve(int numIndices, int numVertices)
+{
+#ifdef GROWABLE_RENDERBUFFER
+	int neededIndices = TempBufferIndicesStored + numIndices;
+	int neededVertices = TempBufferVerticesStored + numVertices;
+	if(neededIndices < IndexCapacity && neededVertices < VertexCapacity)
+		return true;
+	if(neededIndices >= MAXTEMPBUFFERINDEXSIZE || neededVertices >= MAXTEMPBUFFERVERTSIZE)
+		return false;
+
+	if(neededVertices >= VertexCapacity){
+		int capacity = VertexCapacity;
+		while(capacity <= neededVertices)
+			capacity *= 2;
+		capacity = Min(capacity, MAXTEMPBUFFERVERTSIZE);
+		// copy all of it, CGlass keeps vertices at fixed offsets
+		RwIm3DVertex *vertices = new RwIm3DVertex[capacity];
+		memcpy(vertices, TempBufferRenderVertices, VertexCapacity*sizeof(RwIm3DVertex));
+		if(TempBufferRenderVertices != aInitialRenderVertices)
+			delete[] TempBufferRenderVertices;
+		TempBufferRenderVertices = vertices;
+		VertexCapacity = capacity;
+		NumGrows++;
+	}
+	if(neededIndices >= IndexCapacity){
+		int capacity = IndexCapacity;
+		while(capacity <= neededIndices)
+			capacity *= 2;
+		capacity = Min(capacity, MAXTEMPBUFFERINDEXSIZE);
+		RwImVertexIndex *indices = new RwImVertexIndex[capacity];
+		memcpy(indices, TempBufferRenderIndexList, IndexCapacity*sizeof(RwImVertexIndex));
+		if(TempBufferRenderIndexList != aInitialRenderIndexList)
+			delete[] TempBufferRenderIndexList;
+		TempBufferRenderIndexList = indices;
+		IndexCapacity = capacity;
+		NumGrows++;
+	}
+	return true;
+#else
+	return TempBufferIndicesStored + numIndices < TEMPBUFFERINDEXSIZE &&
+		TempBufferVerticesStored + numVertices < TEMPBUFFERVERTSIZE;
+#endif
+}
+
+// Not original. Called once at the start of every frame that's rendered.
+void
+RenderBuffer::NewFrame(void)
+{
+#ifdef GROWABLE_RENDERBUFFER
+	NumUploadsLastFrame = NumUploads;
+	NumBytesUploadedLastFrame = NumBytesUploaded;
+	NumUploads = 0;
+	NumBytesUploaded = 0;
+
+#ifndef MASTER
+	if(bShowStats){
+		char str[128];
+		sprintf(str, "RenderBuffer: %d uploads %d bytes, %d verts %d indices allocated, grown %d times",
+			NumUploadsLastFrame, NumBytesUploadedLastFrame, VertexCapacity, IndexCapacity, NumGrows);
+		CDebug::PrintAt(str, 10, 15);
+	}
+#endif
+#endif
 }
@@ -3,16 +3,37 @@ class RenderBuffer
 public:
 	static int VerticesToBeStored;
 	static int IndicesToBeStored;
+#ifdef GROWABLE_RENDERBUFFER
+	static bool bShowStats;
+#endif
 	static void ClearRenderBuffer(void);
 	static void StartStoring(int numIndices, int numVertices, RwImVertexIndex **indexStart, RwIm3DVertex **vertexStart);
 	static void StopStoring(void);
 	static void RenderStuffInBuffer(void);
+	static void RenderIndexed(RwIm3DVertex *vertices, int numVertices, RwImVertexIndex *indices, int numIndices);
+	static bool Reserve(int numIndices, int numVertices);
+	static void NewFrame(void);
 };
 
 #define TEMPBUFFERVERTSIZE 256
 #define TEMPBUFFERINDEXSIZE 1024
 
+#ifdef GROWABLE_RENDERBUFFER
+// Not original.
+// The buffers start out with the sizes above and grow when something is stored
+// that doesn't fit, so users only flush when they want to draw, not because
+// the buffer is full. 16 bit indices can't address more than MAXTEMPBUFFERVERTSIZE.
+// Code that fills them directly can count on the original sizes.
+#define MAXTEMPBUFFERVERTSIZE 65536
+#define MAXTEMPBUFFERINDEXSIZE (MAXTEMPBUFFERVERTSIZE*4)
+
+extern int32 TempBufferVerticesStored;
+extern int32 TempBufferIndicesStored;
+extern RwIm3DVertex *TempBufferRenderVertices;
+extern RwImVertexIndex *TempBufferRenderIndexList;
+#else
 extern int32 TempBufferVerticesStored;
 extern int32 TempBufferIndicesStored;
 extern RwIm3DVertex TempBufferRenderVertices[TEMPBUFFERVERTSIZE];
-extern RwImVertexIndex TempBufferRenderIndexList[TEMPBUFFERINDEXSIZE];
\ No newline at end of file
+extern RwImVertexIndex TempBufferRenderIndexList[TEMPBUFFERINDEXSIZE];
+#endif
@@ -26,6 +26,9 @@
 #include "Frontend.h"
 #include "custompipes.h"
 #include "Debug.h"
+#include "WorkerThreads.h"
+#include "Occlusion.h"
+#include "Impostors.h"
 
 bool gbShowPedRoadGroups;
 bool gbShowCarRoadGroups;
@@ -33,6 +36,11 @@ bool gbShowCollisionPolys;
 bool gbShowCollisionLines;
 bool gbShowCullZoneDebugStuff;
 bool gbDisableZoneCull;	// not original
+bool gbBatchFrustumCull = true;	// not original
+#ifdef NEW_RENDERER
+bool gbInstancedWorld = true;	// not original
+bool gbStateSortWorld = true;	// not original
+#endif
 bool gbBigWhiteDebugLightSwitchedOn;
 
 bool gbDontRenderBuildings;
@@ -41,6 +49,23 @@ bool gbDontRenderPeds;
 bool gbDontRenderObjects;
 bool gbDontRenderVehicles;
 
+#ifdef MULTITHREADED_RENDERLIST
+#define SCAN_CHUNKS_PER_THREAD (4)
+
+struct ScanChunk
+{
+	CWorldQuery query;
+	std::vector<CScannedEntity> entities;
+	int32 firstSector;
+	int32 numSectors;
+};
+
+bool gbMultithreadedRenderList = true;
+static std::vector<CSectorEntityArray*> gScanSectors;
+static ScanChunk gaScanChunks[(MAX_WORKER_THREADS+1) * SCAN_CHUNKS_PER_THREAD];
+static CWorldQuery gScanQuery;	// everything ScanWorld has seen this frame
+#endif
+
 int32 EntitiesRendered;
 int32 EntitiesNotRendered;
 int32 RenderedBigBuildings;
@@ -69,7 +94,7 @@ struct EntityInfo
 CLinkList<EntityInfo> gSortedVehiclesAndPeds;
 
 int32 CRenderer::ms_nNoOfVisibleEntities;
-std::vector<CEntity*> CRenderer::ms_tempVisibleEntities;
+std::vector<CScannedEntity> CRenderer::ms_tempVisibleEntities;
 CEntity *CRenderer::ms_aVisibleEntityPtrs[NUMVISIBLEENTITIES];
 CEntity *CRenderer::ms_aInVisibleEntityPtrs[NUMINVISIBLEENTITIES];
 int32 CRenderer::ms_nNoOfInVisibleEntities;
@@ -79,7 +104,7 @@ CEntity *CRenderer::ms_aVisibleVehiclePtrs[NUMVISIBLEENTITIES];
 int32 CRenderer::ms_nNoOfVisibleBuildings;
 CEntity *CRenderer::ms_aVisibleBuildingPtrs[NUMVISIBLEENTITIES];
 
-CLinkList<EntityInfo> gSortedBuildings;
+CSortedList<EntityInfo> gSortedBuildings;
 #endif
 
 CVector CRenderer::ms_vecCameraPosition;
@@ -100,6 +125,9 @@ CRenderer::Init(void)
 #ifdef NEW_RENDERER
 	gSortedBuildings.Init(NUMVISIBLEENTITIES);
 #endif
+#ifdef BUILDING_IMPOSTORS
+	CImpostors::Init();
+#endif
 }
 
 void
@@ -109,13 +137,15 @@ CRenderer::Shutdown(void)
 #ifdef NEW_RENDERER
 	gSortedBuildings.Shutdown();
 #endif
+#ifdef BUILDING_IMPOSTORS
+	CImpostors::Shutdown();
+#endif
 }
 
 void
 CRenderer::PreRender(void)
 {
 	int i;
-	CLink<CVisibilityPlugins::AlphaObjectInfo> *node;
 
 	for(i = 0; i < ms_nNoOfVisibleEntities; i++)
 		ms_aVisibleEntityPtrs[i]->PreRender();
@@ -127,14 +157,10 @@ CRenderer::PreRender(void)
 		// How is this done with cWorldStream?
 		//for(i = 0; i < ms_nNoOfVisibleBuildings; i++)
 		//	ms_aVisibleBuildingPtrs[i]->PreRender();
-		for(CLink<EntityInfo> *node = gSortedBuildings.head.next;
-		    node != &gSortedBuildings.tail;
-		    node = node->next)
-			((CEntity*)node->item.ent)->PreRender();
-		for(node = CVisibilityPlugins::m_alphaBuildingList.head.next;
-		    node != &CVisibilityPlugins::m_alphaBuildingList.tail;
-		    node = node->next)
-			((CEntity*)node->item.entity)->PreRender();
+		for(i = 0; i < gSortedBuildings.GetNumItems(); i++)
+			gSortedBuildings[i].ent->PreRender();
+		for(i = 0; i < CVisibilityPlugins::m_alphaBuildingList.GetNumItems(); i++)
+			CVisibilityPlugins::m_alphaBuildingList[i].entity->PreRender();
 	}
 #endif
 
@@ -145,13 +171,14 @@ CRenderer::PreRender(void)
 		ms_aInVisibleEntityPtrs[i]->PreRender();
 	}
 
-	for(node = CVisibilityPlugins::m_alphaEntityList.head.next;
-	    node != &CVisibilityPlugins::m_alphaEntityList.tail;
-	    node = node->next)
-		((CEntity*)node->item.entity)->PreRender();
+	for(i = 0; i < CVisibilityPlugins::m_alphaEntityList.GetNumItems(); i++)
+		CVisibilityPlugins::m_alphaEntityList[i].entity->PreRender();
 
 	CHeli::SpecialHeliPreRender();
 	CShadows::RenderExtraPlayerShadows();
+#ifdef BUILDING_IMPOSTORS
+	CImpostors::Update();
+#endif
 }
 
 void
@@ -502,13 +529,15 @@ CRenderer::RenderWorld(int pass)
 {
 	int i;
 	CEntity *e;
-	CLink<CVisibilityPlugins::AlphaObjectInfo> *node;
 
 	RwRenderStateSet(rwRENDERSTATEFOGENABLE, (void*)TRUE);
 	BACKFACE_CULLING_ON;
 	DeActivateDirectional();
 	SetAmbientColours();
 
+	gSortedBuildings.Sort();
+	CVisibilityPlugins::m_alphaBuildingList.Sort();
+
 	// Temporary...have to figure out sorting better
 	switch(pass){
 	case 0:
@@ -522,20 +551,17 @@ CRenderer::RenderWorld(int pass)
 				RenderOneBuilding(e);
 		}
 */
-		for(CLink<EntityInfo> *node = gSortedBuildings.tail.prev;
-		    node != &gSortedBuildings.head;
-		    node = node->prev){
-			e = node->item.ent;
+		for(i = gSortedBuildings.GetNumItems()-1; i >= 0; i--){
+			e = gSortedBuildings[i].ent;
 			if(e->bIsBIGBuilding || IsRoad(e))
 				RenderOneBuilding(e);
 		}
-		for(node = CVisibilityPlugins::m_alphaBuildingList.tail.prev;
-		    node != &CVisibilityPlugins::m_alphaBuildingList.head;
-		    node = node->prev){
-			e = node->item.entity;
+		for(i = CVisibilityPlugins::m_alphaBuildingList.GetNumItems()-1; i >= 0; i--){
+			e = CVisibilityPlugins::m_alphaBuildingList[i].entity;
 			if(e->bIsBIGBuilding || IsRoad(e))
-				RenderOneBuilding(e, node->item.sort);
+				RenderOneBuilding(e, CVisibilityPlugins::m_alphaBuildingList[i].sort);
 		}
+		WorldRender::RenderQueuedAtomics();
 
 		// KLUDGE for road puddles which have to be rendered at road-time
 		// only very temporary, there are more rendering issues
@@ -556,20 +582,17 @@ CRenderer::RenderWorld(int pass)
 				RenderOneBuilding(e);
 		}
 */
-		for(CLink<EntityInfo> *node = gSortedBuildings.tail.prev;
-		    node != &gSortedBuildings.head;
-		    node = node->prev){
-			e = node->item.ent;
+		for(i = gSortedBuildings.GetNumItems()-1; i >= 0; i--){
+			e = gSortedBuildings[i].ent;
 			if(!(e->bIsBIGBuilding || IsRoad(e)))
 				RenderOneBuilding(e);
 		}
-		for(node = CVisibilityPlugins::m_alphaBuildingList.tail.prev;
-		    node != &CVisibilityPlugins::m_alphaBuildingList.head;
-		    node = node->prev){
-			e = node->item.entity;
+		for(i = CVisibilityPlugins::m_alphaBuildingList.GetNumItems()-1; i >= 0; i--){
+			e = CVisibilityPlugins::m_alphaBuildingList[i].entity;
 			if(!(e->bIsBIGBuilding || IsRoad(e)))
-				RenderOneBuilding(e, node->item.sort);
+				RenderOneBuilding(e, CVisibilityPlugins::m_alphaBuildingList[i].sort);
 		}
+		WorldRender::RenderQueuedAtomics();
 		// Now we have iterated through all visible buildings (unsorted and sorted)
 		// and the transparency list is done.
 
@@ -681,6 +704,7 @@ CRenderer::ClearForFrame(void)
 	WorldRender::numBlendInsts[PASS_NOZ] = 0;
 	WorldRender::numBlendInsts[PASS_ADD] = 0;
 	WorldRender::numBlendInsts[PASS_BLEND] = 0;
+	WorldRender::ResetStats();
 }
 #endif
 
@@ -735,8 +759,15 @@ enum Visbility
 #define OTHERUNAVAILABLE (other != -1 && CModelInfo::GetModelInfo(other)->GetRwObject() == nil)
 #define CANTIMECULL (!OTHERUNAVAILABLE)
 
+// the sector scan may have done the frustum test already
+#ifdef OCCLUSION_CULLING
+#define ISONSCREEN ((onScreen < 0 ? ent->GetIsOnScreen() : onScreen != 0) && !COcclusion::IsEntityOccluded(ent))
+#else
+#define ISONSCREEN (onScreen < 0 ? ent->GetIsOnScreen() : onScreen != 0)
+#endif
+
 int32
-CRenderer::SetupEntityVisibility(CEntity *ent)
+CRenderer::SetupEntityVisibility(CEntity *ent, int32 onScreen)
 {
 	ZoneScoped;
 
@@ -752,7 +783,7 @@ CRenderer::SetupEntityVisibility(CEntity *ent)
 			return VIS_OFFSCREEN;
 		}
 
-		if(!ent->GetIsOnScreen())
+		if(!ISONSCREEN)
 			return VIS_OFFSCREEN;
 		if(ent->bDrawLast) {
 			const float dist = (ent->GetPosition() - ms_vecCameraPosition).Magnitude();
@@ -767,7 +798,7 @@ CRenderer::SetupEntityVisibility(CEntity *ent)
 	if(ent->IsObject() && static_cast<CObject*>(ent)->ObjectCreatedBy == TEMP_OBJECT) {
 		if (ent->m_rwObject == nil || !ent->bIsVisible)
 			return VIS_INVISIBLE;
-		return ent->GetIsOnScreen() ? VIS_VISIBLE : VIS_OFFSCREEN;
+		return ISONSCREEN ? VIS_VISIBLE : VIS_OFFSCREEN;
 	}
 
 	// --- Logic for Time-models ---
@@ -812,7 +843,7 @@ CRenderer::SetupEntityVisibility(CEntity *ent)
 		if(!ent->bIsVisible)
 			return VIS_INVISIBLE;
 
-		if(!ent->GetIsOnScreen()){
+		if(!ISONSCREEN){
 			mi->m_alpha = 255;
 			return VIS_OFFSCREEN;
 		}
@@ -855,7 +886,7 @@ CRenderer::SetupEntityVisibility(CEntity *ent)
 	if(!ent->bIsVisible)
 		return VIS_INVISIBLE;
 
-	if(!ent->GetIsOnScreen()){
+	if(!ISONSCREEN){
 		mi->m_alpha = 255;
 		return VIS_OFFSCREEN;
 	}else{
@@ -917,11 +948,19 @@ CRenderer::SetupBigBuildingVisibility(CEntity *ent)
 			RpAtomicSetGeometry(rwobj, RpAtomicGetGeometry(a), rpATOMICSAMEBOUNDINGSPHERE); // originally 5 (mistake?)
 		if (!ent->IsVisible() || !ent->GetIsOnScreenComplex())
 			return VIS_INVISIBLE;
+#ifdef OCCLUSION_CULLING
+		if (COcclusion::IsEntityOccluded(ent))
+			return VIS_INVISIBLE;
+#endif
 		if(mi->m_drawLast){
 			CVisibilityPlugins::InsertEntityIntoSortedList(ent, dist);
 			ent->bDistanceFade = false;
 			return VIS_INVISIBLE;
 		}
+#ifdef BUILDING_IMPOSTORS
+		if(CImpostors::AddImpostor(ent, a, dist))
+			return VIS_INVISIBLE;
+#endif
 		return VIS_VISIBLE;
 	}
 
@@ -976,6 +1015,9 @@ CRenderer::ConstructRenderList(void)
 	TestCloseThings = 0;
 	TestBigThings = 0;
 
+#ifdef OCCLUSION_CULLING
+	COcclusion::ProcessBeforeRendering();
+#endif
 	ScanWorld();
 }
 
@@ -1048,6 +1090,9 @@ CRenderer::ScanWorld(void)
 	m_pFirstPersonVehicle = nil;
 	CVisibilityPlugins::InitAlphaEntityList();
 	CWorld::AdvanceCurrentScanCode();
+#ifdef MULTITHREADED_RENDERLIST
+	gScanQuery.Begin();
+#endif
 
 	if(cammatrix->at.z > 0.0f){
 		// looking up, bottom corners are further away
@@ -1090,9 +1135,17 @@ CRenderer::ScanWorld(void)
 		if(y1 < 0) y1 = 0;
 		y2 = CWorld::GetSectorIndexY(rect.bottom);
 		if(y2 >= NUMSECTORS_Y-1) y2 = NUMSECTORS_Y-1;
+#ifdef MULTITHREADED_RENDERLIST
+		if(gbMultithreadedRenderList){
+			for(; x1 <= x2; x1++)
+				for(int y = y1; y <= y2; y++)
+					CollectSector(CWorld::GetSector(x1, y)->m_arrays);
+			ScanCollectedSectors(ProcessScannedEntities);
+		}else
+#endif
 		for(; x1 <= x2; x1++)
 			for(int y = y1; y <= y2; y++)
-				ScanSectorList(CWorld::GetSector(x1, y)->m_lists);
+				ScanSectorList(CWorld::GetSector(x1, y)->m_arrays);
 	}else{
 		CVehicle *train = FindPlayerTrain();
 		if(train && train->GetPosition().z < 0.0f){
@@ -1102,7 +1155,7 @@ CRenderer::ScanWorld(void)
 			poly[1].y = CWorld::GetSectorY(vectors[CORNER_LOD_LEFT].y);
 			poly[2].x = CWorld::GetSectorX(vectors[CORNER_LOD_RIGHT].x);
 			poly[2].y = CWorld::GetSectorY(vectors[CORNER_LOD_RIGHT].y);
-			ScanSectorPoly(poly, 3, ScanSectorList_Subway);
+			ScanSectorPoly(poly, 3, ScanSectorList_Subway, ProcessScannedEntities_Subway);
 		}else{
 			if(f > LOD_DISTANCE){
 				// priority
@@ -1112,7 +1165,7 @@ CRenderer::ScanWorld(void)
 				poly[1].y = CWorld::GetSectorY(vectors[CORNER_PRIO_LEFT].y);
 				poly[2].x = CWorld::GetSectorX(vectors[CORNER_PRIO_RIGHT].x);
 				poly[2].y = CWorld::GetSectorY(vectors[CORNER_PRIO_RIGHT].y);
-				ScanSectorPoly(poly, 3, ScanSectorList_Priority);
+				ScanSectorPoly(poly, 3, ScanSectorList_Priority, ProcessScannedEntities_Priority);
 
 				// below LOD
 				poly[0].x = CWorld::GetSectorX(vectors[CORNER_CAM].x);
@@ -1121,7 +1174,7 @@ CRenderer::ScanWorld(void)
 				poly[1].y = CWorld::GetSectorY(vectors[CORNER_LOD_LEFT].y);
 				poly[2].x = CWorld::GetSectorX(vectors[CORNER_LOD_RIGHT].x);
 				poly[2].y = CWorld::GetSectorY(vectors[CORNER_LOD_RIGHT].y);
-				ScanSectorPoly(poly, 3, ScanSectorList);
+				ScanSectorPoly(poly, 3, ScanSectorList, ProcessScannedEntities);
 			}else{
 				poly[0].x = CWorld::GetSectorX(vectors[CORNER_CAM].x);
 				poly[0].y = CWorld::GetSectorY(vectors[CORNER_CAM].y);
@@ -1129,7 +1182,7 @@ CRenderer::ScanWorld(void)
 				poly[1].y = CWorld::GetSectorY(vectors[CORNER_FAR_TOPLEFT].y);
 				poly[2].x = CWorld::GetSectorX(vectors[CORNER_FAR_TOPRIGHT].x);
 				poly[2].y = CWorld::GetSectorY(vectors[CORNER_FAR_TOPRIGHT].y);
-				ScanSectorPoly(poly, 3, ScanSectorList);
+				ScanSectorPoly(poly, 3, ScanSectorList, ProcessScannedEntities);
 			}
 #ifdef NO_ISLAND_LOADING
 			if (CMenuManager::m_PrefsIslandLoading == CMenuManager::ISLAND_LOADING_HIGH) {
@@ -1158,6 +1211,11 @@ CRenderer::ScanWorld(void)
 		sprintf(gString, "Rendered:BBuild:%d Build:%d Peds:%d Cars:%d Obj:%d Dummies:%d",
 			RenderedBigBuildings, RenderedBuildings, RenderedPeds, RenderedCars, RenderedObjects, RenderedDummies);
 		CDebug::PrintAt(gString, 10, 12);
+#ifdef OCCLUSION_CULLING
+		sprintf(gString, "Occlusion:Occluders:%d Tris:%d Occluded:%d",
+			COcclusion::ms_nNumOccluders, COcclusion::ms_nNumTriangles, COcclusion::ms_nNumOccluded);
+		CDebug::PrintAt(gString, 10, 13);
+#endif
 	}
 #endif
 }
@@ -1231,7 +1289,7 @@ CRenderer::RequestObjectsInFrustum(void)
 		if(y2 >= NUMSECTORS_Y-1) y2 = NUMSECTORS_Y-1;
 		for(; x1 <= x2; x1++)
 			for(int y = y1; y <= y2; y++)
-				ScanSectorList_RequestModels(CWorld::GetSector(x1, y)->m_lists);
+				ScanSectorList_RequestModels(CWorld::GetSector(x1, y)->m_arrays);
 	}else{
 		poly[0].x = CWorld::GetSectorX(vectors[CORNER_CAM].x);
 		poly[0].y = CWorld::GetSectorY(vectors[CORNER_CAM].y);
@@ -1300,7 +1358,7 @@ CalcNewDelta(RwV2d *a, RwV2d *b)
 #endif
 
 void
-CRenderer::ScanSectorPoly(RwV2d *poly, int32 numVertices, void (*scanfunc)(CPtrList *))
+CRenderer::ScanSectorPoly(RwV2d *poly, int32 numVertices, void (*scanfunc)(CSectorEntityArray *))
 {
 	float miny, maxy;
 	int y, yend;
@@ -1365,7 +1423,7 @@ CRenderer::ScanSectorPoly(RwV2d *poly, int32 numVertices, void (*scanfunc)(CPtrL
 		if(y >= 0 && xstart < NUMSECTORS_X)
 			for(x = xstart; x <= xend && x != NUMSECTORS_X; x++)
 				if(x >= 0)
-					scanfunc(CWorld::GetSector(x, y)->m_lists);
+					scanfunc(CWorld::GetSector(x, y)->m_arrays);
 
 		// advance one scan line
 		y++;
@@ -1460,7 +1518,7 @@ CRenderer::InsertEntityIntoList(CEntity *ent)
 		EntityInfo info;
 		info.ent = ent;
 		info.sort = -(ent->GetPosition() - ms_vecCameraPosition).MagnitudeSqr();
-		gSortedBuildings.InsertSorted(info);
+		gSortedBuildings.Insert(info);
 //		ms_aVisibleBuildingPtrs[ms_nNoOfVisibleBuildings++] = ent;
 	}else
 #endif
@@ -1492,203 +1550,269 @@ CRenderer::ScanBigBuildingList(CPtrList &list)
 	}
 }
 
+// Static lists have exact cached bounds, so they're frustum tested
+// SCAN_BATCH_SIZE entries at a time from those.
+#define SCAN_BATCH_SIZE (64)
+
 void
-CRenderer::ScanSectorList(CPtrList *lists)
+CRenderer::GatherSectorEntities(CSectorEntityArray *lists)
 {
 	ZoneScoped;
 
 	const uint32 currentScanCode = CWorld::GetCurrentScanCode();
-	const CVector& camPos = ms_vecCameraPosition;
+	uint8 onScreen[SCAN_BATCH_SIZE];
 
 	ms_tempVisibleEntities.clear();
-	{
-		ZoneScopedN("Gather Entities");
-		for (int i = 0; i < NUMSECTORENTITYLISTS; i++) {
-			for (CPtrNode* node = lists[i].first; node; node = node->next) {
-				CEntity* ent = static_cast<CEntity*>(node->item);
-				if (ent->m_scanCode != currentScanCode) {
-					ent->m_scanCode = currentScanCode;
-					ms_tempVisibleEntities.push_back(ent);
-				}
+	for (int i = 0; i < NUMSECTORENTITYLISTS; i++) {
+		CSectorEntityArray &list = lists[i];
+		bool batch = gbBatchFrustumCull && list.staticBounds;
+		for (int32 j = 0; j < list.numEntries; j++) {
+			if (batch && j % SCAN_BATCH_SIZE == 0)
+				TheCamera.AreSpheresVisible(&list.boundX[j], &list.boundY[j], &list.boundZ[j], &list.boundRadius[j],
+				                            Min(list.numEntries - j, SCAN_BATCH_SIZE), onScreen);
+			CEntity* ent = list.entities[j];
+			if (ent->m_scanCode != currentScanCode) {
+				ent->m_scanCode = currentScanCode;
+				CScannedEntity scanned = { ent, batch ? onScreen[j % SCAN_BATCH_SIZE] : -1 };
+				ms_tempVisibleEntities.push_back(scanned);
 			}
 		}
 	}
+}
+
+void
+CRenderer::ScanSectorList(CSectorEntityArray *lists)
+{
+	GatherSectorEntities(lists);
+	ProcessScannedEntities();
+}
+
+void
+CRenderer::ProcessScannedEntities(void)
+{
+	ZoneScoped;
+
+	const CVector& camPos = ms_vecCameraPosition;
 
 	if (ms_tempVisibleEntities.empty())
 		return;
 
 	TracyPlot("Entities to Process", static_cast<int64_t>(ms_tempVisibleEntities.size()));
 
-	{
-		ZoneScopedN("Process Entities");
-		for (CEntity* ent : ms_tempVisibleEntities) {
-			if (IsEntityCullZoneVisible(ent)) {
-				switch (SetupEntityVisibility(ent)) {
-				case VIS_VISIBLE: InsertEntityIntoList(ent); break;
-				case VIS_INVISIBLE: if (!IsGlass(ent->GetModelIndex())) break; // fallthrough
-				case VIS_OFFSCREEN: {
-					const float dx = camPos.x - ent->GetPosition().x;
-					const float dy = camPos.y - ent->GetPosition().y;
-					if (ms_nNoOfInVisibleEntities < NUMINVISIBLEENTITIES - 1 && dx > -65.0f && dx < 65.0f && dy > -65.0f && dy < 65.0f)
-						ms_aInVisibleEntityPtrs[ms_nNoOfInVisibleEntities++] = ent;
-					break;
-				}
-				case VIS_STREAMME:
-					if (!CStreaming::ms_disableStreaming && (!m_loadingPriority || CStreaming::ms_numModelsRequested < 10))
-						CStreaming::RequestModel(ent->GetModelIndex(), 0);
-					break;
-				}
+	for (const CScannedEntity& scanned : ms_tempVisibleEntities) {
+		CEntity* ent = scanned.ent;
+		if (IsEntityCullZoneVisible(ent)) {
+			switch (SetupEntityVisibility(ent, scanned.onScreen)) {
+			case VIS_VISIBLE: InsertEntityIntoList(ent); break;
+			case VIS_INVISIBLE: if (!IsGlass(ent->GetModelIndex())) break; // fallthrough
+			case VIS_OFFSCREEN: {
+				const float dx = camPos.x - ent->GetPosition().x;
+				const float dy = camPos.y - ent->GetPosition().y;
+				if (ms_nNoOfInVisibleEntities < NUMINVISIBLEENTITIES - 1 && dx > -65.0f && dx < 65.0f && dy > -65.0f && dy < 65.0f)
+					ms_aInVisibleEntityPtrs[ms_nNoOfInVisibleEntities++] = ent;
+				break;
+			}
+			case VIS_STREAMME:
+				if (!CStreaming::ms_disableStreaming && (!m_loadingPriority || CStreaming::ms_numModelsRequested < 10))
+					CStreaming::RequestModel(ent->GetModelIndex(), 0);
+				break;
+			}
 #ifndef MASTER
-				EntitiesRendered++;
-				switch (ent->GetType()) {
-				case ENTITY_TYPE_BUILDING: ent->bIsBIGBuilding ? RenderedBigBuildings++ : RenderedBuildings++; break;
-				case ENTITY_TYPE_VEHICLE:  RenderedCars++; break;
-				case ENTITY_TYPE_PED:      RenderedPeds++; break;
-				case ENTITY_TYPE_OBJECT:   RenderedObjects++; break;
-				case ENTITY_TYPE_DUMMY:    RenderedDummies++; break;
-				}
+			EntitiesRendered++;
+			switch (ent->GetType()) {
+			case ENTITY_TYPE_BUILDING: ent->bIsBIGBuilding ? RenderedBigBuildings++ : RenderedBuildings++; break;
+			case ENTITY_TYPE_VEHICLE:  RenderedCars++; break;
+			case ENTITY_TYPE_PED:      RenderedPeds++; break;
+			case ENTITY_TYPE_OBJECT:   RenderedObjects++; break;
+			case ENTITY_TYPE_DUMMY:    RenderedDummies++; break;
+			}
 #endif
-			}else if(IsRoad(ent) && !CStreaming::ms_disableStreaming){
-				if(SetupEntityVisibility(ent) == VIS_STREAMME && (!m_loadingPriority || CStreaming::ms_numModelsRequested < 10))
-					CStreaming::RequestModel(ent->GetModelIndex(), 0);
-			}else{
+		}else if(IsRoad(ent) && !CStreaming::ms_disableStreaming){
+			if(SetupEntityVisibility(ent, scanned.onScreen) == VIS_STREAMME && (!m_loadingPriority || CStreaming::ms_numModelsRequested < 10))
+				CStreaming::RequestModel(ent->GetModelIndex(), 0);
+		}else{
 #ifndef MASTER
-				EntitiesNotRendered++;
+			EntitiesNotRendered++;
 #endif
-			}
 		}
 	}
 }
 
 void
-CRenderer::ScanSectorList_Priority(CPtrList *lists)
+CRenderer::ScanSectorList_Priority(CSectorEntityArray *lists)
+{
+	GatherSectorEntities(lists);
+	ProcessScannedEntities_Priority();
+}
+
+void
+CRenderer::ProcessScannedEntities_Priority(void)
 {
 	ZoneScoped;
-	const uint32 currentScanCode = CWorld::GetCurrentScanCode();
 	const CVector& camPos = ms_vecCameraPosition;
 
-	ms_tempVisibleEntities.clear();
-	{
-		ZoneScopedN("Priority Gather");
-		for (int i = 0; i < NUMSECTORENTITYLISTS; i++) {
-			for (CPtrNode* node = lists[i].first; node; node = node->next) {
-				CEntity* ent = static_cast<CEntity*>(node->item);
-				if (ent->m_scanCode != currentScanCode) {
-					ent->m_scanCode = currentScanCode;
-					ms_tempVisibleEntities.push_back(ent);
-				}
-			}
-		}
-	}
 	if (ms_tempVisibleEntities.empty()) return;
 	TracyPlot("Priority Entities", static_cast<int64_t>(ms_tempVisibleEntities.size()));
 
-	{
-		ZoneScopedN("Priority Process");
-		for (CEntity* ent : ms_tempVisibleEntities) {
-			if (IsEntityCullZoneVisible(ent)) {
-				switch (SetupEntityVisibility(ent)) {
-				case VIS_VISIBLE: InsertEntityIntoList(ent); break;
-				case VIS_INVISIBLE: if (!IsGlass(ent->GetModelIndex())) break; // fallthrough
-				case VIS_OFFSCREEN: {
-					const float dx = camPos.x - ent->GetPosition().x;
-					const float dy = camPos.y - ent->GetPosition().y;
-					if (ms_nNoOfInVisibleEntities < NUMINVISIBLEENTITIES - 1 && dx > -65.0f && dx < 65.0f && dy > -65.0f && dy < 65.0f)
-						ms_aInVisibleEntityPtrs[ms_nNoOfInVisibleEntities++] = ent;
-					break;
-				}
-				case VIS_STREAMME:
-					if(!CStreaming::ms_disableStreaming){
-						CStreaming::RequestModel(ent->GetModelIndex(), 0);
-						if(CStreaming::ms_aInfoForModel[ent->GetModelIndex()].m_loadState != STREAMSTATE_LOADED)
-							m_loadingPriority = true;
-					}
-					break;
+	for (const CScannedEntity& scanned : ms_tempVisibleEntities) {
+		CEntity* ent = scanned.ent;
+		if (IsEntityCullZoneVisible(ent)) {
+			switch (SetupEntityVisibility(ent, scanned.onScreen)) {
+			case VIS_VISIBLE: InsertEntityIntoList(ent); break;
+			case VIS_INVISIBLE: if (!IsGlass(ent->GetModelIndex())) break; // fallthrough
+			case VIS_OFFSCREEN: {
+				const float dx = camPos.x - ent->GetPosition().x;
+				const float dy = camPos.y - ent->GetPosition().y;
+				if (ms_nNoOfInVisibleEntities < NUMINVISIBLEENTITIES - 1 && dx > -65.0f && dx < 65.0f && dy > -65.0f && dy < 65.0f)
+					ms_aInVisibleEntityPtrs[ms_nNoOfInVisibleEntities++] = ent;
+				break;
+			}
+			case VIS_STREAMME:
+				if(!CStreaming::ms_disableStreaming){
+					CStreaming::RequestModel(ent->GetModelIndex(), 0);
+					if(CStreaming::ms_aInfoForModel[ent->GetModelIndex()].m_loadState != STREAMSTATE_LOADED)
+						m_loadingPriority = true;
 				}
+				break;
+			}
 #ifndef MASTER
-				EntitiesRendered++;
+			EntitiesRendered++;
 #endif
-			}else if(IsRoad(ent) && !CStreaming::ms_disableStreaming){
-				if(SetupEntityVisibility(ent) == VIS_STREAMME)
-					CStreaming::RequestModel(ent->GetModelIndex(), 0);
-			}else{
+		}else if(IsRoad(ent) && !CStreaming::ms_disableStreaming){
+			if(SetupEntityVisibility(ent, scanned.onScreen) == VIS_STREAMME)
+				CStreaming::RequestModel(ent->GetModelIndex(), 0);
+		}else{
 #ifndef MASTER
-				EntitiesNotRendered++;
+			EntitiesNotRendered++;
 #endif
-			}
 		}
 	}
 }
 
 void
-CRenderer::ScanSectorList_Subway(CPtrList *lists)
+CRenderer::ScanSectorList_Subway(CSectorEntityArray *lists)
+{
+	GatherSectorEntities(lists);
+	ProcessScannedEntities_Subway();
+}
+
+void
+CRenderer::ProcessScannedEntities_Subway(void)
 {
 	ZoneScoped;
-	const uint32 currentScanCode = CWorld::GetCurrentScanCode();
 	const CVector& camPos = ms_vecCameraPosition;
 
-	ms_tempVisibleEntities.clear();
-	{
-		ZoneScopedN("Subway Gather");
-		for (int i = 0; i < NUMSECTORENTITYLISTS; i++) {
-			for (CPtrNode* node = lists[i].first; node; node = node->next) {
-				CEntity* ent = static_cast<CEntity*>(node->item);
-				if (ent->m_scanCode != currentScanCode) {
-					ent->m_scanCode = currentScanCode;
-					ms_tempVisibleEntities.push_back(ent);
-				}
-			}
-		}
-	}
 	if (ms_tempVisibleEntities.empty()) return;
 	TracyPlot("Subway Entities", static_cast<int64_t>(ms_tempVisibleEntities.size()));
 
-	{
-		ZoneScopedN("Subway Process");
-		for (CEntity* ent : ms_tempVisibleEntities) {
-			switch(SetupEntityVisibility(ent)){
-			case VIS_VISIBLE: InsertEntityIntoList(ent); break;
-			case VIS_OFFSCREEN:
-				const float dx = camPos.x - ent->GetPosition().x;
-				const float dy = camPos.y - ent->GetPosition().y;
-				if(dx > -65.0f && dx < 65.0f && dy > -65.0f && dy < 65.0f && ms_nNoOfInVisibleEntities < NUMINVISIBLEENTITIES - 1)
-					ms_aInVisibleEntityPtrs[ms_nNoOfInVisibleEntities++] = ent;
-				break;
-			}
+	for (const CScannedEntity& scanned : ms_tempVisibleEntities) {
+		CEntity* ent = scanned.ent;
+		switch(SetupEntityVisibility(ent, scanned.onScreen)){
+		case VIS_VISIBLE: InsertEntityIntoList(ent); break;
+		case VIS_OFFSCREEN:
+			const float dx = camPos.x - ent->GetPosition().x;
+			const float dy = camPos.y - ent->GetPosition().y;
+			if(dx > -65.0f && dx < 65.0f && dy > -65.0f && dy < 65.0f && ms_nNoOfInVisibleEntities < NUMINVISIBLEENTITIES - 1)
+				ms_aInVisibleEntityPtrs[ms_nNoOfInVisibleEntities++] = ent;
+			break;
 		}
 	}
 }
 
 void
-CRenderer::ScanSectorList_RequestModels(CPtrList *lists)
+CRenderer::ScanSectorList_RequestModels(CSectorEntityArray *lists)
 {
 	ZoneScoped;
-	const uint32 currentScanCode = CWorld::GetCurrentScanCode();
 
-	ms_tempVisibleEntities.clear();
-	{
-		ZoneScopedN("RequestModels Gather");
+	GatherSectorEntities(lists);
+	if (ms_tempVisibleEntities.empty()) return;
+	TracyPlot("RequestModels Entities", static_cast<int64_t>(ms_tempVisibleEntities.size()));
+
+	for (const CScannedEntity& scanned : ms_tempVisibleEntities) {
+		CEntity* ent = scanned.ent;
+		if(IsEntityCullZoneVisible(ent))
+			if(ShouldModelBeStreamed(ent))
+				CStreaming::RequestModel(ent->GetModelIndex(), 0);
+	}
+}
+
+#ifdef MULTITHREADED_RENDERLIST
+// The sector scan in parallel: worker threads take a run of sectors each,
+// gather their entities and do the frustum test. Then the main thread merges
+// the runs in sector order, keeping only the first time an entity shows up,
+// and does the rest, which changes models and entities, as before.
+// Entities are deduplicated with CWorldQuery sets since scan codes can't be
+// shared between threads.
+
+static void
+ScanSectorChunk(int32 job, void *data)
+{
+	ScanChunk *chunk = &gaScanChunks[job];
+	uint8 onScreen[SCAN_BATCH_SIZE];
+	chunk->entities.clear();
+	chunk->query.Begin();
+	for(int32 s = chunk->firstSector; s < chunk->firstSector + chunk->numSectors; s++){
+		CSectorEntityArray *lists = gScanSectors[s];
 		for(int i = 0; i < NUMSECTORENTITYLISTS; i++){
-			for (CPtrNode* node = lists[i].first; node; node = node->next) {
-				CEntity* ent = static_cast<CEntity*>(node->item);
-				if (ent->m_scanCode != currentScanCode) {
-					ent->m_scanCode = currentScanCode;
-					ms_tempVisibleEntities.push_back(ent);
+			CSectorEntityArray &list = lists[i];
+			bool batch = gbBatchFrustumCull && list.staticBounds;
+			for(int32 j = 0; j < list.numEntries; j++){
+				if(batch && j % SCAN_BATCH_SIZE == 0)
+					TheCamera.AreSpheresVisible(&list.boundX[j], &list.boundY[j], &list.boundZ[j], &list.boundRadius[j],
+					                            Min(list.numEntries - j, SCAN_BATCH_SIZE), onScreen);
+				CEntity *ent = list.entities[j];
+				if(chunk->query.Visit(ent)){
+					CScannedEntity scanned = { ent, batch ? onScreen[j % SCAN_BATCH_SIZE] : ent->GetIsOnScreen() };
+					chunk->entities.push_back(scanned);
 				}
 			}
 		}
 	}
-	if (ms_tempVisibleEntities.empty()) return;
-	TracyPlot("RequestModels Entities", static_cast<int64_t>(ms_tempVisibleEntities.size()));
+}
 
-	{
-		ZoneScopedN("RequestModels Process");
-		for (CEntity* ent : ms_tempVisibleEntities) {
-			if(IsEntityCullZoneVisible(ent))
-				if(ShouldModelBeStreamed(ent))
-					CStreaming::RequestModel(ent->GetModelIndex(), 0);
-		}
+void
+CRenderer::CollectSector(CSectorEntityArray *lists)
+{
+	gScanSectors.push_back(lists);
+}
+
+void
+CRenderer::ScanCollectedSectors(void (*processfunc)(void))
+{
+	ZoneScoped;
+
+	int32 numSectors = gScanSectors.size();
+	int32 numChunks = Min(numSectors, CWorkerThreads::GetNumThreads() * SCAN_CHUNKS_PER_THREAD);
+	int32 first = 0;
+	for(int32 i = 0; i < numChunks; i++){
+		gaScanChunks[i].firstSector = first;
+		gaScanChunks[i].numSectors = (numSectors - first) / (numChunks - i);
+		first += gaScanChunks[i].numSectors;
 	}
+	CWorkerThreads::Run(ScanSectorChunk, numChunks, nil);
+
+	ms_tempVisibleEntities.clear();
+	for(int32 i = 0; i < numChunks; i++)
+		for(const CScannedEntity &scanned : gaScanChunks[i].entities)
+			if(gScanQuery.Visit(scanned.ent))
+				ms_tempVisibleEntities.push_back(scanned);
+	gScanSectors.clear();
+
+	processfunc();
+}
+#endif
+
+void
+CRenderer::ScanSectorPoly(RwV2d *poly, int32 numVertices, void (*scanfunc)(CSectorEntityArray *), void (*processfunc)(void))
+{
+#ifdef MULTITHREADED_RENDERLIST
+	if(gbMultithreadedRenderList){
+		ScanSectorPoly(poly, numVertices, CollectSector);
+		ScanCollectedSectors(processfunc);
+		return;
+	}
+#endif
+	ScanSectorPoly(poly, numVertices, scanfunc);
 }
 
 // Put big buildings in front
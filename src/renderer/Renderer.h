@@ -25,6 +25,14 @@ extern bool gbShowCollisionPolys;
 extern bool gbShowCollisionLines;
 extern bool gbShowCullZoneDebugStuff;
 extern bool gbDisableZoneCull;	// not original
+extern bool gbBatchFrustumCull;	// not original
+#ifdef MULTITHREADED_RENDERLIST
+extern bool gbMultithreadedRenderList;	// not original
+#endif
+#ifdef NEW_RENDERER
+extern bool gbInstancedWorld;	// not original
+extern bool gbStateSortWorld;	// not original
+#endif
 extern bool gbBigWhiteDebugLightSwitchedOn;
 
 extern bool gbDontRenderBuildings;
@@ -35,6 +43,14 @@ extern bool gbDontRenderVehicles;
 
 class CVehicle;
 class CPtrList;
+class CSectorEntityArray;
+
+// not original, an entity found by the sector scan
+struct CScannedEntity
+{
+	CEntity *ent;
+	int32 onScreen;		// what GetIsOnScreen returned, -1 if not known yet
+};
 
 // unused
 struct BlockedRange
@@ -85,18 +101,27 @@ public:
 	// unused
 	static void RenderBlockBuildingLines(void);
 
-	static int32 SetupEntityVisibility(CEntity *ent);
+	static int32 SetupEntityVisibility(CEntity *ent, int32 onScreen = -1);
 	static int32 SetupBigBuildingVisibility(CEntity *ent);
 
 	static void ConstructRenderList(void);
 	static void ScanWorld(void);
 	static void RequestObjectsInFrustum(void);
-	static void ScanSectorPoly(RwV2d *poly, int32 numVertices, void (*scanfunc)(CPtrList *));
+	static void ScanSectorPoly(RwV2d *poly, int32 numVertices, void (*scanfunc)(CSectorEntityArray *));
+	static void ScanSectorPoly(RwV2d *poly, int32 numVertices, void (*scanfunc)(CSectorEntityArray *), void (*processfunc)(void));
 	static void ScanBigBuildingList(CPtrList &list);
-	static void ScanSectorList(CPtrList *lists);
-	static void ScanSectorList_Priority(CPtrList *lists);
-	static void ScanSectorList_Subway(CPtrList *lists);
-	static void ScanSectorList_RequestModels(CPtrList *lists);
+	static void ScanSectorList(CSectorEntityArray *lists);
+	static void ScanSectorList_Priority(CSectorEntityArray *lists);
+	static void ScanSectorList_Subway(CSectorEntityArray *lists);
+	static void ScanSectorList_RequestModels(CSectorEntityArray *lists);
+	static void GatherSectorEntities(CSectorEntityArray *lists);
+	static void ProcessScannedEntities(void);
+	static void ProcessScannedEntities_Priority(void);
+	static void ProcessScannedEntities_Subway(void);
+#ifdef MULTITHREADED_RENDERLIST
+	static void CollectSector(CSectorEntityArray *lists);
+	static void ScanCollectedSectors(void (*processfunc)(void));
+#endif
 
 	static void SortBIGBuildings(void);
 	static void SortBIGBuildingsForSectorList(CPtrList *list);
@@ -118,5 +143,5 @@ public:
 #endif
 	static void InsertEntityIntoList(CEntity *ent);
 private:
-	static std::vector<CEntity*> ms_tempVisibleEntities;
+	static std::vector<CScannedEntity> ms_tempVisibleEntities;
 };
@@ -129,10 +129,7 @@ CRubbish::Render(void)
 
 		if(TempBufferIndicesStored != 0){
 			LittleTest();
-			if(RwIm3DTransform(TempBufferRenderVertices, TempBufferVerticesStored, nil, rwIM3D_VERTEXUV)){
-				RwIm3DRenderIndexedPrimitive(rwPRIMTYPETRILIST, TempBufferRenderIndexList, TempBufferIndicesStored);
-				RwIm3DEnd();
-			}
+			RenderBuffer::RenderIndexed(TempBufferRenderVertices, TempBufferVerticesStored, TempBufferRenderIndexList, TempBufferIndicesStored);
 		}
 	}
 
@@ -129,6 +129,9 @@ CShadows::Init(void)
 	{
 		aStaticShadows[i].m_nId = 0;
 		aStaticShadows[i].m_pPolyBunch = NULL;
+#ifdef STATIC_SHADOW_CACHE
+		aStaticShadows[i].m_bIncomplete = false;
+#endif
 	}
 
 	pEmptyBunchList = &aPolyBunches[0];
@@ -244,12 +247,24 @@ CShadows::StoreStaticShadow(uint32 nID, uint8 ShadowType, RwTexture *pTexture, C
 		int32 nSlot;
 
 		nSlot = 0;
+#ifdef STATIC_SHADOW_CACHE
+		// a shadow without polys is still a valid result, not a free slot
+		while ( nSlot < MAX_STATICSHADOWS && nID != aStaticShadows[nSlot].m_nId )
+			nSlot++;
+#else
 		while ( nSlot < MAX_STATICSHADOWS && !(nID == aStaticShadows[nSlot].m_nId && aStaticShadows[nSlot].m_pPolyBunch != NULL) )
 			nSlot++;
+#endif
 
 		if ( nSlot < MAX_STATICSHADOWS )
 		{
-			if (   Abs(pPosn->x - aStaticShadows[nSlot].m_vecPosn.x) < fUpDistance
+#ifdef STATIC_SHADOW_CACHE
+			bool bCastAgain = aStaticShadows[nSlot].m_bIncomplete;
+#else
+			bool bCastAgain = false;
+#endif
+			if (   !bCastAgain
+				&& Abs(pPosn->x - aStaticShadows[nSlot].m_vecPosn.x) < fUpDistance
 				&& Abs(pPosn->y - aStaticShadows[nSlot].m_vecPosn.y) < fUpDistance )
 			{
 				aStaticShadows[nSlot].m_bJustCreated     = true;
@@ -264,7 +279,8 @@ CShadows::StoreStaticShadow(uint32 nID, uint8 ShadowType, RwTexture *pTexture, C
 				aStaticShadows[nSlot].m_bTemp            = bTempShadow;
 				aStaticShadows[nSlot].m_nTimeCreated     = CTimer::GetTimeInMilliseconds();
 			}
-            else if (  Abs(pPosn->x - aStaticShadows[nSlot].m_vecPosn.x) < 0.05f
+            else if (  !bCastAgain
+					&& Abs(pPosn->x - aStaticShadows[nSlot].m_vecPosn.x) < 0.05f
 					&& Abs(pPosn->y - aStaticShadows[nSlot].m_vecPosn.y) < 0.05f
 					&& Abs(pPosn->z - aStaticShadows[nSlot].m_vecPosn.z) < 2.0f
 
@@ -313,8 +329,13 @@ CShadows::StoreStaticShadow(uint32 nID, uint8 ShadowType, RwTexture *pTexture, C
 		else
 		{
 			nSlot = 0;
+#ifdef STATIC_SHADOW_CACHE
+			while ( nSlot < MAX_STATICSHADOWS && aStaticShadows[nSlot].m_nId != 0 )
+				nSlot++;
+#else
 			while ( nSlot < MAX_STATICSHADOWS && aStaticShadows[nSlot].m_pPolyBunch != NULL )
 				nSlot++;
+#endif
 
 			if ( nSlot != MAX_STATICSHADOWS )
 			{
@@ -920,6 +941,10 @@ CShadows::GeneratePolysForStaticShadow(int16 nStaticShadowID)
 					&aStaticShadows[nStaticShadowID].m_pPolyBunch);
 		}
 	}
+
+#ifdef STATIC_SHADOW_CACHE
+	aStaticShadows[nStaticShadowID].m_bIncomplete = pEmptyBunchList == NULL;
+#endif
 }
 
 void
@@ -1000,7 +1025,11 @@ CShadows::CastShadowEntity(CEntity *pEntity,  float fStartX, float fStartY, floa
 			pCol->boundingBox.GetSize().y);
 #endif
 	
+#ifdef MULTITHREADED_WORLD_QUERIES
+	CTrianglePlanesPin pin(pCol);
+#else
 	CCollision::CalculateTrianglePlanes(pCol);
+#endif
 
 	float fFrontRight    = DotProduct2D(CVector2D(fFrontX, fFrontY),     pEntity->GetRight());
 	float fFrontForward  = DotProduct2D(CVector2D(fFrontX, fFrontY),     pEntity->GetForward());
@@ -1500,7 +1529,11 @@ CShadows::UpdateStaticShadows(void)
 {
 	for ( int32 i = 0; i < MAX_STATICSHADOWS; i++ )
 	{
+#ifdef STATIC_SHADOW_CACHE
+		if ( aStaticShadows[i].m_nId != 0 && !aStaticShadows[i].m_bJustCreated
+#else
 		if ( aStaticShadows[i].m_pPolyBunch != NULL && !aStaticShadows[i].m_bJustCreated
+#endif
 			&& (!aStaticShadows[i].m_bTemp || CTimer::GetTimeInMilliseconds() > aStaticShadows[i].m_nTimeCreated + 5000) )
 		{
 			aStaticShadows[i].Free();
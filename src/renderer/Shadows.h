@@ -1,8 +1,13 @@
 #pragma once
 
 #define MAX_STOREDSHADOWS    48
+#ifdef STATIC_SHADOW_CACHE
+#define MAX_POLYBUNCHES      1000
+#define MAX_STATICSHADOWS    128	// shadows without polys keep their slot now
+#else
 #define MAX_POLYBUNCHES      300
 #define MAX_STATICSHADOWS    64
+#endif
 #define MAX_PERMAMENTSHADOWS 48
 
 
@@ -86,6 +91,9 @@ public:
 	bool m_bJustCreated;
 	bool m_bRendered;
 	bool m_bTemp;
+#ifdef STATIC_SHADOW_CACHE
+	bool m_bIncomplete;	// ran out of poly bunches, cast again next time
+#endif
 	RwTexture *m_pTexture;
 
 	CStaticShadow() = default;
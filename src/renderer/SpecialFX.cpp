@@ -731,7 +731,11 @@ CBrightLights::Render(void)
 	TempBufferIndicesStored = 0;
 
 	for(i = 0; i < NumBrightLights; i++){
+#ifdef GROWABLE_RENDERBUFFER
+		if(!RenderBuffer::Reserve(40, 40))
+#else
 		if(TempBufferIndicesStored > TEMPBUFFERINDEXSIZE-40 || TempBufferVerticesStored > TEMPBUFFERVERTSIZE-40)
+#endif
 			RenderOutGeometryBuffer();
 
 		int r, g, b, a;
@@ -888,10 +892,7 @@ CBrightLights::RenderOutGeometryBuffer(void)
 {
 	if(TempBufferIndicesStored != 0){
 		LittleTest();
-		if(RwIm3DTransform(TempBufferRenderVertices, TempBufferVerticesStored, nil, rwIM3D_VERTEXUV)){
-			RwIm3DRenderIndexedPrimitive(rwPRIMTYPETRILIST, TempBufferRenderIndexList, TempBufferIndicesStored);
-			RwIm3DEnd();
-		}
+		RenderBuffer::RenderIndexed(TempBufferRenderVertices, TempBufferVerticesStored, TempBufferRenderIndexList, TempBufferIndicesStored);
 		TempBufferVerticesStored = 0;
 		TempBufferIndicesStored = 0;
 	}
@@ -963,7 +964,11 @@ CShinyTexts::Render(void)
 	TempBufferIndicesStored = 0;
 
 	for(i = 0; i < NumShinyTexts; i++){
+#ifdef GROWABLE_RENDERBUFFER
+		if(!RenderBuffer::Reserve(64, 62))
+#else
 		if(TempBufferIndicesStored > TEMPBUFFERINDEXSIZE-64 || TempBufferVerticesStored > TEMPBUFFERVERTSIZE-62)
+#endif
 			RenderOutGeometryBuffer();
 
 		uint8 r = aShinyTexts[i].m_red;
@@ -1030,10 +1035,7 @@ CShinyTexts::RenderOutGeometryBuffer(void)
 {
 	if(TempBufferIndicesStored != 0){
 		LittleTest();
-		if(RwIm3DTransform(TempBufferRenderVertices, TempBufferVerticesStored, nil, rwIM3D_VERTEXUV)){
-			RwIm3DRenderIndexedPrimitive(rwPRIMTYPETRILIST, TempBufferRenderIndexList, TempBufferIndicesStored);
-			RwIm3DEnd();
-		}
+		RenderBuffer::RenderIndexed(TempBufferRenderVertices, TempBufferVerticesStored, TempBufferRenderIndexList, TempBufferIndicesStored);
 		TempBufferVerticesStored = 0;
 		TempBufferIndicesStored = 0;
 	}
@@ -47,7 +47,11 @@ CSprite::CalcScreenCoors(const RwV3d &in, RwV3d *out, float *outw, float *outh,
 	return true;
 }
 
+#ifdef BATCHED_PARTICLE_RENDER
+#define SPRITEBUFFERSIZE 512	// not original, rain and smoke used to flush every 64 sprites
+#else
 #define SPRITEBUFFERSIZE 64
+#endif
 static int32 nSpriteBufferIndex;
 static RwIm2DVertex SpriteBufferVerts[SPRITEBUFFERSIZE*6];
 static RwIm2DVertex verts[4];
@@ -12,7 +12,11 @@ int32 CSprite2d::mCurrentBank;
 RwTexture *CSprite2d::mpBankTextures[10];
 int32 CSprite2d::mCurrentSprite[10];
 int32 CSprite2d::mBankStart[10];
+#ifdef BATCHED_TEXT
+RwIm2DVertex CSprite2d::maBankVertices[6*(256+3*128)];
+#else
 RwIm2DVertex CSprite2d::maBankVertices[500];
+#endif
 
 void
 CSprite2d::SetRecipNearClip(void)
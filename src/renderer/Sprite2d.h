@@ -7,7 +7,11 @@ class CSprite2d
 	static RwTexture *mpBankTextures[10];
 	static int32 mCurrentSprite[10];
 	static int32 mBankStart[10];
+#ifdef BATCHED_TEXT
+	static RwIm2DVertex maBankVertices[6*(256+3*128)];	// see CFont::InitPerFrame
+#else
 	static RwIm2DVertex maBankVertices[500];
+#endif
 	static RwIm2DVertex maVertices[8];
 public:
 	RwTexture *m_pTexture;
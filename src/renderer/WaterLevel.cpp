@@ -48,6 +48,95 @@ bool gbDontRenderWater;
 RwTexture *gpWaterTex;
 RwRaster *gpWaterRaster;
 
+#ifdef STATIC_WATER_GEOMETRY
+// Not original.
+// The flat water doesn't change after it's loaded, so the level of every
+// huge sector and the sea sectors around the map are worked out once,
+// as is the index list of the flat quads. RenderWater only picks the
+// visible sectors and fills in the vertices, all flat quads of a frame
+// go out in one draw unless there are more than MAX_FLAT_WATER_QUADS.
+// Vertices can't be kept between frames, the texture coordinates scroll
+// and the colour follows the timecycle.
+#define MAX_FLAT_WATER_QUADS (512)
+#define MAX_SEA_SECTORS (26*5 + 16*5*2)
+
+enum
+{
+	SEA_SOUTH,	// not drawn if bUseCamStartY
+	SEA_WEST,	// not drawn if bUseCamStartX
+	SEA_EAST,	// not drawn if bUseCamEndX
+};
+
+struct tSeaSector
+{
+	CVector2D corner;
+	int8 side;
+};
+
+static int8 aHugeWaterBlockList[MAX_HUGE_SECTORS][MAX_HUGE_SECTORS];
+static tSeaSector aSeaSectors[MAX_SEA_SECTORS];
+static int32 nNumSeaSectors;
+static RwIm3DVertex aFlatWaterVertices[MAX_FLAT_WATER_QUADS*4];
+static RwImVertexIndex aFlatWaterIndices[MAX_FLAT_WATER_QUADS*6];
+static int32 nNumFlatWaterQuads;
+
+static void
+BuildFlatWaterIndices(void)
+{
+	for ( int32 i = 0; i < MAX_FLAT_WATER_QUADS; i++ )
+	{
+		aFlatWaterIndices[6*i + 0] = 4*i + 0;
+		aFlatWaterIndices[6*i + 1] = 4*i + 2;
+		aFlatWaterIndices[6*i + 2] = 4*i + 1;
+		aFlatWaterIndices[6*i + 3] = 4*i + 0;
+		aFlatWaterIndices[6*i + 4] = 4*i + 3;
+		aFlatWaterIndices[6*i + 5] = 4*i + 2;
+	}
+}
+
+static void
+AddSeaSector(float fX, float fY, int8 side)
+{
+	aSeaSectors[nNumSeaSectors].corner = CVector2D(fX, fY);
+	aSeaSectors[nNumSeaSectors].side = side;
+	nNumSeaSectors++;
+}
+
+// fSize is also the texture repeat in small sectors
+static void
+AddFlatWaterQuad(float fX, float fY, float fZ, float fSize, RwRGBA const &color, uint8 alpha)
+{
+	if ( nNumFlatWaterQuads >= MAX_FLAT_WATER_QUADS )
+		CWaterLevel::RenderAndEmptyRenderBuffer();
+
+	RwIm3DVertex *verts = &aFlatWaterVertices[4*nNumFlatWaterQuads];
+	float fUVSize = fSize / SMALL_SECTOR_SIZE;
+	fZ -= WATER_Z_OFFSET;
+
+	RwIm3DVertexSetPos  (&verts[0], fX, fY, fZ);
+	RwIm3DVertexSetU    (&verts[0], TEXTURE_ADDU);
+	RwIm3DVertexSetV    (&verts[0], TEXTURE_ADDV);
+	RwIm3DVertexSetRGBA (&verts[0], color.red, color.green, color.blue, alpha);
+
+	RwIm3DVertexSetPos  (&verts[1], fX, fY + fSize, fZ);
+	RwIm3DVertexSetU    (&verts[1], TEXTURE_ADDU);
+	RwIm3DVertexSetV    (&verts[1], TEXTURE_ADDV + fUVSize);
+	RwIm3DVertexSetRGBA (&verts[1], color.red, color.green, color.blue, alpha);
+
+	RwIm3DVertexSetPos  (&verts[2], fX + fSize, fY + fSize, fZ);
+	RwIm3DVertexSetU    (&verts[2], TEXTURE_ADDU + fUVSize);
+	RwIm3DVertexSetV    (&verts[2], TEXTURE_ADDV + fUVSize);
+	RwIm3DVertexSetRGBA (&verts[2], color.red, color.green, color.blue, alpha);
+
+	RwIm3DVertexSetPos  (&verts[3], fX + fSize, fY, fZ);
+	RwIm3DVertexSetU    (&verts[3], TEXTURE_ADDU + fUVSize);
+	RwIm3DVertexSetV    (&verts[3], TEXTURE_ADDV);
+	RwIm3DVertexSetRGBA (&verts[3], color.red, color.green, color.blue, alpha);
+
+	nNumFlatWaterQuads++;
+}
+#endif
+
 
 const float fAdd1 = 180.0f;
 const float fAdd2 = 80.0f;
@@ -221,6 +310,10 @@ CWaterLevel::Initialise(Const char *pWaterDat)
 		}
 	}
 #endif
+
+#ifdef STATIC_WATER_GEOMETRY
+	BuildFlatWater();
+#endif
 	
 	CTxdStore::PushCurrentTxd();
 
@@ -351,6 +444,54 @@ CWaterLevel::CreateWavyAtomic()
 	}
 }
 
+#ifdef STATIC_WATER_GEOMETRY
+void
+CWaterLevel::BuildFlatWater()
+{
+	// same level as RenderWater used to pick, the last of the four large sectors with water
+	for ( int32 x = 0; x < MAX_HUGE_SECTORS; x++ )
+	{
+		for ( int32 y = 0; y < MAX_HUGE_SECTORS; y++ )
+		{
+			aHugeWaterBlockList[x][y] = NO_WATER;
+
+			if ( aWaterBlockList[2*x+0][2*y+0] >= 0 )
+				aHugeWaterBlockList[x][y] = aWaterBlockList[2*x+0][2*y+0];
+			if ( aWaterBlockList[2*x+1][2*y+0] >= 0 )
+				aHugeWaterBlockList[x][y] = aWaterBlockList[2*x+1][2*y+0];
+			if ( aWaterBlockList[2*x+0][2*y+1] >= 0 )
+				aHugeWaterBlockList[x][y] = aWaterBlockList[2*x+0][2*y+1];
+			if ( aWaterBlockList[2*x+1][2*y+1] >= 0 )
+				aHugeWaterBlockList[x][y] = aWaterBlockList[2*x+1][2*y+1];
+		}
+	}
+
+	nNumSeaSectors = 0;
+
+	for ( int32 x = 0; x < 26; x++ )
+	{
+		for ( int32 y = 0; y < 5; y++ )
+			AddSeaSector(WATER_SIGN_X(float(x) * EXTRAHUGE_SECTOR_SIZE) - 1280.0f,
+				WATER_SIGN_Y(float(y) * EXTRAHUGE_SECTOR_SIZE) - 1280.0f, SEA_SOUTH);
+	}
+
+	for ( int32 y = 5; y < 21; y++ )
+	{
+		for ( int32 x = 0; x < 5; x++ )
+		{
+			float fX = WATER_SIGN_X(float(x) * EXTRAHUGE_SECTOR_SIZE) - 1280.0f;
+			float fY = WATER_SIGN_Y(float(y) * EXTRAHUGE_SECTOR_SIZE) - 1280.0f;
+
+			AddSeaSector(fX, fY, SEA_WEST);
+			AddSeaSector(-fX - EXTRAHUGE_SECTOR_SIZE, fY, SEA_EAST);
+		}
+	}
+
+	BuildFlatWaterIndices();
+	nNumFlatWaterQuads = 0;
+}
+#endif
+
 void
 CWaterLevel::DestroyWavyAtomic()
 {
@@ -698,10 +839,14 @@ CWaterLevel::RenderWater()
 	{
 		for ( int32 y = nStartY; y <= nEndY; y++ )
 		{
+#ifdef STATIC_WATER_GEOMETRY
+			if ( aHugeWaterBlockList[x][y] >= 0 )
+#else
 			if (   aWaterBlockList[2*x+0][2*y+0] >= 0
 				|| aWaterBlockList[2*x+1][2*y+0] >= 0
 				|| aWaterBlockList[2*x+0][2*y+1] >= 0
 				|| aWaterBlockList[2*x+1][2*y+1] >= 0 )
+#endif
 			{
 				float fX = WATER_FROM_HUGE_SECTOR_X(x);
 				float fY = WATER_FROM_HUGE_SECTOR_Y(y);
@@ -721,6 +866,9 @@ CWaterLevel::RenderWater()
 						if ( fHugeSectorDistToCamSqr >= SQR(500.0f) /*fHugeSectorNearDist*/ )
 						{
 							float fZ;
+#ifdef STATIC_WATER_GEOMETRY
+							fZ = ms_aWaterZs[ aHugeWaterBlockList[x][y] ];
+#else
 	
 							if ( aWaterBlockList[2*x+0][2*y+0] >= 0 )
 								fZ = ms_aWaterZs[ aWaterBlockList[2*x+0][2*y+0] ];
@@ -733,6 +881,7 @@ CWaterLevel::RenderWater()
 	
 							if ( aWaterBlockList[2*x+1][2*y+1] >= 0 )
 								fZ = ms_aWaterZs[ aWaterBlockList[2*x+1][2*y+1] ];
+#endif
 							
 							RenderOneFlatHugeWaterPoly(fX, fY, fZ, color);
 						}
@@ -900,6 +1049,32 @@ CWaterLevel::RenderWater()
 	bottom -> top && left -> right
 	*/
 
+#ifdef STATIC_WATER_GEOMETRY
+	for ( int32 i = 0; i < nNumSeaSectors; i++ )
+	{
+		tSeaSector *sea = &aSeaSectors[i];
+
+		if ( (sea->side == SEA_SOUTH && bUseCamStartY)
+			|| (sea->side == SEA_WEST && bUseCamStartX)
+			|| (sea->side == SEA_EAST && bUseCamEndX) )
+			continue;
+
+		CVector2D vecExtraHugeSectorCentre
+		(
+			sea->corner.x + EXTRAHUGE_SECTOR_SIZE/2,
+			sea->corner.y + EXTRAHUGE_SECTOR_SIZE/2
+		);
+
+		// compares with the square like the original loops did
+		float fCamDistToSector = (vecExtraHugeSectorCentre - camPos).Magnitude();
+
+		if ( fCamDistToSector < fHugeSectorMaxRenderDistSqr
+			&& TheCamera.IsSphereVisible(CVector(vecExtraHugeSectorCentre.x, vecExtraHugeSectorCentre.y, 0.0f), SectorRadius(EXTRAHUGE_SECTOR_SIZE)) )
+		{
+			RenderOneFlatExtraHugeWaterPoly(sea->corner.x, sea->corner.y, 0.0f, color);
+		}
+	}
+#else
 	if ( !bUseCamStartY )
 	{
 		for ( int32 x = 0; x < 26; x++ )
@@ -987,6 +1162,7 @@ CWaterLevel::RenderWater()
 			}
 		}
 	}
+#endif
 
 	RenderAndEmptyRenderBuffer();
 	
@@ -1045,6 +1221,9 @@ CWaterLevel::RenderWater()
 void
 CWaterLevel::RenderOneFlatSmallWaterPoly(float fX, float fY, float fZ, RwRGBA const &color)
 {
+#ifdef STATIC_WATER_GEOMETRY
+	AddFlatWaterQuad(fX, fY, fZ, SMALL_SECTOR_SIZE, color, color.alpha);
+#else
 	if ( TempBufferIndicesStored >= TEMPBUFFERINDEXSIZE-6 || TempBufferVerticesStored >= TEMPBUFFERVERTSIZE-4 )
 		RenderAndEmptyRenderBuffer();
 	
@@ -1082,11 +1261,15 @@ CWaterLevel::RenderOneFlatSmallWaterPoly(float fX, float fY, float fZ, RwRGBA co
 	
 	TempBufferVerticesStored += 4;
 	TempBufferIndicesStored += 6;
+#endif
 }
 
 void
 CWaterLevel::RenderOneFlatLargeWaterPoly(float fX, float fY, float fZ, RwRGBA const &color)
 {
+#ifdef STATIC_WATER_GEOMETRY
+	AddFlatWaterQuad(fX, fY, fZ, LARGE_SECTOR_SIZE, color, color.alpha);
+#else
 	if ( TempBufferIndicesStored >= TEMPBUFFERINDEXSIZE-6 || TempBufferVerticesStored >= TEMPBUFFERVERTSIZE-4 )
 		RenderAndEmptyRenderBuffer();
 	
@@ -1124,11 +1307,15 @@ CWaterLevel::RenderOneFlatLargeWaterPoly(float fX, float fY, float fZ, RwRGBA co
 	
 	TempBufferVerticesStored += 4;
 	TempBufferIndicesStored += 6;
+#endif
 }
 
 void
 CWaterLevel::RenderOneFlatHugeWaterPoly(float fX, float fY, float fZ, RwRGBA const &color)
 {
+#ifdef STATIC_WATER_GEOMETRY
+	AddFlatWaterQuad(fX, fY, fZ, HUGE_SECTOR_SIZE, color, 255);
+#else
 	if ( TempBufferIndicesStored >= TEMPBUFFERINDEXSIZE-6 || TempBufferVerticesStored >= TEMPBUFFERVERTSIZE-4 )
 		RenderAndEmptyRenderBuffer();
 	
@@ -1167,11 +1354,15 @@ CWaterLevel::RenderOneFlatHugeWaterPoly(float fX, float fY, float fZ, RwRGBA con
 	
 	TempBufferVerticesStored += 4;
 	TempBufferIndicesStored += 6;
+#endif
 }
 
 void
 CWaterLevel::RenderOneFlatExtraHugeWaterPoly(float fX, float fY, float fZ, RwRGBA const &color)
 {
+#ifdef STATIC_WATER_GEOMETRY
+	AddFlatWaterQuad(fX, fY, fZ, EXTRAHUGE_SECTOR_SIZE, color, 255);
+#else
 	if ( TempBufferIndicesStored >= TEMPBUFFERINDEXSIZE-6 || TempBufferVerticesStored >= TEMPBUFFERVERTSIZE-4 )
 		RenderAndEmptyRenderBuffer();
 	
@@ -1210,6 +1401,7 @@ CWaterLevel::RenderOneFlatExtraHugeWaterPoly(float fX, float fY, float fZ, RwRGB
 	
 	TempBufferVerticesStored += 4;
 	TempBufferIndicesStored += 6;
+#endif
 }
 
 void
@@ -1415,19 +1607,26 @@ CWaterLevel::CalcDistanceToWater(float fX, float fY)
 void
 CWaterLevel::RenderAndEmptyRenderBuffer()
 {
+#ifdef STATIC_WATER_GEOMETRY
+	if ( nNumFlatWaterQuads )
+	{
+		LittleTest();
+
+		RenderBuffer::RenderIndexed(aFlatWaterVertices, nNumFlatWaterQuads*4, aFlatWaterIndices, nNumFlatWaterQuads*6);
+	}
+
+	nNumFlatWaterQuads = 0;
+#else
 	if ( TempBufferVerticesStored )
 	{
 		LittleTest();
 
-		if ( RwIm3DTransform(TempBufferRenderVertices, TempBufferVerticesStored, nil, rwIM3D_VERTEXUV) )
-		{
-			RwIm3DRenderIndexedPrimitive(rwPRIMTYPETRILIST, TempBufferRenderIndexList, TempBufferIndicesStored);
-			RwIm3DEnd();
-		}
+		RenderBuffer::RenderIndexed(TempBufferRenderVertices, TempBufferVerticesStored, TempBufferRenderIndexList, TempBufferIndicesStored);
 	}
 	
 	TempBufferIndicesStored = 0;
 	TempBufferVerticesStored = 0;
+#endif
 }
 
 void
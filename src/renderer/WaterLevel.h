@@ -78,6 +78,10 @@ class CWaterLevel
 	static RpGeometry *apGeomArray[MAX_BOAT_WAKES];
 	static int16       nGeomUsed;
 
+#ifdef STATIC_WATER_GEOMETRY
+	static void    BuildFlatWater();
+#endif
+
 public:
 	static void    Initialise(Const char *pWaterDat); // out of class in III PC and later because of SecuROM
 	static void    Shutdown();
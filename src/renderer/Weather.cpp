@@ -515,11 +515,7 @@ void CWeather::RenderRainStreaks(void)
 		RwRenderStateSet(rwRENDERSTATEDESTBLEND, (void*)rwBLENDONE);
 		RwRenderStateSet(rwRENDERSTATEVERTEXALPHAENABLE, (void*)TRUE);
 		RwRenderStateSet(rwRENDERSTATETEXTURERASTER, RwTextureGetRaster(gpRainDropTex[3]));
-		if (RwIm3DTransform(TempBufferRenderVertices, TempBufferVerticesStored, nil, 1))
-		{
-			RwIm3DRenderIndexedPrimitive(rwPRIMTYPETRILIST, TempBufferRenderIndexList, TempBufferIndicesStored);
-			RwIm3DEnd();
-		}
+		RenderBuffer::RenderIndexed(TempBufferRenderVertices, TempBufferVerticesStored, TempBufferRenderIndexList, TempBufferIndicesStored);
 		RwRenderStateSet(rwRENDERSTATEZWRITEENABLE, (void*)TRUE);
 		RwRenderStateSet(rwRENDERSTATEZTESTENABLE, (void*)TRUE);
 		RwRenderStateSet(rwRENDERSTATESRCBLEND, (void*)rwBLENDSRCALPHA);
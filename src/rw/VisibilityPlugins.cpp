@@ -13,10 +13,10 @@
 #include "custompipes.h"
 #include "MemoryHeap.h"
 
-CLinkList<CVisibilityPlugins::AlphaObjectInfo> CVisibilityPlugins::m_alphaList;
-CLinkList<CVisibilityPlugins::AlphaObjectInfo> CVisibilityPlugins::m_alphaEntityList;
+CSortedList<CVisibilityPlugins::AlphaObjectInfo> CVisibilityPlugins::m_alphaList;
+CSortedList<CVisibilityPlugins::AlphaObjectInfo> CVisibilityPlugins::m_alphaEntityList;
 #ifdef NEW_RENDERER
-CLinkList<CVisibilityPlugins::AlphaObjectInfo> CVisibilityPlugins::m_alphaBuildingList;
+CSortedList<CVisibilityPlugins::AlphaObjectInfo> CVisibilityPlugins::m_alphaBuildingList;
 #endif
 
 int32 CVisibilityPlugins::ms_atomicPluginOffset = -1;
@@ -152,21 +152,15 @@ void
 CVisibilityPlugins::Initialise(void)
 {
 	m_alphaList.Init(NUMALPHALIST);
-	m_alphaList.head.item.sort = 0.0f;
-	m_alphaList.tail.item.sort = 100000000.0f;
 #ifdef ASPECT_RATIO_SCALE
 	// default 150 is not enough for bigger FOVs
 	m_alphaEntityList.Init(NUMALPHAENTITYLIST * 3);
 #else
 	m_alphaEntityList.Init(NUMALPHAENTITYLIST);
 #endif // ASPECT_RATIO_SCALE
-	m_alphaEntityList.head.item.sort = 0.0f;
-	m_alphaEntityList.tail.item.sort = 100000000.0f;
 
 #ifdef NEW_RENDERER
 	m_alphaBuildingList.Init(NUMALPHAENTITYLIST);
-	m_alphaBuildingList.head.item.sort = 0.0f;
-	m_alphaBuildingList.tail.item.sort = 100000000.0f;
 #endif
 }
 
@@ -200,13 +194,14 @@ CVisibilityPlugins::InsertEntityIntoSortedList(CEntity *e, float dist)
 	item.entity = e;
 	item.sort = dist;
 #ifdef NEW_RENDERER
-	if(gbNewRenderer && e->IsBuilding())
-		return !!m_alphaBuildingList.InsertSorted(item);
+	if(gbNewRenderer && e->IsBuilding()){
+		m_alphaBuildingList.Insert(item);
+		return true;
+	}
 #endif
-	bool ret = !!m_alphaEntityList.InsertSorted(item);
-//	if(!ret)
-//		printf("list full %d\n", m_alphaEntityList.Count());
-	return ret;
+	// lists grow now, never full
+	m_alphaEntityList.Insert(item);
+	return true;
 }
 
 void
@@ -221,10 +216,8 @@ CVisibilityPlugins::InsertAtomicIntoSortedList(RpAtomic *a, float dist)
 	AlphaObjectInfo item;
 	item.atomic = a;
 	item.sort = dist;
-	bool ret = !!m_alphaList.InsertSorted(item);
-//	if(!ret)
-//		printf("list full %d\n", m_alphaList.Count());
-	return ret;
+	m_alphaList.Insert(item);
+	return true;
 }
 
 // can't increase this yet unfortunately...
@@ -270,22 +263,19 @@ SetTextureCB(RpMaterial *material, void *data)
 void
 CVisibilityPlugins::RenderAlphaAtomics(void)
 {
-	CLink<AlphaObjectInfo> *node;
-	for(node = m_alphaList.tail.prev;
-	    node != &m_alphaList.head;
-	    node = node->prev)
-		RENDERCALLBACK(node->item.atomic);
+	m_alphaList.Sort();
+	for(int i = m_alphaList.GetNumItems()-1; i >= 0; i--)
+		RENDERCALLBACK(m_alphaList[i].atomic);
 }
 
 void
 CVisibilityPlugins::RenderFadingEntities(void)
 {
-	CLink<AlphaObjectInfo> *node;
 	CSimpleModelInfo *mi;
-	for(node = m_alphaEntityList.tail.prev;
-	    node != &m_alphaEntityList.head;
-	    node = node->prev){
-		CEntity *e = node->item.entity;
+	m_alphaEntityList.Sort();
+	for(int i = m_alphaEntityList.GetNumItems()-1; i >= 0; i--){
+		AlphaObjectInfo *item = &m_alphaEntityList[i];
+		CEntity *e = item->entity;
 		if(e->m_rwObject == nil)
 			continue;
 #ifdef EXTENDED_PIPELINES
@@ -312,7 +302,7 @@ CVisibilityPlugins::RenderFadingEntities(void)
 			SetAmbientColours();
 			e->bImBeingRendered = true;
 			PUSH_RENDERGROUP(mi->GetModelName());
-			RenderFadingAtomic((RpAtomic*)e->m_rwObject, node->item.sort);
+			RenderFadingAtomic((RpAtomic*)e->m_rwObject, item->sort);
 			POP_RENDERGROUP();
 			e->bImBeingRendered = false;
 		}else
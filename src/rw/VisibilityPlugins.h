@@ -20,10 +20,11 @@ public:
 		float sort;
 	};
 
-	static CLinkList<AlphaObjectInfo> m_alphaList;
-	static CLinkList<AlphaObjectInfo> m_alphaEntityList;
+	// sorted when they're rendered
+	static CSortedList<AlphaObjectInfo> m_alphaList;
+	static CSortedList<AlphaObjectInfo> m_alphaEntityList;
 #ifdef NEW_RENDERER
-	static CLinkList<AlphaObjectInfo> m_alphaBuildingList;
+	static CSortedList<AlphaObjectInfo> m_alphaBuildingList;
 #endif
 	static RwCamera *ms_pCamera;
 	static RwV3d *ms_pCameraPosn;
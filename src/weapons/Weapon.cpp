@@ -1225,15 +1225,18 @@ CWeapon::FireShotgun(CEntity *shooter, CVector *fireSource)
 		shooterAngle = RADTODEG(shooter->GetForward().Heading());
 
 
+	// trace all pellets in one batch, then deal with what they hit
+	CWorldLosRay pellets[5];
+	CVector2D shootRots[5];
+
 	for ( int32 i = 0; i < 5; i++ ) // five shoots at once
 	{
 		float shootAngle = DEGTORAD(7.5f*i + shooterAngle - 15.0f);
 		CVector2D shootRot(-Sin(shootAngle), Cos(shootAngle));
 		shootRot.Normalise();
+		shootRots[i] = shootRot;
 
 		CVector source, target;
-		CColPoint point;
-		CEntity *victim;
 
 		if ( shooter == FindPlayerPed() && TheCamera.Cams[0].Using3rdPersonMouseCam() )
 		{
@@ -1256,7 +1259,7 @@ CWeapon::FireShotgun(CEntity *shooter, CVector *fireSource)
 			target *= info->m_fRange;
 			target += source;
 
-			ProcessLineOfSight(source, target, point, victim, m_eWeaponType, shooter, true, true, true, true, true, true, false);
+			pellets[i].Set(source, target, LOS_ALLENTITIES | LOS_IGNORESEETHROUGH);
 		}
 		else
 		{
@@ -1277,8 +1280,17 @@ CWeapon::FireShotgun(CEntity *shooter, CVector *fireSource)
 				}
 			}
 
-			ProcessLineOfSight(*fireSource, target, point, victim, m_eWeaponType, shooter, true, true, true, true, true, true, false);
+			pellets[i].Set(*fireSource, target, LOS_ALLENTITIES | LOS_IGNORESEETHROUGH);
 		}
+	}
+
+	CWorld::ProcessLineOfSightBatch(pellets, 5);
+
+	for ( int32 i = 0; i < 5; i++ )
+	{
+		CVector target = pellets[i].point2;
+		CColPoint &point = pellets[i].point;
+		CEntity *victim = pellets[i].entity;
 
 		if ( victim )
 		{
@@ -1354,7 +1366,7 @@ CWeapon::FireShotgun(CEntity *shooter, CVector *fireSource)
 
 #ifndef FIX_BUGS
 						CVector dist = point.point - (*fireSource);
-						CVector offset = dist - Max(0.2f*dist.Magnitude(), 2.0f) * CVector(shootRot.x, shootRot.y, 0.0f);
+						CVector offset = dist - Max(0.2f*dist.Magnitude(), 2.0f) * CVector(shootRots[i].x, shootRots[i].y, 0.0f);
 						CVector smokePos = *fireSource + offset;
 #else
 					    CVector smokePos = point.point;
@@ -1373,7 +1385,7 @@ CWeapon::FireShotgun(CEntity *shooter, CVector *fireSource)
 
 #ifndef FIX_BUGS
 						CVector dist = point.point - (*fireSource);
-						CVector offset = dist - Max(0.2f*dist.Magnitude(), 2.0f) * CVector(shootRot.x, shootRot.y, 0.0f);
+						CVector offset = dist - Max(0.2f*dist.Magnitude(), 2.0f) * CVector(shootRots[i].x, shootRots[i].y, 0.0f);
 					    CVector smokePos = *fireSource + offset;
 #else
 					    CVector smokePos = point.point;